@@ -0,0 +1,162 @@
+/**
+ * @file backends.c
+ * @brief Allocator backends that the benchmark suites can run against.
+ *
+ * Each backend exposes the same function-pointer vtable, so every benchmark runs
+ * unchanged against this allocator's strategies and against the system allocator
+ * (glibc malloc/free/realloc), and their results land side by side in one table.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "allocator.h"
+#include "benchmark.h"
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#if __GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33)
+#define HAVE_MALLINFO2 1
+#endif
+#endif
+
+// Fresh heap for each of this allocator's strategies
+static void reset_first_fit() {
+    reset_allocator();
+    set_allocation_strategy(FIRST_FIT);
+}
+
+static void reset_best_fit() {
+    reset_allocator();
+    set_allocation_strategy(BEST_FIT);
+}
+
+static void reset_worst_fit() {
+    reset_allocator();
+    set_allocation_strategy(WORST_FIT);
+}
+
+static void reset_next_fit() {
+    reset_allocator();
+    set_allocation_strategy(NEXT_FIT);
+}
+
+// The same strategies with metadata read from the side table
+static void reset_first_fit_side() {
+    reset_first_fit();
+    set_metadata_mode(METADATA_SIDE_TABLE);
+}
+
+static void reset_best_fit_side() {
+    reset_best_fit();
+    set_metadata_mode(METADATA_SIDE_TABLE);
+}
+
+static void reset_worst_fit_side() {
+    reset_worst_fit();
+    set_metadata_mode(METADATA_SIDE_TABLE);
+}
+
+static void reset_next_fit_side() {
+    reset_next_fit();
+    set_metadata_mode(METADATA_SIDE_TABLE);
+}
+
+static void reset_bitmap() {
+    reset_allocator();
+    set_allocation_strategy(BITMAP);
+}
+
+static void reset_buddy() {
+    reset_allocator();
+    set_allocation_strategy(BUDDY);
+}
+
+// Bytes this allocator holds for a block, including its header
+static size_t heap_block_size(void* ptr) {
+    return ((BlockHeader*)((char*)ptr - sizeof(BlockHeader)))->size;
+}
+
+#ifdef __GLIBC__
+// Bytes glibc holds for a block: usable size plus the chunk size field
+static size_t glibc_block_size(void* ptr) {
+    return malloc_usable_size(ptr) + sizeof(size_t);
+}
+
+static void reset_glibc() {
+    malloc_trim(0);
+}
+#else
+static void reset_glibc() {
+}
+#endif
+
+#ifdef HAVE_MALLINFO2
+static size_t glibc_free_blocks() {
+    return mallinfo2().ordblks;
+}
+
+static size_t glibc_free_bytes() {
+    return mallinfo2().fordblks;
+}
+#endif
+
+const AllocatorBackend backends[] = {
+    {"First-Fit", "first-fit", reset_first_fit, heap_alloc, heap_free, heap_realloc,
+     heap_block_size, get_fragmentation_ratio, get_free_block_count, get_free_heap_size,
+     get_fit_search_count, get_fit_search_steps},
+    {"Best-Fit", "best-fit", reset_best_fit, heap_alloc, heap_free, heap_realloc,
+     heap_block_size, get_fragmentation_ratio, get_free_block_count, get_free_heap_size,
+     get_fit_search_count, get_fit_search_steps},
+    {"Worst-Fit", "worst-fit", reset_worst_fit, heap_alloc, heap_free, heap_realloc,
+     heap_block_size, get_fragmentation_ratio, get_free_block_count, get_free_heap_size,
+     get_fit_search_count, get_fit_search_steps},
+    {"Next-Fit", "next-fit", reset_next_fit, heap_alloc, heap_free, heap_realloc,
+     heap_block_size, get_fragmentation_ratio, get_free_block_count, get_free_heap_size,
+     get_fit_search_count, get_fit_search_steps},
+    {"First-Fit/side", "first-fit-side", reset_first_fit_side, heap_alloc, heap_free, heap_realloc,
+     heap_block_size, get_fragmentation_ratio, get_free_block_count, get_free_heap_size,
+     get_fit_search_count, get_fit_search_steps},
+    {"Best-Fit/side", "best-fit-side", reset_best_fit_side, heap_alloc, heap_free, heap_realloc,
+     heap_block_size, get_fragmentation_ratio, get_free_block_count, get_free_heap_size,
+     get_fit_search_count, get_fit_search_steps},
+    {"Worst-Fit/side", "worst-fit-side", reset_worst_fit_side, heap_alloc, heap_free, heap_realloc,
+     heap_block_size, get_fragmentation_ratio, get_free_block_count, get_free_heap_size,
+     get_fit_search_count, get_fit_search_steps},
+    {"Next-Fit/side", "next-fit-side", reset_next_fit_side, heap_alloc, heap_free, heap_realloc,
+     heap_block_size, get_fragmentation_ratio, get_free_block_count, get_free_heap_size,
+     get_fit_search_count, get_fit_search_steps},
+    {"Bitmap", "bitmap", reset_bitmap, heap_alloc, heap_free, heap_realloc,
+     bitmap_block_size, get_fragmentation_ratio, get_free_block_count, get_free_heap_size,
+     NULL, NULL},
+    {"Buddy", "buddy", reset_buddy, heap_alloc, heap_free, heap_realloc,
+     buddy_block_size, get_fragmentation_ratio, get_free_block_count, get_free_heap_size,
+     NULL, NULL},
+#if defined(HAVE_MALLINFO2)
+    {"glibc malloc", "glibc", reset_glibc, malloc, free, realloc,
+     glibc_block_size, NULL, glibc_free_blocks, glibc_free_bytes, NULL, NULL},
+#elif defined(__GLIBC__)
+    {"glibc malloc", "glibc", reset_glibc, malloc, free, realloc,
+     glibc_block_size, NULL, NULL, NULL, NULL, NULL},
+#else
+    {"system malloc", "glibc", reset_glibc, malloc, free, realloc,
+     NULL, NULL, NULL, NULL, NULL, NULL},
+#endif
+};
+
+const int num_backends = sizeof(backends) / sizeof(backends[0]);
+
+/**
+ * @brief Looks up a backend by its command line key.
+ *
+ * @param key Backend key such as "best-fit" or "glibc".
+ *
+ * @return Pointer to the backend, or NULL if no backend has that key.
+ */
+const AllocatorBackend* find_backend(const char* key) {
+    for (int i = 0; i < num_backends; i++) {
+        if (strcmp(backends[i].key, key) == 0) {
+            return &backends[i];
+        }
+    }
+    return NULL;
+}
@@ -6,57 +6,108 @@
  * of different allocation strategies across various workloads and metrics.
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <string.h>
 #include <time.h>
 #include <math.h>
 #include "allocator.h"
+#include "fit_kernels.h"
+#include "benchmark.h"
+
+// Run configuration (see --trials, --warmup, --json and --csv)
+int num_trials = DEFAULT_TRIALS;
+int warmup_trials = DEFAULT_WARMUP_TRIALS;
+OutputFormat output_format = OUTPUT_TEXT;
+
+// Has a machine-readable record been written yet? (JSON comma placement)
+static bool first_record = true;
 
-#define ANSI_COLOR_CYAN    "\x1b[36m"
-#define ANSI_COLOR_GREEN   "\x1b[32m"
-#define ANSI_COLOR_YELLOW  "\x1b[33m"
-#define ANSI_COLOR_BLUE    "\x1b[34m"
-#define ANSI_COLOR_MAGENTA "\x1b[35m"
-#define ANSI_COLOR_RESET   "\x1b[0m"
-#define ANSI_BOLD          "\x1b[1m"
-
-// Benchmark configuration
-#define NUM_TRIALS 5
-#define SMALL_ALLOC_COUNT 1000
-#define LARGE_ALLOC_COUNT 500
-#define MIXED_ALLOC_COUNT 750
-
-// Helper to reset allocator state
+// Helper to reset allocator state (O(1): the heap's memory is not cleared)
 void reset_allocator() {
-    memset(heap, 0, HEAP_CAPACITY);
-    heap_size = 0;
-    first_block = NULL;
-    current_strategy = FIRST_FIT;
+    heap_reset();
+    set_allocation_strategy(FIRST_FIT);
+    set_metadata_mode(METADATA_INLINE);
     set_last_status(ALLOC_SUCCESS);
 }
 
+// Monotonic wall-clock time in milliseconds (nanosecond resolution)
+double now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+// Runs per measurement: discarded warm-up runs followed by measured trials
+int total_runs() {
+    return warmup_trials + num_trials;
+}
+
+// Human-readable output; suppressed when writing JSON or CSV
+void text_printf(const char* format, ...) {
+    if (output_format != OUTPUT_TEXT) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
 // Print section header
 void print_section(const char* title) {
-    printf("\n");
-    printf(ANSI_COLOR_CYAN ANSI_BOLD "═══════════════════════════════════════════════════════════\n");
-    printf("  %s\n", title);
-    printf("═══════════════════════════════════════════════════════════\n" ANSI_COLOR_RESET);
+    text_printf("\n");
+    text_printf(ANSI_COLOR_CYAN ANSI_BOLD "═══════════════════════════════════════════════════════════\n");
+    text_printf("  %s\n", title);
+    text_printf("═══════════════════════════════════════════════════════════\n" ANSI_COLOR_RESET);
 }
 
 // Print subsection header
 void print_subsection(const char* title) {
-    printf("\n" ANSI_COLOR_YELLOW "─── %s ───\n" ANSI_COLOR_RESET, title);
+    text_printf("\n" ANSI_COLOR_YELLOW "─── %s ───\n" ANSI_COLOR_RESET, title);
 }
 
-// Calculate statistics
-typedef struct {
-    double mean;
-    double min;
-    double max;
-    double std_dev;
-} Stats;
+// Open the machine-readable report
+static void begin_report() {
+    if (output_format == OUTPUT_JSON) {
+        printf("[\n");
+    } else if (output_format == OUTPUT_CSV) {
+        printf("benchmark,backend,threads,metric,value,better\n");
+    }
+}
+
+// Close the machine-readable report
+static void end_report() {
+    if (output_format == OUTPUT_JSON) {
+        printf("\n]\n");
+    }
+}
+
+/**
+ * Record one metric. In text mode the tables already show it; in JSON/CSV mode it is
+ * written as a record keyed by (benchmark, backend, threads, metric). Metrics a backend
+ * cannot report (NAN) are omitted.
+ */
+void report_metric(const char* benchmark, const char* backend, int threads,
+                   const char* metric, double value, MetricDirection direction) {
+    if (output_format == OUTPUT_TEXT || isnan(value)) {
+        return;
+    }
+    const char* better = direction == HIGHER_IS_BETTER ? "higher" : "lower";
+    if (output_format == OUTPUT_JSON) {
+        printf("%s  {\"benchmark\": \"%s\", \"backend\": \"%s\", \"threads\": %d, "
+               "\"metric\": \"%s\", \"value\": %.6g, \"better\": \"%s\"}",
+               first_record ? "" : ",\n", benchmark, backend, threads, metric, value, better);
+    } else {
+        printf("%s,%s,%d,%s,%.6g,%s\n", benchmark, backend, threads, metric, value, better);
+    }
+    first_record = false;
+}
 
+// Calculate statistics
 Stats calculate_stats(double* data, int count) {
     Stats s = {0};
 
@@ -85,18 +136,53 @@ Stats calculate_stats(double* data, int count) {
     return s;
 }
 
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile (0-100) of data; sorts data in place
+double percentile(double* data, int count, double pct) {
+    if (count == 0) {
+        return NAN;
+    }
+    qsort(data, count, sizeof(double), compare_doubles);
+    int rank = (int)ceil(pct / 100.0 * count);
+    return data[rank > 0 ? rank - 1 : 0];
+}
+
+// Statistics over the measured trials of a runs array (warm-up runs excluded)
+Stats measured_stats(double* runs) {
+    return calculate_stats(runs + warmup_trials, num_trials);
+}
+
 // Print comparison table header
 void print_table_header() {
-    printf("\n%-15s | %-12s | %-12s | %-12s | %-12s\n",
-           "Strategy", "Mean (ms)", "Min (ms)", "Max (ms)", "Ops/sec");
-    printf("----------------+-------------+-------------+-------------+-------------\n");
+    text_printf("\n%-15s | %-12s | %-12s | %-12s | %-12s\n",
+                "Backend", "Mean (ms)", "Min (ms)", "Max (ms)", "Ops/sec");
+    text_printf("----------------+-------------+-------------+-------------+-------------\n");
 }
 
-// Print table row
-void print_table_row(const char* strategy, Stats stats, int num_ops) {
+// Print table row and report its timing metrics
+void print_table_row(const char* benchmark, const AllocatorBackend* backend, Stats stats, int num_ops) {
     double ops_per_sec = num_ops / (stats.mean / 1000.0);
-    printf("%-15s | %12.4f | %12.4f | %12.4f | %12.0f\n",
-           strategy, stats.mean, stats.min, stats.max, ops_per_sec);
+    text_printf("%-15s | %12.4f | %12.4f | %12.4f | %12.0f\n",
+                backend->name, stats.mean, stats.min, stats.max, ops_per_sec);
+    report_metric(benchmark, backend->key, 1, "mean_ms", stats.mean, LOWER_IS_BETTER);
+    report_metric(benchmark, backend->key, 1, "min_ms", stats.min, LOWER_IS_BETTER);
+    report_metric(benchmark, backend->key, 1, "ops_per_sec", ops_per_sec, HIGHER_IS_BETTER);
+    // Throughput of the fastest trial: least disturbed by scheduler noise, so it is what the regression gate checks
+    report_metric(benchmark, backend->key, 1, "peak_ops_per_sec", num_ops / (stats.min / 1000.0), HIGHER_IS_BETTER);
+}
+
+// Print a right-aligned metric, or "n/a" if the backend cannot report it (NAN)
+void print_metric(double value, int width, int precision) {
+    if (isnan(value)) {
+        text_printf("%*s", width, "n/a");
+    } else {
+        text_printf("%*.*f", width, precision, value);
+    }
 }
 
 /**
@@ -105,38 +191,36 @@ void print_table_row(const char* strategy, Stats stats, int num_ops) {
  */
 void benchmark_sequential_allocation() {
     print_section("BENCHMARK 1: Sequential Allocation Speed");
-    printf("Allocating %d blocks of 64 bytes each (no frees)\n", SMALL_ALLOC_COUNT);
+    text_printf("Allocating %d blocks of 64 bytes each (no frees)\n", SMALL_ALLOC_COUNT);
 
-    const char* strategy_names[] = {"First-Fit", "Best-Fit", "Worst-Fit"};
-    AllocationStrategy strategies[] = {FIRST_FIT, BEST_FIT, WORST_FIT};
 
     print_table_header();
 
-    for (int s = 0; s < 3; s++) {
-        double times[NUM_TRIALS];
+    for (int b = 0; b < num_active_backends; b++) {
+        const AllocatorBackend* backend = active_backends[b];
+        double times[MAX_RUNS];
 
-        for (int trial = 0; trial < NUM_TRIALS; trial++) {
-            reset_allocator();
-            set_allocation_strategy(strategies[s]);
+        for (int run = 0; run < total_runs(); run++) {
+            backend->reset();
 
-            clock_t start = clock();
+            double start = now_ms();
 
             void* ptrs[SMALL_ALLOC_COUNT];
             for (int i = 0; i < SMALL_ALLOC_COUNT; i++) {
-                ptrs[i] = heap_alloc(64);
+                ptrs[i] = backend->alloc(64);
             }
 
-            clock_t end = clock();
-            times[trial] = ((double)(end - start) / CLOCKS_PER_SEC) * 1000.0;
+            double end = now_ms();
+            times[run] = end - start;
 
             // Cleanup
             for (int i = 0; i < SMALL_ALLOC_COUNT; i++) {
-                if (ptrs[i]) heap_free(ptrs[i]);
+                if (ptrs[i]) backend->free(ptrs[i]);
             }
         }
 
-        Stats stats = calculate_stats(times, NUM_TRIALS);
-        print_table_row(strategy_names[s], stats, SMALL_ALLOC_COUNT);
+        Stats stats = measured_stats(times);
+        print_table_row("sequential_allocation", backend, stats, SMALL_ALLOC_COUNT);
     }
 }
 
@@ -146,42 +230,41 @@ void benchmark_sequential_allocation() {
  */
 void benchmark_random_size_allocation() {
     print_section("BENCHMARK 2: Random Size Allocation");
-    printf("Allocating %d blocks with random sizes: 32, 64, 128, 256, 512 bytes\n",
+    text_printf("Allocating %d blocks with random sizes: 32, 64, 128, 256, 512 bytes\n",
            SMALL_ALLOC_COUNT);
 
-    const char* strategy_names[] = {"First-Fit", "Best-Fit", "Worst-Fit"};
-    AllocationStrategy strategies[] = {FIRST_FIT, BEST_FIT, WORST_FIT};
     size_t sizes[] = {32, 64, 128, 256, 512};
 
     print_table_header();
 
-    for (int s = 0; s < 3; s++) {
-        double times[NUM_TRIALS];
+    for (int b = 0; b < num_active_backends; b++) {
+        const AllocatorBackend* backend = active_backends[b];
+        double times[MAX_RUNS];
 
-        for (int trial = 0; trial < NUM_TRIALS; trial++) {
-            reset_allocator();
-            set_allocation_strategy(strategies[s]);
+        for (int run = 0; run < total_runs(); run++) {
+            int trial = run - warmup_trials;  // negative during warm-up runs
+            backend->reset();
             srand(42 + trial); // Consistent random seed per trial
 
-            clock_t start = clock();
+            double start = now_ms();
 
             void* ptrs[SMALL_ALLOC_COUNT];
             for (int i = 0; i < SMALL_ALLOC_COUNT; i++) {
                 size_t size = sizes[rand() % 5];
-                ptrs[i] = heap_alloc(size);
+                ptrs[i] = backend->alloc(size);
             }
 
-            clock_t end = clock();
-            times[trial] = ((double)(end - start) / CLOCKS_PER_SEC) * 1000.0;
+            double end = now_ms();
+            times[run] = end - start;
 
             // Cleanup
             for (int i = 0; i < SMALL_ALLOC_COUNT; i++) {
-                if (ptrs[i]) heap_free(ptrs[i]);
+                if (ptrs[i]) backend->free(ptrs[i]);
             }
         }
 
-        Stats stats = calculate_stats(times, NUM_TRIALS);
-        print_table_row(strategy_names[s], stats, SMALL_ALLOC_COUNT);
+        Stats stats = measured_stats(times);
+        print_table_row("random_size_allocation", backend, stats, SMALL_ALLOC_COUNT);
     }
 }
 
@@ -191,27 +274,26 @@ void benchmark_random_size_allocation() {
  */
 void benchmark_fragmentation() {
     print_section("BENCHMARK 3: Fragmentation Analysis");
-    printf("Mixed allocation/deallocation with 50%% random frees\n");
-
-    const char* strategy_names[] = {"First-Fit", "Best-Fit", "Worst-Fit"};
-    AllocationStrategy strategies[] = {FIRST_FIT, BEST_FIT, WORST_FIT};
-
-    printf("\n%-15s | %-12s | %-12s | %-15s | %-12s\n",
-           "Strategy", "Frag Ratio", "Free Blocks", "Avg Free Size", "Time (ms)");
-    printf("----------------+-------------+-------------+----------------+-------------\n");
-
-    for (int s = 0; s < 3; s++) {
-        double frag_ratios[NUM_TRIALS];
-        double free_blocks[NUM_TRIALS];
-        double avg_sizes[NUM_TRIALS];
-        double times[NUM_TRIALS];
-
-        for (int trial = 0; trial < NUM_TRIALS; trial++) {
-            reset_allocator();
-            set_allocation_strategy(strategies[s]);
+    text_printf("Mixed allocation/deallocation with 50%% random frees, then a refill of the holes\n");
+
+    text_printf("\n%-15s | %-12s | %-12s | %-15s | %-12s | %-12s\n",
+           "Backend", "Frag Ratio", "Free Blocks", "Avg Free Size", "Search Len", "Time (ms)");
+    text_printf("----------------+-------------+-------------+----------------+-------------+-------------\n");
+
+    for (int b = 0; b < num_active_backends; b++) {
+        const AllocatorBackend* backend = active_backends[b];
+        double frag_ratios[MAX_RUNS];
+        double free_blocks[MAX_RUNS];
+        double avg_sizes[MAX_RUNS];
+        double search_lengths[MAX_RUNS];
+        double times[MAX_RUNS];
+
+        for (int run = 0; run < total_runs(); run++) {
+            int trial = run - warmup_trials;  // negative during warm-up runs
+            backend->reset();
             srand(100 + trial);
 
-            clock_t start = clock();
+            double start = now_ms();
 
             void* ptrs[MIXED_ALLOC_COUNT];
             for (int i = 0; i < MIXED_ALLOC_COUNT; i++) {
@@ -221,45 +303,85 @@ void benchmark_fragmentation() {
             // Allocate all blocks
             for (int i = 0; i < MIXED_ALLOC_COUNT; i++) {
                 size_t size = 64 + (rand() % 256);
-                ptrs[i] = heap_alloc(size);
+                ptrs[i] = backend->alloc(size);
             }
 
             // Free 50% randomly
             for (int i = 0; i < MIXED_ALLOC_COUNT; i++) {
                 if (rand() % 2 == 0 && ptrs[i] != NULL) {
-                    heap_free(ptrs[i]);
+                    backend->free(ptrs[i]);
                     ptrs[i] = NULL;
                 }
             }
 
-            clock_t end = clock();
+            double end = now_ms();
 
             // Measure fragmentation
-            frag_ratios[trial] = get_fragmentation_ratio();
-            free_blocks[trial] = get_free_block_count();
-            size_t total_free = get_free_heap_size();
-            avg_sizes[trial] = free_blocks[trial] > 0 ?
-                               (double)total_free / free_blocks[trial] : 0;
-            times[trial] = ((double)(end - start) / CLOCKS_PER_SEC) * 1000.0;
+            frag_ratios[run] = backend->fragmentation ? backend->fragmentation() : NAN;
+            free_blocks[run] = backend->free_blocks ? (double)backend->free_blocks() : NAN;
+            double total_free = backend->free_bytes ? (double)backend->free_bytes() : NAN;
+            avg_sizes[run] = free_blocks[run] > 0 ?
+                               total_free / free_blocks[run] : 0;
+            times[run] = end - start;
+
+            // Refill the holes and measure how far each fit search had to look
+            void* refill[MIXED_ALLOC_COUNT / 2];
+            size_t searches = backend->searches ? backend->searches() : 0;
+            size_t steps = backend->search_steps ? backend->search_steps() : 0;
+            for (int i = 0; i < MIXED_ALLOC_COUNT / 2; i++) {
+                refill[i] = backend->alloc(64 + (rand() % 256));
+            }
+            search_lengths[run] = NAN;
+            if (backend->searches && backend->searches() > searches) {
+                search_lengths[run] = (double)(backend->search_steps() - steps) / (backend->searches() - searches);
+            }
 
             // Cleanup remaining
             for (int i = 0; i < MIXED_ALLOC_COUNT; i++) {
-                if (ptrs[i]) heap_free(ptrs[i]);
+                if (ptrs[i]) backend->free(ptrs[i]);
+            }
+            for (int i = 0; i < MIXED_ALLOC_COUNT / 2; i++) {
+                if (refill[i]) backend->free(refill[i]);
             }
         }
 
-        Stats frag_stats = calculate_stats(frag_ratios, NUM_TRIALS);
-        Stats block_stats = calculate_stats(free_blocks, NUM_TRIALS);
-        Stats size_stats = calculate_stats(avg_sizes, NUM_TRIALS);
-        Stats time_stats = calculate_stats(times, NUM_TRIALS);
-
-        printf("%-15s | %12.4f | %12.0f | %15.0f | %12.4f\n",
-               strategy_names[s],
-               frag_stats.mean,
-               block_stats.mean,
-               size_stats.mean,
-               time_stats.mean);
+        Stats frag_stats = measured_stats(frag_ratios);
+        Stats block_stats = measured_stats(free_blocks);
+        Stats size_stats = measured_stats(avg_sizes);
+        Stats search_stats = measured_stats(search_lengths);
+        Stats time_stats = measured_stats(times);
+
+        text_printf("%-15s | ", backend->name);
+        print_metric(frag_stats.mean, 12, 4);
+        text_printf(" | ");
+        print_metric(block_stats.mean, 12, 0);
+        text_printf(" | ");
+        print_metric(size_stats.mean, 15, 0);
+        text_printf(" | ");
+        print_metric(search_stats.mean, 12, 1);
+        text_printf(" | %12.4f\n", time_stats.mean);
+
+        report_metric("fragmentation", backend->key, 1, "fragmentation_ratio", frag_stats.mean, HIGHER_IS_BETTER);
+        report_metric("fragmentation", backend->key, 1, "free_blocks", block_stats.mean, LOWER_IS_BETTER);
+        report_metric("fragmentation", backend->key, 1, "avg_free_size", size_stats.mean, HIGHER_IS_BETTER);
+        report_metric("fragmentation", backend->key, 1, "avg_search_len", search_stats.mean, LOWER_IS_BETTER);
+        report_metric("fragmentation", backend->key, 1, "mean_ms", time_stats.mean, LOWER_IS_BETTER);
+    }
+}
+
+/**
+ * @brief Allocates a random-sized block, writes it and frees it again.
+ */
+static void alloc_free_cycle(const AllocatorBackend* backend) {
+    size_t size = 64 + (rand() % 192);
+    void* ptr = backend->alloc(size);
+
+    // Use the memory (write to it)
+    if (ptr) {
+        memset(ptr, 0xAA, size);
     }
+
+    backend->free(ptr);
 }
 
 /**
@@ -268,44 +390,58 @@ void benchmark_fragmentation() {
  */
 void benchmark_allocation_cycles() {
     print_section("BENCHMARK 4: Allocation/Deallocation Cycles");
-    printf("Performing 500 alloc/free cycles\n");
+    text_printf("Performing 500 alloc/free cycles\n");
 
-    const char* strategy_names[] = {"First-Fit", "Best-Fit", "Worst-Fit"};
-    AllocationStrategy strategies[] = {FIRST_FIT, BEST_FIT, WORST_FIT};
+    // Per-cycle latencies of every measured trial, in nanoseconds
+    static double latencies[MAX_TRIALS * LARGE_ALLOC_COUNT];
+    double p99[MAX_BACKENDS];
 
     print_table_header();
 
-    for (int s = 0; s < 3; s++) {
-        double times[NUM_TRIALS];
+    for (int b = 0; b < num_active_backends; b++) {
+        const AllocatorBackend* backend = active_backends[b];
+        double times[MAX_RUNS];
+        int num_latencies = 0;
 
-        for (int trial = 0; trial < NUM_TRIALS; trial++) {
-            reset_allocator();
-            set_allocation_strategy(strategies[s]);
+        for (int run = 0; run < total_runs(); run++) {
+            int trial = run - warmup_trials;  // negative during warm-up runs
+            backend->reset();
             srand(200 + trial);
 
-            clock_t start = clock();
+            double start = now_ms();
 
             for (int cycle = 0; cycle < LARGE_ALLOC_COUNT; cycle++) {
-                // Allocate
-                size_t size = 64 + (rand() % 192);
-                void* ptr = heap_alloc(size);
+                alloc_free_cycle(backend);
+            }
 
-                // Use the memory (write to it)
-                if (ptr) {
-                    memset(ptr, 0xAA, size);
+            double end = now_ms();
+            times[run] = end - start;
+
+            // Per-cycle latencies come from a second, identical pass so that reading the
+            // clock around every cycle does not count against the throughput above
+            if (trial >= 0) {
+                backend->reset();
+                srand(200 + trial);
+                for (int cycle = 0; cycle < LARGE_ALLOC_COUNT; cycle++) {
+                    double cycle_start = now_ms();
+                    alloc_free_cycle(backend);
+                    latencies[num_latencies++] = (now_ms() - cycle_start) * 1000000.0;
                 }
-
-                // Free immediately
-                heap_free(ptr);
             }
-
-            clock_t end = clock();
-            times[trial] = ((double)(end - start) / CLOCKS_PER_SEC) * 1000.0;
         }
 
-        Stats stats = calculate_stats(times, NUM_TRIALS);
-        print_table_row(strategy_names[s], stats, LARGE_ALLOC_COUNT * 2);
+        Stats stats = measured_stats(times);
+        print_table_row("allocation_cycles", backend, stats, LARGE_ALLOC_COUNT * 2);
+
+        p99[b] = percentile(latencies, num_latencies, 99.0);
+        report_metric("allocation_cycles", backend->key, 1, "p99_ns", p99[b], LOWER_IS_BETTER);
     }
+
+    text_printf("\np99 alloc+free latency (ns):");
+    for (int b = 0; b < num_active_backends; b++) {
+        text_printf("%s %s %.0f", b > 0 ? "," : "", active_backends[b]->name, p99[b]);
+    }
+    text_printf("\n");
 }
 
 /**
@@ -314,40 +450,37 @@ void benchmark_allocation_cycles() {
  */
 void benchmark_reallocation() {
     print_section("BENCHMARK 5: Reallocation Performance");
-    printf("Growing allocations from 64 to 1024 bytes in steps\n");
-
-    const char* strategy_names[] = {"First-Fit", "Best-Fit", "Worst-Fit"};
-    AllocationStrategy strategies[] = {FIRST_FIT, BEST_FIT, WORST_FIT};
+    text_printf("Growing allocations from 64 to 1024 bytes in steps\n");
 
     print_table_header();
 
-    for (int s = 0; s < 3; s++) {
-        double times[NUM_TRIALS];
+    for (int b = 0; b < num_active_backends; b++) {
+        const AllocatorBackend* backend = active_backends[b];
+        double times[MAX_RUNS];
 
-        for (int trial = 0; trial < NUM_TRIALS; trial++) {
-            reset_allocator();
-            set_allocation_strategy(strategies[s]);
+        for (int run = 0; run < total_runs(); run++) {
+            backend->reset();
 
-            clock_t start = clock();
+            double start = now_ms();
 
             for (int i = 0; i < 200; i++) {
-                void* ptr = heap_alloc(64);
+                void* ptr = backend->alloc(64);
 
                 // Grow in steps
-                ptr = heap_realloc(ptr, 128);
-                ptr = heap_realloc(ptr, 256);
-                ptr = heap_realloc(ptr, 512);
-                ptr = heap_realloc(ptr, 1024);
+                ptr = backend->realloc(ptr, 128);
+                ptr = backend->realloc(ptr, 256);
+                ptr = backend->realloc(ptr, 512);
+                ptr = backend->realloc(ptr, 1024);
 
-                heap_free(ptr);
+                backend->free(ptr);
             }
 
-            clock_t end = clock();
-            times[trial] = ((double)(end - start) / CLOCKS_PER_SEC) * 1000.0;
+            double end = now_ms();
+            times[run] = end - start;
         }
 
-        Stats stats = calculate_stats(times, NUM_TRIALS);
-        print_table_row(strategy_names[s], stats, 200 * 5);
+        Stats stats = measured_stats(times);
+        print_table_row("reallocation", backend, stats, 200 * 5);
     }
 }
 
@@ -357,25 +490,22 @@ void benchmark_reallocation() {
  */
 void benchmark_worst_case() {
     print_section("BENCHMARK 6: Worst-Case Scenario");
-    printf("Alternating alloc/free pattern creating maximum fragmentation\n");
+    text_printf("Alternating alloc/free pattern creating maximum fragmentation\n");
 
-    const char* strategy_names[] = {"First-Fit", "Best-Fit", "Worst-Fit"};
-    AllocationStrategy strategies[] = {FIRST_FIT, BEST_FIT, WORST_FIT};
+    text_printf("\n%-15s | %-12s | %-12s | %-15s\n",
+           "Backend", "Time (ms)", "Frag Ratio", "Failed Allocs");
+    text_printf("----------------+-------------+-------------+----------------\n");
 
-    printf("\n%-15s | %-12s | %-12s | %-15s\n",
-           "Strategy", "Time (ms)", "Frag Ratio", "Failed Allocs");
-    printf("----------------+-------------+-------------+----------------\n");
+    for (int b = 0; b < num_active_backends; b++) {
+        const AllocatorBackend* backend = active_backends[b];
+        double times[MAX_RUNS];
+        double frag_ratios[MAX_RUNS];
+        double failures[MAX_RUNS];
 
-    for (int s = 0; s < 3; s++) {
-        double times[NUM_TRIALS];
-        double frag_ratios[NUM_TRIALS];
-        double failures[NUM_TRIALS];
+        for (int run = 0; run < total_runs(); run++) {
+            backend->reset();
 
-        for (int trial = 0; trial < NUM_TRIALS; trial++) {
-            reset_allocator();
-            set_allocation_strategy(strategies[s]);
-
-            clock_t start = clock();
+            double start = now_ms();
 
             void* ptrs[300];
             int fail_count = 0;
@@ -383,43 +513,45 @@ void benchmark_worst_case() {
             // Allocate alternating sizes
             for (int i = 0; i < 300; i++) {
                 size_t size = (i % 2 == 0) ? 32 : 512;
-                ptrs[i] = heap_alloc(size);
+                ptrs[i] = backend->alloc(size);
                 if (!ptrs[i]) fail_count++;
             }
 
             // Free every other block (creates checkerboard pattern)
             for (int i = 0; i < 300; i += 2) {
-                if (ptrs[i]) heap_free(ptrs[i]);
+                if (ptrs[i]) backend->free(ptrs[i]);
             }
 
             // Try to allocate medium blocks (will struggle to find space)
             for (int i = 0; i < 50; i++) {
-                void* ptr = heap_alloc(256);
+                void* ptr = backend->alloc(256);
                 if (!ptr) fail_count++;
-                else heap_free(ptr);
+                else backend->free(ptr);
             }
 
-            clock_t end = clock();
+            double end = now_ms();
 
-            times[trial] = ((double)(end - start) / CLOCKS_PER_SEC) * 1000.0;
-            frag_ratios[trial] = get_fragmentation_ratio();
-            failures[trial] = fail_count;
+            times[run] = end - start;
+            frag_ratios[run] = backend->fragmentation ? backend->fragmentation() : NAN;
+            failures[run] = fail_count;
 
             // Cleanup
             for (int i = 1; i < 300; i += 2) {
-                if (ptrs[i]) heap_free(ptrs[i]);
+                if (ptrs[i]) backend->free(ptrs[i]);
             }
         }
 
-        Stats time_stats = calculate_stats(times, NUM_TRIALS);
-        Stats frag_stats = calculate_stats(frag_ratios, NUM_TRIALS);
-        Stats fail_stats = calculate_stats(failures, NUM_TRIALS);
+        Stats time_stats = measured_stats(times);
+        Stats frag_stats = measured_stats(frag_ratios);
+        Stats fail_stats = measured_stats(failures);
+
+        text_printf("%-15s | %12.4f | ", backend->name, time_stats.mean);
+        print_metric(frag_stats.mean, 12, 4);
+        text_printf(" | %15.0f\n", fail_stats.mean);
 
-        printf("%-15s | %12.4f | %12.4f | %15.0f\n",
-               strategy_names[s],
-               time_stats.mean,
-               frag_stats.mean,
-               fail_stats.mean);
+        report_metric("worst_case", backend->key, 1, "mean_ms", time_stats.mean, LOWER_IS_BETTER);
+        report_metric("worst_case", backend->key, 1, "fragmentation_ratio", frag_stats.mean, HIGHER_IS_BETTER);
+        report_metric("worst_case", backend->key, 1, "failed_allocs", fail_stats.mean, LOWER_IS_BETTER);
     }
 }
 
@@ -429,18 +561,15 @@ void benchmark_worst_case() {
  */
 void benchmark_memory_efficiency() {
     print_section("BENCHMARK 7: Memory Efficiency Analysis");
-    printf("Analyzing memory overhead and utilization\n");
-
-    const char* strategy_names[] = {"First-Fit", "Best-Fit", "Worst-Fit"};
-    AllocationStrategy strategies[] = {FIRST_FIT, BEST_FIT, WORST_FIT};
+    text_printf("Analyzing memory overhead and utilization\n");
 
-    printf("\n%-15s | %-12s | %-12s | %-12s\n",
-           "Strategy", "Overhead %%", "Utilization", "Waste (bytes)");
-    printf("----------------+-------------+-------------+-------------\n");
+    text_printf("\n%-15s | %-12s | %-12s | %-12s\n",
+           "Backend", "Overhead %", "Utilization", "Waste (bytes)");
+    text_printf("----------------+-------------+-------------+-------------\n");
 
-    for (int s = 0; s < 3; s++) {
-        reset_allocator();
-        set_allocation_strategy(strategies[s]);
+    for (int b = 0; b < num_active_backends; b++) {
+        const AllocatorBackend* backend = active_backends[b];
+        backend->reset();
         srand(300);
 
         size_t total_requested = 0;
@@ -450,57 +579,180 @@ void benchmark_memory_efficiency() {
         for (int i = 0; i < 400; i++) {
             size_t size = 32 + (rand() % 256);
             total_requested += size;
-            ptrs[i] = heap_alloc(size);
+            ptrs[i] = backend->alloc(size);
         }
 
-        size_t used = get_used_heap_size();
-        size_t overhead = used - total_requested;
-        double overhead_pct = ((double)overhead / total_requested) * 100.0;
-        double utilization = ((double)total_requested / used) * 100.0;
-
-        printf("%-15s | %11.2f%% | %11.2f%% | %12zu\n",
-               strategy_names[s],
-               overhead_pct,
-               utilization,
-               overhead);
+        if (backend->block_size != NULL) {
+            size_t used = 0;
+            for (int i = 0; i < 400; i++) {
+                if (ptrs[i]) used += backend->block_size(ptrs[i]);
+            }
+            size_t overhead = used - total_requested;
+            double overhead_pct = ((double)overhead / total_requested) * 100.0;
+            double utilization = ((double)total_requested / used) * 100.0;
+
+            text_printf("%-15s | %11.2f%% | %11.2f%% | %12zu\n",
+                   backend->name,
+                   overhead_pct,
+                   utilization,
+                   overhead);
+
+            report_metric("memory_efficiency", backend->key, 1, "overhead_pct", overhead_pct, LOWER_IS_BETTER);
+            report_metric("memory_efficiency", backend->key, 1, "utilization_pct", utilization, HIGHER_IS_BETTER);
+            report_metric("memory_efficiency", backend->key, 1, "waste_bytes", (double)overhead, LOWER_IS_BETTER);
+        } else {
+            text_printf("%-15s | %12s | %12s | %12s\n", backend->name, "n/a", "n/a", "n/a");
+        }
 
         // Cleanup
         for (int i = 0; i < 400; i++) {
-            if (ptrs[i]) heap_free(ptrs[i]);
+            if (ptrs[i]) backend->free(ptrs[i]);
         }
     }
 }
 
-int main() {
-    printf(ANSI_COLOR_MAGENTA ANSI_BOLD);
+// Backends the benchmarks run against (all of them unless --backend is given)
+const AllocatorBackend* active_backends[MAX_BACKENDS];
+int num_active_backends = 0;
+
+// Print command line usage
+static void print_usage(const char* prog) {
+    printf("Usage: %s [--threads N] [--st | --mt] [--backend NAME]... [--trials N] [--warmup N] "
+           "[--fit-kernel K] [--json | --csv]\n", prog);
+    printf("  --threads N  Largest thread count for the multi-threaded scaling curves (default %d)\n",
+           DEFAULT_MAX_THREADS);
+    printf("  --st         Run only the single-threaded benchmarks\n");
+    printf("  --mt         Run only the multi-threaded benchmarks\n");
+    printf("  --backend N  Run against backend N only (repeatable):");
+    for (int i = 0; i < num_backends; i++) {
+        printf(" %s", backends[i].key);
+    }
     printf("\n");
-    printf("╔═══════════════════════════════════════════════════════════╗\n");
-    printf("║                                                           ║\n");
-    printf("║      MEMORY ALLOCATOR COMPREHENSIVE BENCHMARK SUITE      ║\n");
-    printf("║                                                           ║\n");
-    printf("╚═══════════════════════════════════════════════════════════╝\n");
-    printf(ANSI_COLOR_RESET);
+    printf("  --trials N   Measured trials per benchmark, 1-%d (default %d)\n", MAX_TRIALS, DEFAULT_TRIALS);
+    printf("  --warmup N   Discarded warm-up runs before the trials, 0-%d (default %d)\n",
+           MAX_WARMUP_TRIALS, DEFAULT_WARMUP_TRIALS);
+    printf("  --fit-kernel K  Side-table fit kernel: scalar, sse2 or avx2 (default: widest supported)\n");
+    printf("  --json       Write results as a JSON array of metric records\n");
+    printf("  --csv        Write results as CSV metric records\n");
+}
 
-    printf("\nHeap Capacity: %d KB\n", HEAP_CAPACITY / 1024);
-    printf("Trials per benchmark: %d\n", NUM_TRIALS);
-    printf("Allocation Strategies: First-Fit, Best-Fit, Worst-Fit\n");
+int main(int argc, char* argv[]) {
+    int max_threads = DEFAULT_MAX_THREADS;
+    bool run_st = true;
+    bool run_mt = true;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            max_threads = atoi(argv[++i]);
+            if (max_threads < 1 || max_threads > MAX_THREADS) {
+                fprintf(stderr, "Thread count must be between 1 and %d\n", MAX_THREADS);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--trials") == 0 && i + 1 < argc) {
+            num_trials = atoi(argv[++i]);
+            if (num_trials < 1 || num_trials > MAX_TRIALS) {
+                fprintf(stderr, "Trial count must be between 1 and %d\n", MAX_TRIALS);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            warmup_trials = atoi(argv[++i]);
+            if (warmup_trials < 0 || warmup_trials > MAX_WARMUP_TRIALS) {
+                fprintf(stderr, "Warm-up count must be between 0 and %d\n", MAX_WARMUP_TRIALS);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--fit-kernel") == 0 && i + 1 < argc) {
+            const char* name = argv[++i];
+            FitKernel kernel = strcmp(name, "scalar") == 0 ? FIT_KERNEL_SCALAR :
+                               strcmp(name, "sse2") == 0   ? FIT_KERNEL_SSE2 :
+                               strcmp(name, "avx2") == 0   ? FIT_KERNEL_AVX2 : FIT_KERNEL_AUTO;
+            if (kernel == FIT_KERNEL_AUTO || !set_fit_kernel(kernel)) {
+                fprintf(stderr, "Unknown or unsupported fit kernel: %s\n", name);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--json") == 0) {
+            output_format = OUTPUT_JSON;
+        } else if (strcmp(argv[i], "--csv") == 0) {
+            output_format = OUTPUT_CSV;
+        } else if (strcmp(argv[i], "--st") == 0) {
+            run_mt = false;
+        } else if (strcmp(argv[i], "--mt") == 0) {
+            run_st = false;
+        } else if (strcmp(argv[i], "--backend") == 0 && i + 1 < argc) {
+            const AllocatorBackend* backend = find_backend(argv[++i]);
+            if (backend == NULL) {
+                fprintf(stderr, "Unknown backend: %s\n", argv[i]);
+                print_usage(argv[0]);
+                return 1;
+            }
+            if (num_active_backends < MAX_BACKENDS) {
+                active_backends[num_active_backends++] = backend;
+            }
+        } else {
+            print_usage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+
+    if (num_active_backends == 0) {
+        for (int i = 0; i < num_backends && i < MAX_BACKENDS; i++) {
+            active_backends[num_active_backends++] = &backends[i];
+        }
+    }
+
+    begin_report();
+
+    text_printf(ANSI_COLOR_MAGENTA ANSI_BOLD);
+    text_printf("\n");
+    text_printf("╔═══════════════════════════════════════════════════════════╗\n");
+    text_printf("║                                                           ║\n");
+    text_printf("║      MEMORY ALLOCATOR COMPREHENSIVE BENCHMARK SUITE      ║\n");
+    text_printf("║                                                           ║\n");
+    text_printf("╚═══════════════════════════════════════════════════════════╝\n");
+    text_printf(ANSI_COLOR_RESET);
+
+    text_printf("\nHeap Capacity: %d KB\n", HEAP_CAPACITY / 1024);
+    text_printf("Trials per benchmark: %d (+%d warm-up)\n", num_trials, warmup_trials);
+    text_printf("Side-table fit kernel: %s\n", get_fit_kernel_name());
+    text_printf("Backends:");
+    for (int i = 0; i < num_active_backends; i++) {
+        text_printf("%s %s", i > 0 ? "," : "", active_backends[i]->name);
+    }
+    text_printf("\n");
+    if (run_mt) {
+        text_printf("Max threads: %d\n", max_threads);
+    }
 
     // Run all benchmarks
-    benchmark_sequential_allocation();
-    benchmark_random_size_allocation();
-    benchmark_fragmentation();
-    benchmark_allocation_cycles();
-    benchmark_reallocation();
-    benchmark_worst_case();
-    benchmark_memory_efficiency();
+    if (run_st) {
+        benchmark_sequential_allocation();
+        benchmark_random_size_allocation();
+        benchmark_fragmentation();
+        benchmark_allocation_cycles();
+        benchmark_reallocation();
+        benchmark_worst_case();
+        benchmark_memory_efficiency();
+    }
+    if (run_mt) {
+        benchmark_larson(max_threads);
+        benchmark_threadtest(max_threads);
+        benchmark_producer_consumer(max_threads);
+        benchmark_cache_scratch(max_threads);
+    }
 
     // Summary
     print_section("BENCHMARK SUMMARY");
-    printf(ANSI_COLOR_GREEN "✓ All benchmarks completed successfully!\n" ANSI_COLOR_RESET);
-    printf("\nKey Findings:\n");
-    printf("  • First-Fit: Fastest allocation, moderate fragmentation\n");
-    printf("  • Best-Fit: Slowest but lowest fragmentation\n");
-    printf("  • Worst-Fit: Fast but highest fragmentation\n\n");
+    text_printf(ANSI_COLOR_GREEN "✓ All benchmarks completed successfully!\n" ANSI_COLOR_RESET);
+    text_printf("\nKey Findings:\n");
+    text_printf("  • First-Fit: Fastest allocation, moderate fragmentation\n");
+    text_printf("  • Best-Fit: Slowest but lowest fragmentation\n");
+    text_printf("  • Worst-Fit: Fast but highest fragmentation\n");
+    text_printf("  • Next-Fit: Shortest searches, spreads allocations across the heap\n");
+    text_printf("  • Bitmap: No block headers, lowest overhead for small allocations\n");
+    text_printf("  • Buddy: O(log n) bounded operations, power-of-two rounding waste\n");
+    text_printf("  • glibc malloc: Baseline system allocator for comparison\n");
+    text_printf("  • Threads: all heap operations serialize on one heap mutex\n\n");
+
+    end_report();
 
     return 0;
 }
@@ -0,0 +1,113 @@
+/**
+ * @file benchmark.h
+ * @brief Shared definitions for the allocator benchmark suites.
+ *
+ * Declares the helpers implemented in benchmark.c (allocator reset, statistics and
+ * section formatting) so the single-threaded and multi-threaded suites print and
+ * measure results the same way.
+ */
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <stddef.h>
+
+#define ANSI_COLOR_CYAN    "\x1b[36m"
+#define ANSI_COLOR_GREEN   "\x1b[32m"
+#define ANSI_COLOR_YELLOW  "\x1b[33m"
+#define ANSI_COLOR_BLUE    "\x1b[34m"
+#define ANSI_COLOR_MAGENTA "\x1b[35m"
+#define ANSI_COLOR_RESET   "\x1b[0m"
+#define ANSI_BOLD          "\x1b[1m"
+
+// Benchmark configuration
+#define DEFAULT_TRIALS 5
+#define DEFAULT_WARMUP_TRIALS 1
+#define MAX_TRIALS 100
+#define MAX_WARMUP_TRIALS 20
+#define MAX_RUNS (MAX_TRIALS + MAX_WARMUP_TRIALS)
+#define SMALL_ALLOC_COUNT 1000
+#define LARGE_ALLOC_COUNT 500
+#define MIXED_ALLOC_COUNT 750
+
+// Upper bound on registered backends
+#define MAX_BACKENDS 16
+
+// Default upper bound for the multi-threaded scaling curves
+#define DEFAULT_MAX_THREADS 4
+#define MAX_THREADS 64
+
+// Output format for results
+typedef enum {
+    OUTPUT_TEXT,    // Colored tables for humans
+    OUTPUT_JSON,    // One JSON array of metric records
+    OUTPUT_CSV,     // One CSV row per metric record
+} OutputFormat;
+
+// Whether larger or smaller values of a metric are better
+typedef enum {
+    HIGHER_IS_BETTER,
+    LOWER_IS_BETTER,
+} MetricDirection;
+
+// Summary statistics over a set of trials
+typedef struct {
+    double mean;
+    double min;
+    double max;
+    double std_dev;
+} Stats;
+
+/**
+ * AllocatorBackend is the vtable every benchmark runs against. The statistics
+ * callbacks are NULL for backends that cannot report them.
+ */
+typedef struct {
+    const char* name;                           // Name shown in result tables
+    const char* key;                            // Name accepted by --backend
+    void (*reset)(void);                        // Start from an empty heap
+    void* (*alloc)(size_t size);
+    void (*free)(void* ptr);
+    void* (*realloc)(void* ptr, size_t size);
+    size_t (*block_size)(void* ptr);            // Bytes held for a live block, incl. overhead
+    double (*fragmentation)(void);              // get_fragmentation_ratio equivalent
+    size_t (*free_blocks)(void);                // Number of free blocks
+    size_t (*free_bytes)(void);                 // Bytes in free blocks
+    size_t (*searches)(void);                   // Fit searches since the last reset
+    size_t (*search_steps)(void);               // Entries those searches examined
+} AllocatorBackend;
+
+// Available backends (backends.c)
+extern const AllocatorBackend backends[];
+extern const int num_backends;
+const AllocatorBackend* find_backend(const char* key);
+
+// Backends selected on the command line (benchmark.c)
+extern const AllocatorBackend* active_backends[];
+extern int num_active_backends;
+
+// Run configuration (benchmark.c)
+extern int num_trials;
+extern int warmup_trials;
+extern OutputFormat output_format;
+
+// Shared helpers (benchmark.c)
+void reset_allocator();
+double now_ms();
+int total_runs();
+void text_printf(const char* format, ...);
+void print_section(const char* title);
+void print_subsection(const char* title);
+Stats calculate_stats(double* data, int count);
+Stats measured_stats(double* runs);
+double percentile(double* data, int count, double pct);
+void report_metric(const char* benchmark, const char* backend, int threads,
+                   const char* metric, double value, MetricDirection direction);
+
+// Multi-threaded benchmarks (mt_benchmark.c)
+void benchmark_larson(int max_threads);
+void benchmark_threadtest(int max_threads);
+void benchmark_producer_consumer(int max_threads);
+void benchmark_cache_scratch(int max_threads);
+
+#endif // BENCHMARK_H
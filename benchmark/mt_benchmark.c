@@ -0,0 +1,487 @@
+/**
+ * @file mt_benchmark.c
+ * @brief Multi-threaded benchmark suite for memory allocator
+ *
+ * This file contains the classic multi-threaded allocator benchmarks (larson,
+ * threadtest, producer-consumer cross-thread free, and cache-scratch) and reports
+ * throughput scaling curves for thread counts 1, 2, 4, ... up to a configurable maximum.
+ * The total amount of work is fixed per benchmark, so ideal scaling halves the time
+ * each time the thread count doubles.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include "allocator.h"
+#include "benchmark.h"
+
+// Larson configuration
+#define LARSON_TOTAL_SLOTS 1600
+#define LARSON_GENERATIONS 4
+#define LARSON_TOTAL_OPS 20000
+#define LARSON_MIN_SIZE 16
+#define LARSON_MAX_SIZE 128
+
+// Threadtest configuration
+#define THREADTEST_OBJECTS 4000
+#define THREADTEST_ITERATIONS 10
+#define THREADTEST_SIZE 64
+
+// Producer-consumer configuration
+#define PRODCONS_MESSAGES 20000
+#define PRODCONS_QUEUE_SIZE 256
+#define PRODCONS_MIN_SIZE 64
+#define PRODCONS_MAX_SIZE 512
+
+// Cache-scratch configuration
+#define SCRATCH_ITERATIONS 4000
+#define SCRATCH_WRITES 100
+#define SCRATCH_OBJ_SIZE 8
+#define CACHE_LINE_SIZE 64
+
+// Fills counts with 1, 2, 4, ... up to max_threads (always including max_threads)
+static int thread_counts(int max_threads, int* counts) {
+    int n = 0;
+    for (int t = 1; t < max_threads; t *= 2) {
+        counts[n++] = t;
+    }
+    counts[n++] = max_threads;
+    return n;
+}
+
+// Starts count threads running fn and waits for all of them
+static void run_threads(int count, void* (*fn)(void*), void* args, size_t arg_size) {
+    pthread_t threads[MAX_THREADS];
+    for (int i = 0; i < count; i++) {
+        pthread_create(&threads[i], NULL, fn, (char*)args + i * arg_size);
+    }
+    for (int i = 0; i < count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+// Print scaling table header
+static void print_scaling_header() {
+    text_printf("\n%-15s | %-8s | %-12s | %-12s | %-12s | %-12s | %-8s\n",
+           "Backend", "Threads", "Mean (ms)", "Min (ms)", "Max (ms)", "Ops/sec", "Speedup");
+    text_printf("----------------+----------+--------------+--------------+--------------+--------------+---------\n");
+}
+
+// Print scaling table row and report its metrics; speedup is relative to the backend's first row
+static void print_scaling_row(const char* benchmark, const AllocatorBackend* backend, int threads,
+                              Stats stats, int num_ops, double base_mean) {
+    double ops_per_sec = num_ops / (stats.mean / 1000.0);
+    text_printf("%-15s | %-8d | %12.4f | %12.4f | %12.4f | %12.0f | %7.2fx\n",
+           backend->name, threads, stats.mean, stats.min, stats.max, ops_per_sec, base_mean / stats.mean);
+    report_metric(benchmark, backend->key, threads, "mean_ms", stats.mean, LOWER_IS_BETTER);
+    report_metric(benchmark, backend->key, threads, "ops_per_sec", ops_per_sec, HIGHER_IS_BETTER);
+    report_metric(benchmark, backend->key, threads, "speedup", base_mean / stats.mean, HIGHER_IS_BETTER);
+}
+
+/**
+ * BENCHMARK 8: Larson Server Simulation
+ * Threads replace random blocks in their slot arrays; each generation of threads
+ * inherits the arrays of a different thread from the previous generation, so blocks
+ * are routinely freed by a thread other than the one that allocated them.
+ */
+typedef struct {
+    const AllocatorBackend* backend;
+    void** slots;
+    int slot_count;
+    int ops;
+    unsigned int seed;
+} LarsonArgs;
+
+static void* larson_worker(void* arg) {
+    LarsonArgs* args = (LarsonArgs*)arg;
+    for (int i = 0; i < args->ops; i++) {
+        int idx = rand_r(&args->seed) % args->slot_count;
+        if (args->slots[idx] != NULL) {
+            args->backend->free(args->slots[idx]);
+        }
+        size_t size = LARSON_MIN_SIZE + rand_r(&args->seed) % (LARSON_MAX_SIZE - LARSON_MIN_SIZE + 1);
+        args->slots[idx] = args->backend->alloc(size);
+        if (args->slots[idx] != NULL) {
+            memset(args->slots[idx], i & 0xFF, size);
+        }
+    }
+    return NULL;
+}
+
+void benchmark_larson(int max_threads) {
+    print_section("BENCHMARK 8: Larson Server Simulation");
+    text_printf("%d live slots, %d random replacements (%d-%d bytes) over %d thread generations\n",
+           LARSON_TOTAL_SLOTS, LARSON_TOTAL_OPS, LARSON_MIN_SIZE, LARSON_MAX_SIZE, LARSON_GENERATIONS);
+
+    int counts[MAX_THREADS];
+    int num_counts = thread_counts(max_threads, counts);
+    void** slots = malloc(LARSON_TOTAL_SLOTS * sizeof(void*));
+
+    print_scaling_header();
+
+    for (int b = 0; b < num_active_backends; b++) {
+        const AllocatorBackend* backend = active_backends[b];
+        double base_mean = 0;
+
+        for (int c = 0; c < num_counts; c++) {
+            int threads = counts[c];
+            int slots_per_thread = LARSON_TOTAL_SLOTS / threads;
+            int ops_per_thread = LARSON_TOTAL_OPS / (threads * LARSON_GENERATIONS);
+            double times[MAX_RUNS];
+
+            for (int run = 0; run < total_runs(); run++) {
+                int trial = run - warmup_trials;  // negative during warm-up runs
+                backend->reset();
+                unsigned int seed = 400 + trial;
+                for (int i = 0; i < LARSON_TOTAL_SLOTS; i++) {
+                    slots[i] = backend->alloc(LARSON_MIN_SIZE + rand_r(&seed) % (LARSON_MAX_SIZE - LARSON_MIN_SIZE + 1));
+                }
+
+                LarsonArgs args[MAX_THREADS];
+                double start = now_ms();
+                for (int gen = 0; gen < LARSON_GENERATIONS; gen++) {
+                    for (int t = 0; t < threads; t++) {
+                        int owner = (t + gen) % threads;  // hand arrays to a different thread
+                        args[t].backend = backend;
+                        args[t].slots = slots + owner * slots_per_thread;
+                        args[t].slot_count = slots_per_thread;
+                        args[t].ops = ops_per_thread;
+                        args[t].seed = seed + gen * MAX_THREADS + t;
+                    }
+                    run_threads(threads, larson_worker, args, sizeof(LarsonArgs));
+                }
+                times[run] = now_ms() - start;
+
+                for (int i = 0; i < LARSON_TOTAL_SLOTS; i++) {
+                    if (slots[i]) backend->free(slots[i]);
+                }
+            }
+
+            Stats stats = measured_stats(times);
+            if (c == 0) base_mean = stats.mean;
+            print_scaling_row("larson", backend, threads, stats,
+                              ops_per_thread * threads * LARSON_GENERATIONS * 2, base_mean);
+        }
+    }
+
+    free(slots);
+}
+
+/**
+ * BENCHMARK 9: Threadtest
+ * Each thread repeatedly allocates a batch of fixed-size objects and then frees the
+ * whole batch, with the batch size shrinking as threads are added.
+ */
+typedef struct {
+    const AllocatorBackend* backend;
+    void** ptrs;
+    int count;
+} ThreadtestArgs;
+
+static void* threadtest_worker(void* arg) {
+    ThreadtestArgs* args = (ThreadtestArgs*)arg;
+    for (int iter = 0; iter < THREADTEST_ITERATIONS; iter++) {
+        for (int i = 0; i < args->count; i++) {
+            args->ptrs[i] = args->backend->alloc(THREADTEST_SIZE);
+        }
+        for (int i = 0; i < args->count; i++) {
+            if (args->ptrs[i]) args->backend->free(args->ptrs[i]);
+        }
+    }
+    return NULL;
+}
+
+void benchmark_threadtest(int max_threads) {
+    print_section("BENCHMARK 9: Threadtest");
+    text_printf("%d iterations of allocating then freeing %d objects of %d bytes\n",
+           THREADTEST_ITERATIONS, THREADTEST_OBJECTS, THREADTEST_SIZE);
+
+    int counts[MAX_THREADS];
+    int num_counts = thread_counts(max_threads, counts);
+    void** ptrs = malloc(THREADTEST_OBJECTS * sizeof(void*));
+
+    print_scaling_header();
+
+    for (int b = 0; b < num_active_backends; b++) {
+        const AllocatorBackend* backend = active_backends[b];
+        double base_mean = 0;
+
+        for (int c = 0; c < num_counts; c++) {
+            int threads = counts[c];
+            int per_thread = THREADTEST_OBJECTS / threads;
+            double times[MAX_RUNS];
+
+            for (int run = 0; run < total_runs(); run++) {
+                backend->reset();
+
+                ThreadtestArgs args[MAX_THREADS];
+                for (int t = 0; t < threads; t++) {
+                    args[t].backend = backend;
+                    args[t].ptrs = ptrs + t * per_thread;
+                    args[t].count = per_thread;
+                }
+
+                double start = now_ms();
+                run_threads(threads, threadtest_worker, args, sizeof(ThreadtestArgs));
+                times[run] = now_ms() - start;
+            }
+
+            Stats stats = measured_stats(times);
+            if (c == 0) base_mean = stats.mean;
+            print_scaling_row("threadtest", backend, threads, stats,
+                              per_thread * threads * THREADTEST_ITERATIONS * 2, base_mean);
+        }
+    }
+
+    free(ptrs);
+}
+
+/**
+ * BENCHMARK 10: Producer-Consumer Cross-Thread Free
+ * Producers allocate messages and hand them through a bounded queue to a paired
+ * consumer, which reads and frees them. Every free happens on a foreign thread.
+ * A message whose allocation fails is counted and never sent, so throughput only
+ * counts messages that made the whole trip; a NULL item ends the queue.
+ */
+typedef struct {
+    void* items[PRODCONS_QUEUE_SIZE];
+    size_t head;
+    size_t tail;
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+} MessageQueue;
+
+typedef struct {
+    const AllocatorBackend* backend;
+    MessageQueue* queue;
+    int messages;
+    bool consumer;
+    unsigned int seed;
+    int failed;         // producer: allocations that failed, so no message was sent
+} ProdConsArgs;
+
+// Appends an item to a queue, waiting while it is full
+static void enqueue_message(MessageQueue* q, void* msg) {
+    pthread_mutex_lock(&q->mutex);
+    while (q->tail - q->head == PRODCONS_QUEUE_SIZE) {
+        pthread_cond_wait(&q->not_full, &q->mutex);
+    }
+    q->items[q->tail++ % PRODCONS_QUEUE_SIZE] = msg;
+    pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->mutex);
+}
+
+static void* producer_worker(void* arg) {
+    ProdConsArgs* args = (ProdConsArgs*)arg;
+    MessageQueue* q = args->queue;
+    for (int i = 0; i < args->messages; i++) {
+        size_t size = PRODCONS_MIN_SIZE + rand_r(&args->seed) % (PRODCONS_MAX_SIZE - PRODCONS_MIN_SIZE + 1);
+        unsigned char* msg = args->backend->alloc(size);
+        if (msg == NULL) {
+            args->failed++;
+            continue;
+        }
+        memset(msg, i & 0xFF, size);
+        enqueue_message(q, msg);
+    }
+    enqueue_message(q, NULL);
+    return NULL;
+}
+
+static void* consumer_worker(void* arg) {
+    ProdConsArgs* args = (ProdConsArgs*)arg;
+    MessageQueue* q = args->queue;
+    volatile unsigned char checksum = 0;
+    for (;;) {
+        pthread_mutex_lock(&q->mutex);
+        while (q->tail == q->head) {
+            pthread_cond_wait(&q->not_empty, &q->mutex);
+        }
+        unsigned char* msg = q->items[q->head++ % PRODCONS_QUEUE_SIZE];
+        pthread_cond_signal(&q->not_full);
+        pthread_mutex_unlock(&q->mutex);
+
+        if (msg == NULL) {
+            break;
+        }
+        checksum += msg[0];
+        args->backend->free(msg);
+    }
+    (void)checksum;
+    return NULL;
+}
+
+static void* prodcons_worker(void* arg) {
+    ProdConsArgs* args = (ProdConsArgs*)arg;
+    return args->consumer ? consumer_worker(arg) : producer_worker(arg);
+}
+
+void benchmark_producer_consumer(int max_threads) {
+    print_section("BENCHMARK 10: Producer-Consumer Cross-Thread Free");
+    text_printf("%d messages (%d-%d bytes) passed from producers to consumers that free them\n",
+           PRODCONS_MESSAGES, PRODCONS_MIN_SIZE, PRODCONS_MAX_SIZE);
+
+    int counts[MAX_THREADS];
+    int num_counts = thread_counts(max_threads < 2 ? 2 : max_threads, counts);
+
+    print_scaling_header();
+
+    for (int b = 0; b < num_active_backends; b++) {
+        const AllocatorBackend* backend = active_backends[b];
+        double base_mean = 0;
+        bool first_row = true;
+
+        for (int c = 0; c < num_counts; c++) {
+            if (counts[c] < 2) continue;  // a pair needs two threads
+            int pairs = counts[c] / 2;
+            int per_pair = PRODCONS_MESSAGES / pairs;
+            double times[MAX_RUNS];
+            double failures[MAX_RUNS];
+
+            for (int run = 0; run < total_runs(); run++) {
+                int trial = run - warmup_trials;  // negative during warm-up runs
+                backend->reset();
+
+                MessageQueue queues[MAX_THREADS / 2];
+                ProdConsArgs args[MAX_THREADS];
+                for (int p = 0; p < pairs; p++) {
+                    memset(&queues[p], 0, sizeof(MessageQueue));
+                    pthread_mutex_init(&queues[p].mutex, NULL);
+                    pthread_cond_init(&queues[p].not_empty, NULL);
+                    pthread_cond_init(&queues[p].not_full, NULL);
+                    for (int role = 0; role < 2; role++) {
+                        args[p * 2 + role].backend = backend;
+                        args[p * 2 + role].queue = &queues[p];
+                        args[p * 2 + role].messages = per_pair;
+                        args[p * 2 + role].consumer = role == 1;
+                        args[p * 2 + role].seed = 500 + trial * MAX_THREADS + p;
+                        args[p * 2 + role].failed = 0;
+                    }
+                }
+
+                double start = now_ms();
+                run_threads(pairs * 2, prodcons_worker, args, sizeof(ProdConsArgs));
+                times[run] = now_ms() - start;
+
+                failures[run] = 0;
+                for (int p = 0; p < pairs; p++) {
+                    failures[run] += args[p * 2].failed;
+                    pthread_mutex_destroy(&queues[p].mutex);
+                    pthread_cond_destroy(&queues[p].not_empty);
+                    pthread_cond_destroy(&queues[p].not_full);
+                }
+            }
+
+            Stats stats = measured_stats(times);
+            Stats fail_stats = measured_stats(failures);
+            if (first_row) {
+                base_mean = stats.mean;
+                first_row = false;
+            }
+            // Only delivered messages count: each is one allocation and one free
+            int delivered = per_pair * pairs - (int)fail_stats.mean;
+            print_scaling_row("producer_consumer", backend, pairs * 2, stats, delivered * 2, base_mean);
+            report_metric("producer_consumer", backend->key, pairs * 2, "failed_allocs", fail_stats.mean,
+                          LOWER_IS_BETTER);
+            if (fail_stats.mean > 0) {
+                text_printf("%-15s   %.0f of %d messages failed to allocate and were not sent\n",
+                            "", fail_stats.mean, per_pair * pairs);
+            }
+        }
+    }
+}
+
+/**
+ * BENCHMARK 11: Cache-Scratch (False Sharing)
+ * The main thread allocates one small object per thread back to back; each thread
+ * frees its object and then repeatedly allocates, writes and frees objects of the
+ * same size. An allocator that hands neighbouring threads memory on the same cache
+ * line makes every write ping-pong that line between cores.
+ */
+typedef struct {
+    const AllocatorBackend* backend;
+    void* initial;
+    int iterations;
+} ScratchArgs;
+
+static void* scratch_worker(void* arg) {
+    ScratchArgs* args = (ScratchArgs*)arg;
+    args->backend->free(args->initial);
+    for (int i = 0; i < args->iterations; i++) {
+        volatile char* obj = args->backend->alloc(SCRATCH_OBJ_SIZE);
+        if (obj == NULL) continue;
+        for (int w = 0; w < SCRATCH_WRITES; w++) {
+            obj[w % SCRATCH_OBJ_SIZE]++;
+        }
+        args->backend->free((void*)obj);
+    }
+    return NULL;
+}
+
+// Counts objects that share a cache line with another thread's object
+static int count_false_shared(void** objs, int count) {
+    int shared = 0;
+    for (int i = 0; i < count; i++) {
+        for (int j = 0; j < count; j++) {
+            if (i != j && (uintptr_t)objs[i] / CACHE_LINE_SIZE == (uintptr_t)objs[j] / CACHE_LINE_SIZE) {
+                shared++;
+                break;
+            }
+        }
+    }
+    return shared;
+}
+
+void benchmark_cache_scratch(int max_threads) {
+    print_section("BENCHMARK 11: Cache-Scratch (False Sharing)");
+    text_printf("%d alloc/write/free iterations of %d-byte objects, %d writes each\n",
+           SCRATCH_ITERATIONS, SCRATCH_OBJ_SIZE, SCRATCH_WRITES);
+
+    int counts[MAX_THREADS];
+    int num_counts = thread_counts(max_threads, counts);
+
+    print_scaling_header();
+
+    for (int b = 0; b < num_active_backends; b++) {
+        const AllocatorBackend* backend = active_backends[b];
+        double base_mean = 0;
+
+        for (int c = 0; c < num_counts; c++) {
+            int threads = counts[c];
+            int per_thread = SCRATCH_ITERATIONS / threads;
+            double times[MAX_RUNS];
+            int false_shared = 0;
+
+            for (int run = 0; run < total_runs(); run++) {
+                backend->reset();
+
+                ScratchArgs args[MAX_THREADS];
+                void* initial[MAX_THREADS];
+                for (int t = 0; t < threads; t++) {
+                    initial[t] = backend->alloc(SCRATCH_OBJ_SIZE);
+                    args[t].backend = backend;
+                    args[t].initial = initial[t];
+                    args[t].iterations = per_thread;
+                }
+                false_shared = count_false_shared(initial, threads);
+
+                double start = now_ms();
+                run_threads(threads, scratch_worker, args, sizeof(ScratchArgs));
+                times[run] = now_ms() - start;
+            }
+
+            Stats stats = measured_stats(times);
+            if (c == 0) base_mean = stats.mean;
+            print_scaling_row("cache_scratch", backend, threads, stats, per_thread * threads * 2, base_mean);
+            if (false_shared > 0) {
+                text_printf("%-15s   (%d of %d initial objects share a cache line with another thread)\n",
+                       "", false_shared, threads);
+            }
+        }
+    }
+}
@@ -0,0 +1,213 @@
+/**
+ * @file regression_check.c
+ * @brief Compares benchmark CSV results against a checked-in baseline.
+ *
+ * Both inputs are files written by `allocator_benchmark --csv`. Every metric named in
+ * one of the tolerance files is compared against the baseline in the direction its record
+ * declares (higher or lower is better); a metric that is worse than the baseline by
+ * more than its tolerance, or that is missing from the current results, is a
+ * regression. A diff report is printed and the exit status is 1 if anything regressed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define MAX_RECORDS 1024
+#define MAX_TOLERANCES 64
+#define MAX_FIELD 64
+#define MAX_LINE 512
+
+// One metric record from a benchmark CSV file
+typedef struct {
+    char benchmark[MAX_FIELD];
+    char backend[MAX_FIELD];
+    int threads;
+    char metric[MAX_FIELD];
+    double value;
+    bool higher_is_better;
+} Record;
+
+// Allowed relative change (in percent) for a gated metric
+typedef struct {
+    char metric[MAX_FIELD];
+    double tolerance_pct;
+} Tolerance;
+
+// Copies the next comma-separated field of *line into out and advances *line
+static void next_field(char** line, char* out) {
+    char* end = strchr(*line, ',');
+    size_t len = end ? (size_t)(end - *line) : strcspn(*line, "\r\n");
+    if (len >= MAX_FIELD) {
+        len = MAX_FIELD - 1;
+    }
+    memcpy(out, *line, len);
+    out[len] = '\0';
+    *line = end ? end + 1 : *line + len;
+}
+
+/**
+ * @brief Reads metric records from a benchmark CSV file.
+ *
+ * @param filename Path to a file written by `allocator_benchmark --csv`.
+ * @param records Array that receives the records.
+ *
+ * @return Number of records read, or -1 if the file could not be opened.
+ */
+static int load_records(const char* filename, Record* records) {
+    FILE* file = fopen(filename, "r");
+    if (file == NULL) {
+        return -1;
+    }
+
+    char line[MAX_LINE];
+    int count = 0;
+    while (fgets(line, sizeof(line), file) != NULL && count < MAX_RECORDS) {
+        if (strncmp(line, "benchmark,", 10) == 0 || line[0] == '\n') {
+            continue;  // Header or blank line
+        }
+        char* cursor = line;
+        char field[MAX_FIELD];
+        Record* r = &records[count];
+        next_field(&cursor, r->benchmark);
+        next_field(&cursor, r->backend);
+        next_field(&cursor, field);
+        r->threads = atoi(field);
+        next_field(&cursor, r->metric);
+        next_field(&cursor, field);
+        r->value = atof(field);
+        next_field(&cursor, field);
+        r->higher_is_better = strcmp(field, "higher") == 0;
+        count++;
+    }
+
+    fclose(file);
+    return count;
+}
+
+/**
+ * @brief Reads "metric,tolerance_pct" lines; lines starting with '#' are comments.
+ *
+ * @param count Tolerances already in the array; the file's are appended after them.
+ *
+ * @return Number of tolerances now in the array, or -1 if the file could not be opened.
+ */
+static int load_tolerances(const char* filename, Tolerance* tolerances, int count) {
+    FILE* file = fopen(filename, "r");
+    if (file == NULL) {
+        return -1;
+    }
+
+    char line[MAX_LINE];
+    while (fgets(line, sizeof(line), file) != NULL && count < MAX_TOLERANCES) {
+        if (line[0] == '#' || line[0] == '\n' || strncmp(line, "metric,", 7) == 0) {
+            continue;
+        }
+        char* cursor = line;
+        char field[MAX_FIELD];
+        next_field(&cursor, tolerances[count].metric);
+        next_field(&cursor, field);
+        tolerances[count].tolerance_pct = atof(field);
+        count++;
+    }
+
+    fclose(file);
+    return count;
+}
+
+// Finds the record matching base's (benchmark, backend, threads, metric) key
+static const Record* find_record(const Record* records, int count, const Record* base) {
+    for (int i = 0; i < count; i++) {
+        if (records[i].threads == base->threads &&
+            strcmp(records[i].metric, base->metric) == 0 &&
+            strcmp(records[i].backend, base->backend) == 0 &&
+            strcmp(records[i].benchmark, base->benchmark) == 0) {
+            return &records[i];
+        }
+    }
+    return NULL;
+}
+
+static const Tolerance* find_tolerance(const Tolerance* tolerances, int count, const char* metric) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(tolerances[i].metric, metric) == 0) {
+            return &tolerances[i];
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 4) {
+        fprintf(stderr, "Usage: %s BASELINE.csv CURRENT.csv TOLERANCES.csv...\n", argv[0]);
+        return 2;
+    }
+
+    static Record baseline[MAX_RECORDS];
+    static Record current[MAX_RECORDS];
+    Tolerance tolerances[MAX_TOLERANCES];
+
+    int num_baseline = load_records(argv[1], baseline);
+    int num_current = load_records(argv[2], current);
+    if (num_baseline < 0 || num_current < 0) {
+        fprintf(stderr, "Could not read %s\n", num_baseline < 0 ? argv[1] : argv[2]);
+        return 2;
+    }
+    int num_tolerances = 0;
+    for (int i = 3; i < argc; i++) {
+        num_tolerances = load_tolerances(argv[i], tolerances, num_tolerances);
+        if (num_tolerances < 0) {
+            fprintf(stderr, "Could not read %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    int checked = 0;
+    int regressions = 0;
+
+    printf("%-24s %-10s %3s %-20s %14s %14s %9s %7s  %s\n",
+           "Benchmark", "Backend", "Thr", "Metric", "Baseline", "Current", "Change", "Limit", "Status");
+
+    for (int i = 0; i < num_baseline; i++) {
+        const Record* base = &baseline[i];
+        const Tolerance* tolerance = find_tolerance(tolerances, num_tolerances, base->metric);
+        if (tolerance == NULL) {
+            continue;  // Metric is not gated
+        }
+        checked++;
+
+        const Record* cur = find_record(current, num_current, base);
+        if (cur == NULL) {
+            printf("%-24s %-10s %3d %-20s %14.6g %14s %9s %6.1f%%  MISSING\n",
+                   base->benchmark, base->backend, base->threads, base->metric,
+                   base->value, "-", "-", tolerance->tolerance_pct);
+            regressions++;
+            continue;
+        }
+
+        // Change expressed so that positive always means "worse"
+        double change_pct = 0;
+        if (base->value != 0) {
+            change_pct = (cur->value - base->value) / base->value * 100.0;
+        } else if (cur->value != 0) {
+            change_pct = cur->value > 0 ? 100.0 : -100.0;
+        }
+        double worse_pct = base->higher_is_better ? -change_pct : change_pct;
+
+        const char* status = "ok";
+        if (worse_pct > tolerance->tolerance_pct) {
+            status = "REGRESSED";
+            regressions++;
+        } else if (worse_pct < -tolerance->tolerance_pct) {
+            status = "improved";
+        }
+
+        printf("%-24s %-10s %3d %-20s %14.6g %14.6g %+8.1f%% %6.1f%%  %s\n",
+               base->benchmark, base->backend, base->threads, base->metric,
+               base->value, cur->value, change_pct, tolerance->tolerance_pct, status);
+    }
+
+    printf("\n%d metrics checked, %d regressed\n", checked, regressions);
+    return regressions > 0 ? 1 : 0;
+}
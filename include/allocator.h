@@ -10,6 +10,7 @@
 
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 // Total capacity of simulated heap (in bytes)
 #define HEAP_CAPACITY 640000
@@ -17,13 +18,20 @@
 // Memory alignment boundary (in bytes)
 #define ALIGNMENT 16
 
+// Number of ALIGNMENT-sized granules in the heap
+#define HEAP_GRANULES (HEAP_CAPACITY / ALIGNMENT)
+
+// Number of buddy block orders; the largest block is ALIGNMENT << (BUDDY_ORDERS - 1) bytes
+#define BUDDY_ORDERS 16
+
 /**
  * BlockHeader represents a single block of memory in the heap.
  */
 typedef struct BlockHeader {
     size_t size;                // Size of the block (including header)
     bool free;                  // Is the block allocated?
-    struct BlockHeader* next;   // Pointer to the next block in the list
+    uint32_t canary;            // Keyed with a per-process secret and the block's offset
+    size_t next;                // Offset of the next block from the heap base (0 if last)
 } BlockHeader;
 
 /**
@@ -33,8 +41,19 @@ typedef enum {
     FIRST_FIT,
     BEST_FIT,
     WORST_FIT,
+    NEXT_FIT,       // First fit resuming from the block of the last allocation
+    BITMAP,         // Header-less blocks tracked in per-granule bitmaps (bitmap_strategy.c)
+    BUDDY,          // Power-of-two blocks with per-order free lists (buddy_strategy.c)
 } AllocationStrategy;
 
+/**
+ * Where fit searches and statistics read block metadata from.
+ */
+typedef enum {
+    METADATA_INLINE,        // Walk the block headers through their next links
+    METADATA_SIDE_TABLE,    // Scan dense per-granule arrays kept beside the heap
+} MetadataMode;
+
 /**
  * Status codes for allocation operations.
  */
@@ -49,14 +68,36 @@ typedef enum {
     ALLOC_HEAP_OK,             // Heap Success
 } AllocatorStatus;
 
-// Global state variables
-extern char heap[HEAP_CAPACITY];
-extern BlockHeader* first_block;
-extern size_t heap_size;
-extern AllocationStrategy current_strategy;
+/**
+ * An independent heap created over a caller-supplied buffer or a private mapping.
+ */
+typedef struct Allocator Allocator;
+
+/**
+ * HeapCorruption describes the first invariant violation found by the incremental verifier.
+ */
+typedef struct {
+    AllocatorStatus status;     // Status code for the violation
+    size_t offset;              // Offset of the offending block from the heap start
+    const char* reason;         // Which invariant was violated
+} HeapCorruption;
+
+/**
+ * A handle names a block that heap_compact may move; 0 (HANDLE_NONE) is never a handle.
+ */
+typedef uint32_t Handle;
+#define HANDLE_NONE 0
+
+// Handles that can be live at once
+#define HANDLE_CAPACITY 16384
+
+// Bytes at the start of a handle's block that hold its handle
+#define HANDLE_TAG_SIZE 8
 
 // Internal utilities
 size_t align(size_t alloc_size);
+BlockHeader* block_next(BlockHeader* block);
+void block_set_next(BlockHeader* block, BlockHeader* next);
 void coalesce_blocks(BlockHeader* header);
 void* split_block(BlockHeader* block_ptr, size_t total_size);
 
@@ -64,18 +105,103 @@ void* split_block(BlockHeader* block_ptr, size_t total_size);
 BlockHeader* find_fit_first(size_t requested_size);
 BlockHeader* find_fit_best(size_t requested_size);
 BlockHeader* find_fit_worst(size_t requested_size);
+BlockHeader* find_fit_next(size_t requested_size);
+
+// Process heap mutex (recursive), for modules whose state the allocator's hooks update
+void heap_lock();
+void heap_unlock();
+
+// Process heap extent for the BITMAP and BUDDY modules; callers hold the heap mutex
+size_t heap_extent();
+void heap_set_extent(size_t size);
+
+// Bitmap strategy (bitmap_strategy.c); callers hold the heap mutex
+void* bitmap_alloc(size_t requested_bytes);
+void bitmap_free(void* ptr);
+void* bitmap_realloc(void* ptr, size_t new_size);
+bool bitmap_validate_pointer(void* ptr);
+size_t bitmap_block_size(void* ptr);
+size_t bitmap_totals(bool only_free, size_t* bytes);
+size_t bitmap_run_end(size_t offset, bool* used);
+bool bitmap_check_integrity();
+
+// Buddy strategy (buddy_strategy.c); callers hold the heap mutex
+void* buddy_alloc(size_t requested_bytes);
+void buddy_free(void* ptr);
+void* buddy_realloc(void* ptr, size_t new_size);
+bool buddy_validate_pointer(void* ptr);
+size_t buddy_block_size(void* ptr);
+size_t buddy_totals(bool only_free, size_t* bytes);
+size_t buddy_run_end(size_t offset, bool* used);
+size_t buddy_free_blocks(unsigned order);
+bool buddy_check_integrity();
 
 // Allocation and deallocation
 void* heap_alloc(size_t requested_bytes);
 void heap_free(void* ptr);
 void* heap_realloc(void* ptr, size_t new_size);
 
+// Allocator instances: isolated heaps with the same block layout and list strategies
+Allocator* allocator_create(void* buffer, size_t size);
+Allocator* allocator_create_mapped(size_t size);
+void allocator_destroy(Allocator* allocator);
+void allocator_reset(Allocator* allocator);
+void heap_reset();
+void* heap_alloc_in(Allocator* allocator, size_t requested_bytes);
+void heap_free_in(Allocator* allocator, void* ptr);
+void* heap_realloc_in(Allocator* allocator, void* ptr, size_t new_size);
+void set_allocation_strategy_in(Allocator* allocator, AllocationStrategy strategy);
+bool check_heap_integrity_in(Allocator* allocator);
+size_t get_used_heap_size_in(Allocator* allocator);
+size_t get_free_heap_size_in(Allocator* allocator);
+size_t get_heap_capacity_in(Allocator* allocator);
+
+// Persistent heaps: an allocator instance kept in a mapped file
+Allocator* heap_open(const char* path, size_t size);
+bool heap_sync(Allocator* allocator);
+void heap_set_root(Allocator* allocator, void* ptr);
+void* heap_get_root(Allocator* allocator);
+
+// Snapshots: the process heap's used prefix and state in a compact binary image
+size_t heap_snapshot(void* buffer, size_t capacity);
+bool heap_restore(const void* snapshot, size_t size);
+bool heap_snapshot_fd(int fd);
+bool heap_restore_fd(int fd);
+
+// Shared heaps: an allocator instance in shared memory, used by several processes at once
+Allocator* heap_open_shared(const char* name, size_t size);
+bool heap_unlink_shared(const char* name);
+size_t heap_offset_in(Allocator* allocator, void* ptr);
+void* heap_pointer_in(Allocator* allocator, size_t offset);
+
+// Handles: process-heap blocks that heap_compact may move while they are unlocked
+Handle handle_alloc(size_t size);
+void* handle_lock(Handle handle);
+void handle_unlock(Handle handle);
+void handle_free(Handle handle);
+size_t heap_compact();
+bool heap_compact_step(size_t max_bytes);
+
 // Heap Validation and configuration
 bool check_heap_integrity();
 bool validate_pointer(void* ptr);
 void defragment_heap();
 void set_last_status(AllocatorStatus status);
 void set_allocation_strategy(AllocationStrategy strategy);
+void set_metadata_mode(MetadataMode mode);
+AllocationStrategy get_allocation_strategy();
+MetadataMode get_metadata_mode();
+
+// Incremental verification
+bool heap_verify_step(size_t max_blocks);
+void heap_verify_set_budget(size_t blocks_per_op);
+bool heap_verify_get_corruption(HeapCorruption* out);
+void heap_verify_reset();
+
+// Process heap layout
+char* get_heap_base();
+size_t get_heap_size();
+BlockHeader* get_first_block();
 
 // Heap statistics
 size_t get_alloc_count();
@@ -83,11 +209,15 @@ size_t get_free_block_count();
 size_t get_used_heap_size();
 size_t get_free_heap_size();
 double get_fragmentation_ratio();
+size_t get_fit_search_count();
+size_t get_fit_search_steps();
 AllocatorStatus get_last_status();
 
 // Debugging and visualization
 void print_heap();
 void save_heap_state(const char* filename);
 void export_heap_json(const char* filename);
+void export_heap_ndjson(const char* filename);
+void export_heap_map(const char* filename);
 
 #endif // ALLOCATOR_H
@@ -0,0 +1,43 @@
+/**
+ * @file fit_kernels.h
+ * @brief Header file for the vectorized fit-search kernels.
+ *
+ * In side-table mode the sizes of free blocks live in a dense array of 16-bit entries
+ * (zero where no free block starts). Best fit and worst fit then reduce to a min or
+ * max over that array, which these kernels compute 8 (SSE2) or 16 (AVX2) entries per
+ * instruction. The kernel is chosen at runtime from the CPU's features, with a scalar
+ * fallback on every platform.
+ */
+
+#ifndef FIT_KERNELS_H
+#define FIT_KERNELS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Number of side table entries a kernel call reduces (one 64-bit free-map word)
+#define FIT_CHUNK_GRANULES 64
+
+// Returned by fit_chunk_min_at_least when no entry is large enough
+#define FIT_NO_ENTRY UINT16_MAX
+
+/**
+ * Instruction sets the fit kernels can use.
+ */
+typedef enum {
+    FIT_KERNEL_AUTO,      // Best kernel the CPU supports
+    FIT_KERNEL_SCALAR,    // Portable C loop
+    FIT_KERNEL_SSE2,      // 8 entries per instruction
+    FIT_KERNEL_AVX2,      // 16 entries per instruction
+} FitKernel;
+
+// Configuration
+bool set_fit_kernel(FitKernel kernel);
+FitKernel get_fit_kernel();
+const char* get_fit_kernel_name();
+
+// Kernels over FIT_CHUNK_GRANULES entries (the chunk must be 16-byte aligned)
+uint16_t fit_chunk_min_at_least(const uint16_t* chunk, uint16_t need);
+uint16_t fit_chunk_max(const uint16_t* chunk);
+
+#endif // FIT_KERNELS_H
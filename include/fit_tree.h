@@ -0,0 +1,31 @@
+/**
+ * @file fit_tree.h
+ * @brief Header file for the best-fit free block index.
+ *
+ * The index is an AVL tree of free blocks ordered by (size, address). Nodes are
+ * identified by the granule where their block starts, and the links live in arrays
+ * beside the heap, so even the smallest free block can be indexed. The leftmost node
+ * whose size is large enough is the address-ordered best fit, found in O(log n).
+ */
+
+#ifndef FIT_TREE_H
+#define FIT_TREE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Node id meaning "no node"
+#define FIT_TREE_NONE UINT16_MAX
+
+// Index maintenance
+void fit_tree_reset();
+void fit_tree_insert(uint16_t node, uint16_t granules);
+void fit_tree_remove(uint16_t node);
+void fit_tree_move(uint16_t node, uint16_t to, uint16_t granules);
+
+// Queries
+uint16_t fit_tree_best(uint16_t need, size_t* steps);
+uint16_t fit_tree_key(uint16_t node);
+size_t fit_tree_count();
+
+#endif // FIT_TREE_H
@@ -0,0 +1,37 @@
+/**
+ * @file pool.h
+ * @brief Header file for the fixed-size object pool.
+ *
+ * A pool hands out objects of one size from chunks taken from the heap. Free objects
+ * are kept on an intrusive LIFO list threaded through the objects themselves, so there
+ * is no per-object header and the most recently released (cache-warm) object is reused
+ * first. Pools are thread-safe; with magazines enabled, each thread also keeps a small
+ * private stack of objects so most gets and puts take no lock. A thread's magazine
+ * goes back to the shared list when the thread exits.
+ */
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// Objects a thread's magazine holds before half of them go back to the shared list
+#define POOL_MAGAZINE_SIZE 32
+
+typedef struct Pool Pool;
+
+// Lifetime
+Pool* pool_create(size_t obj_size, size_t objs_per_chunk);
+void pool_enable_magazines(Pool* pool);
+void pool_destroy(Pool* pool);
+
+// Objects
+void* pool_get(Pool* pool);
+void pool_put(Pool* pool, void* obj);
+
+// Statistics
+size_t pool_object_size(Pool* pool);
+size_t pool_chunk_count(Pool* pool);
+
+#endif // POOL_H
@@ -0,0 +1,45 @@
+/**
+ * @file profiler.h
+ * @brief Header file for the sampling heap profiler.
+ *
+ * The profiler samples roughly one allocation every N bytes, records the call stack of
+ * each sampled block and keeps live-bytes-by-stack aggregates that can be dumped as
+ * folded stacks (for flamegraphs) or as a pprof-compatible heap profile.
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// Default mean distance between samples (in bytes)
+#define PROFILER_DEFAULT_INTERVAL (512 * 1024)
+
+// Maximum number of frames recorded per sampled allocation
+#define PROFILER_MAX_DEPTH 32
+
+// Capacity of the stack and live-sample tables
+#define PROFILER_MAX_STACKS 1024
+#define PROFILER_MAX_SAMPLES 4096
+
+// Configuration
+void profiler_enable(size_t sample_interval);
+void profiler_disable();
+void profiler_reset();
+bool profiler_is_enabled();
+
+// Allocator hooks
+void profiler_record_alloc(void* ptr, size_t size);
+void profiler_record_free(void* ptr);
+
+// Statistics
+size_t profiler_live_samples();
+size_t profiler_live_bytes();
+size_t profiler_dropped_samples();
+
+// Output
+bool profiler_dump_folded(const char* filename);
+bool profiler_dump_pprof(const char* filename);
+
+#endif // PROFILER_H
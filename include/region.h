@@ -0,0 +1,36 @@
+/**
+ * @file region.h
+ * @brief Header file for the region (arena) allocator.
+ *
+ * A region hands out memory by bumping a pointer through chunks obtained from the
+ * heap, and releases everything it handed out at once. Objects that all die together,
+ * such as the allocations made while handling one request, then cost a pointer bump
+ * each and a handful of heap_free calls in total. A region is not thread-safe; give
+ * each thread or request its own.
+ */
+
+#ifndef REGION_H
+#define REGION_H
+
+#include <stddef.h>
+#include "allocator.h"
+
+// Default chunk size (in bytes, including the chunk header)
+#define REGION_DEFAULT_CHUNK_SIZE 4096
+
+typedef struct Region Region;
+
+// Lifetime
+Region* region_create(size_t chunk_size);
+Region* region_create_in(Allocator* allocator, size_t chunk_size);
+void region_reset(Region* region);
+void region_destroy(Region* region);
+
+// Allocation
+void* region_alloc(Region* region, size_t size);
+
+// Statistics
+size_t region_allocated_bytes(Region* region);
+size_t region_chunk_count(Region* region);
+
+#endif // REGION_H
@@ -3,15 +3,28 @@
  * @brief Implementation of a simple memory allocator.
  *
  * This file contains the implementation of a custom memory allocator that supports
- * various allocation strategies (first-fit, best-fit, worst-fit) and provides
+ * various allocation strategies (first-fit, best-fit, worst-fit, next-fit) and provides
  * functions for memory management, including allocation, deallocation,
  * reallocation, and heap integrity checks.
  */
 
+#define _XOPEN_SOURCE 700
+#define _DEFAULT_SOURCE
+
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "allocator.h"
+#include "fit_kernels.h"
+#include "fit_tree.h"
+#include "profiler.h"
 
 // Debug print macro: will print message if DEBUG is defined
 #ifdef DEBUG
@@ -20,11 +33,270 @@
     #define DEBUG_PRINT(...)
 #endif
 
-char heap[HEAP_CAPACITY] __attribute__((aligned(ALIGNMENT)));  // heap storage, aligned to 16 bytes
-size_t heap_size = 0;                                          // tracks heap size
-BlockHeader* first_block = NULL;                               // first heap block
-AllocationStrategy current_strategy = FIRST_FIT;               // default strategy
-static AllocatorStatus last_status = ALLOC_SUCCESS;            // default status code
+static char process_heap[HEAP_CAPACITY] __attribute__((aligned(ALIGNMENT)));  // process heap storage
+static __thread AllocatorStatus last_status = ALLOC_SUCCESS;   // per-thread status code
+
+static size_t verify_budget = 0;                                // blocks verified per operation (atomic)
+static bool verify_failed = false;                              // has a corruption been recorded? (atomic)
+static HeapCorruption verify_corruption;                        // first corruption found, in any heap
+static pthread_mutex_t verify_mutex = PTHREAD_MUTEX_INITIALIZER; // guards verify_corruption
+
+// Side table: one entry per 16-byte granule, non-zero only where a block starts
+#if HEAP_GRANULES > UINT16_MAX
+#error "Side table entries are 16 bits; HEAP_CAPACITY / ALIGNMENT must fit"
+#endif
+#define FREE_MAP_WORDS ((HEAP_GRANULES + 63) / 64)
+static uint16_t block_granules[HEAP_GRANULES];                  // block size in granules
+static uint16_t free_granules[FREE_MAP_WORDS * FIT_CHUNK_GRANULES]
+    __attribute__((aligned(64)));                               // block size in granules if free, else 0
+static uint64_t process_free_map[FREE_MAP_WORDS];
+static size_t side_table_granules = 0;                          // entries that may be non-zero
+
+// Explicit free list (inline mode): free blocks in address order, linked through their payloads
+#define FREE_LIST_END UINT32_MAX
+typedef struct {
+    uint32_t prev;                                              // heap offset of the previous free block
+    uint32_t next;                                              // heap offset of the next free block
+} FreeLinks;
+
+/**
+ * HeapState describes one heap: the process heap or an allocator instance. Operations
+ * work on the calling thread's active HeapState, which is the process heap's except
+ * while the thread is inside an *_in call, so threads using different heaps never see
+ * each other's state.
+ */
+typedef struct {
+    char* base;                 // start of the heap
+    size_t capacity;            // usable bytes at base
+    size_t size;                // bytes up to the end of the last block
+    BlockHeader* first;         // first block, NULL if the heap is empty
+    BlockHeader* last;          // block at the end of the heap
+    AllocationStrategy strategy;
+    MetadataMode mode;
+    uint64_t* map;              // bit set where a free block starts (both modes)
+    size_t map_words;           // words at map
+    uint32_t list_head;         // heap offset of the lowest free block (inline mode)
+    BlockHeader* verify_next;   // next block for heap_verify_step
+    BlockHeader* fit_next;      // block of the last allocation (NEXT_FIT)
+    BlockHeader* compact_next;  // next block for heap_compact_step, NULL at a pass start
+    size_t searches;            // fit searches since the heap was reset
+    size_t search_steps;        // metadata entries those searches examined
+    uint64_t secret;            // key for header canaries
+} HeapState;
+
+// The process heap
+static HeapState process_heap_state = {
+    .base = process_heap,
+    .capacity = HEAP_CAPACITY,
+    .strategy = FIRST_FIT,                                      // default strategy
+    .mode = METADATA_INLINE,
+    .map = process_free_map,
+    .map_words = FREE_MAP_WORDS,
+    .list_head = FREE_LIST_END,
+};
+
+// Heap the calling thread operates on: an instance inside *_in calls, else the process heap
+static __thread HeapState* active_heap = &process_heap_state;
+
+// The code below reads and writes the active heap's state through these names
+#define heap (active_heap->base)
+#define heap_capacity (active_heap->capacity)
+#define heap_size (active_heap->size)
+#define first_block (active_heap->first)
+#define last_block (active_heap->last)
+#define current_strategy (active_heap->strategy)
+#define metadata_mode (active_heap->mode)
+#define free_map (active_heap->map)
+#define free_map_words (active_heap->map_words)
+#define free_list_head (active_heap->list_head)
+#define verify_cursor (active_heap->verify_next)
+#define next_fit_cursor (active_heap->fit_next)
+#define compact_cursor (active_heap->compact_next)
+#define fit_searches (active_heap->searches)
+#define fit_search_steps (active_heap->search_steps)
+#define canary_secret (active_heap->secret)
+
+// Handles (process heap): entry i describes handle i + 1; released entries are chained
+// through their locks field, which counts outstanding handle_lock calls while in use
+#define HANDLE_UNUSED UINT32_MAX
+typedef struct {
+    uint32_t offset;                                            // heap offset of the block, or HANDLE_UNUSED
+    uint32_t locks;                                             // lock count, or next released entry
+} HandleEntry;
+static HandleEntry handle_table[HANDLE_CAPACITY];
+static uint32_t handle_count = 0;                               // entries handed out since the heap was reset
+static uint32_t handle_free_head = HANDLE_UNUSED;               // most recently released entry
+
+// Block after b, or NULL for the last block (see block_next)
+#define NEXT_BLOCK(b) ((b)->next == 0 ? NULL : (BlockHeader*)(heap + (b)->next))
+
+// Links b to n (see block_set_next); a block with no successor becomes last_block
+#define SET_NEXT_BLOCK(b, n) do {                                          \
+        BlockHeader* next_ = (n);                                          \
+        (b)->next = next_ == NULL ? 0 : (size_t)((char*)next_ - heap);     \
+        if (next_ == NULL) {                                               \
+            last_block = (b);                                              \
+        }                                                                  \
+    } while (0)
+
+// Identifies an initialized Allocator, e.g. at the start of a heap file
+#define HEAP_FILE_MAGIC 0x50414548u     // "HEAP"
+
+// Bumped whenever the Allocator or block layout changes, so old heap files are refused
+#define HEAP_LAYOUT_VERSION 3
+
+// Identifies a heap_snapshot image
+#define HEAP_SNAPSHOT_MAGIC 0x50414e53u // "SNAP"
+
+// Marks an unset cursor in a snapshot (offset 0 is the first block)
+#define SNAPSHOT_NO_BLOCK UINT64_MAX
+
+/**
+ * HeapSnapshot starts every heap_snapshot image. It is followed by the heap's used
+ * prefix (heap_size bytes) and the free_map words that cover it. Block pointers are
+ * stored as offsets, so an image restores into any process running the same build.
+ */
+typedef struct {
+    uint32_t magic;             // HEAP_SNAPSHOT_MAGIC
+    uint32_t layout_version;    // HEAP_LAYOUT_VERSION
+    uint64_t size;              // heap_size
+    uint64_t map_words;         // free_map words that follow the heap bytes
+    uint64_t last;              // offset of last_block
+    uint64_t fit_next;          // offset of next_fit_cursor, or SNAPSHOT_NO_BLOCK
+    uint64_t searches;
+    uint64_t search_steps;
+    uint64_t secret;            // canary secret the image was stamped with
+    uint32_t list_head;
+    uint8_t strategy;
+    uint8_t mode;
+    uint8_t padding[2];
+} HeapSnapshot;
+
+/**
+ * An independent heap over a caller-supplied buffer, an anonymous mapping, a mapped
+ * file or a shared memory object. The Allocator and its free-block bitmap sit at the
+ * start of the buffer, and the heap takes the rest. Everything the heap stores is an
+ * offset, so only the pointers in state need fixing when the heap is mapped at a new
+ * address. The magic is written last, so a heap whose magic is set is fully set up.
+ */
+struct Allocator {
+    uint32_t magic;             // HEAP_FILE_MAGIC
+    uint32_t layout_version;    // HEAP_LAYOUT_VERSION
+    size_t size;                // bytes from the Allocator to the end of the buffer
+    HeapState state;            // pointers are valid in the process that last bound the heap
+    size_t root;                // offset of the application's root object, 0 if unset
+    size_t mapped_size;         // length of the mapping to release, 0 for a caller buffer
+    bool shared;                // mapped by several processes at once
+    pthread_mutex_t mutex;      // serializes the heap; process-shared and robust if shared
+};
+
+static void verify_after_operation();
+
+static pthread_mutex_t heap_mutex;                              // serializes the process heap
+static pthread_once_t heap_mutex_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Picks the per-process secret that keys header canaries.
+ *
+ * Reads /dev/urandom and falls back to mixing the clock, the process id and a stack
+ * address when it is unavailable.
+ */
+static void init_canary_secret() {
+    uint64_t secret = 0;
+    FILE* urandom = fopen("/dev/urandom", "rb");
+    if (urandom != NULL) {
+        if (fread(&secret, sizeof(secret), 1, urandom) != 1) {
+            secret = 0;
+        }
+        fclose(urandom);
+    }
+    if (secret == 0) {
+        secret = (uint64_t)time(NULL) ^ ((uint64_t)getpid() << 32) ^ (uint64_t)(uintptr_t)&urandom;
+    }
+    process_heap_state.secret = secret | 1;
+}
+
+/**
+ * @brief Initializes the heap mutex as recursive and picks the canary secret.
+ *
+ * The mutex is recursive so that public functions built on other public functions
+ * (export_heap_json calling the statistics getters, for example) can lock freely.
+ */
+static void init_heap_mutex() {
+    init_canary_secret();
+
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&heap_mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+/**
+ * @brief Acquires the process heap's mutex.
+ */
+static void lock_heap() {
+    pthread_once(&heap_mutex_once, init_heap_mutex);
+    pthread_mutex_lock(&heap_mutex);
+}
+
+/**
+ * @brief Releases the process heap's mutex.
+ */
+static void unlock_heap() {
+    pthread_mutex_unlock(&heap_mutex);
+}
+
+/**
+ * @brief Acquires the process heap's mutex for another module.
+ *
+ * The profiler's hooks run with this mutex held, so its configuration, statistics and
+ * dump functions take it to see consistent tables. The mutex is recursive.
+ *
+ * @return void
+ */
+void heap_lock() {
+    lock_heap();
+}
+
+/**
+ * @brief Releases the process heap's mutex taken with heap_lock.
+ *
+ * @return void
+ */
+void heap_unlock() {
+    unlock_heap();
+}
+
+/**
+ * @brief Gets the block that follows a block in the heap.
+ *
+ * Next links are stored as offsets from the heap base rather than pointers, so a heap
+ * image stays valid wherever it is mapped. Offset 0 means "none": the first block is
+ * never another block's successor.
+ *
+ * @param block Block whose successor to get.
+ *
+ * @return BlockHeader* The next block, or NULL for the last block.
+ */
+BlockHeader* block_next(BlockHeader* block) {
+    return NEXT_BLOCK(block);
+}
+
+/**
+ * @brief Links a block to its successor (see block_next).
+ *
+ * A block given no successor is the new end of the heap, which is where alloc_block
+ * appends.
+ *
+ * @param block Block to update.
+ * @param next Its new successor, or NULL if it is the last block.
+ *
+ * @return void
+ */
+void block_set_next(BlockHeader* block, BlockHeader* next) {
+    SET_NEXT_BLOCK(block, next);
+}
 
 /**
  * @brief Aligns a given size to the nearest multiple of ALIGNMENT (16 bytes).
@@ -44,6 +316,357 @@ size_t align(size_t alloc_size) {
     return alloc_size;
 }
 
+/**
+ * @brief Computes the canary for a block header.
+ *
+ * The canary mixes the per-process secret with the block's offset in the heap, so a
+ * header copied to another address, or bytes that merely look like a header, do not
+ * carry a valid canary.
+ *
+ * @param block Block header.
+ *
+ * @return uint32_t Expected canary value.
+ */
+static uint32_t block_canary(BlockHeader* block) {
+    uint64_t x = canary_secret ^ (uint64_t)((char*)block - heap);
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return (uint32_t)x;
+}
+
+/**
+ * @brief Stamps a newly created block header with its canary.
+ */
+static void stamp_block(BlockHeader* block) {
+    block->canary = block_canary(block);
+}
+
+/**
+ * @brief Gets the free list links stored in a free block's payload.
+ */
+static FreeLinks* free_links(BlockHeader* block) {
+    return (FreeLinks*)((char*)block + sizeof(BlockHeader));
+}
+
+/**
+ * @brief Gets the block at a heap offset.
+ */
+static BlockHeader* offset_block(uint32_t offset) {
+    return (BlockHeader*)(heap + offset);
+}
+
+/**
+ * @brief Gets a block's heap offset.
+ */
+static uint32_t block_offset(BlockHeader* block) {
+    return (uint32_t)((char*)block - heap);
+}
+
+/**
+ * @brief Reports whether a block is marked free in free_map.
+ */
+static bool is_listed(BlockHeader* block) {
+    size_t g = block_offset(block) / ALIGNMENT;
+    return (free_map[g / 64] >> (g % 64)) & 1;
+}
+
+/**
+ * @brief Finds the nearest free block below a granule from free_map.
+ *
+ * @return BlockHeader* The free block, or NULL if there is none.
+ */
+static BlockHeader* free_block_below(size_t g) {
+    size_t word = g / 64;
+    uint64_t bits = g % 64 == 0 ? 0 : free_map[word] & ((1ULL << (g % 64)) - 1);
+    while (bits == 0) {
+        if (word == 0) {
+            return NULL;
+        }
+        bits = free_map[--word];
+    }
+    return (BlockHeader*)(heap + (word * 64 + 63 - __builtin_clzll(bits)) * ALIGNMENT);
+}
+
+/**
+ * @brief Finds the first free block at or after a granule, wrapping to the heap start.
+ *
+ * @return BlockHeader* The free block, or NULL if there is none.
+ */
+static BlockHeader* free_block_from(size_t g) {
+    size_t words = (heap_size / ALIGNMENT + 63) / 64;
+    for (size_t i = 0; words > 0 && i <= words; i++) {
+        size_t word = (g / 64 + i) % words;
+        uint64_t bits = i == 0 ? free_map[word] & (~0ULL << (g % 64)) : free_map[word];
+        if (bits != 0) {
+            return (BlockHeader*)(heap + (word * 64 + __builtin_ctzll(bits)) * ALIGNMENT);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Inserts a free block into the explicit free list at its address position.
+ *
+ * The predecessor is the previous free block of its physical successor when that is
+ * free, and is otherwise found by scanning free_map backwards.
+ *
+ * @param block Free block that is not yet listed.
+ */
+static void link_free_block(BlockHeader* block) {
+    BlockHeader* pred;
+    if (NEXT_BLOCK(block) != NULL && NEXT_BLOCK(block)->free && is_listed(NEXT_BLOCK(block))) {
+        uint32_t prev = free_links(NEXT_BLOCK(block))->prev;
+        pred = prev == FREE_LIST_END ? NULL : offset_block(prev);
+    } else {
+        pred = free_block_below(block_offset(block) / ALIGNMENT);
+    }
+
+    FreeLinks* links = free_links(block);
+    links->prev = pred == NULL ? FREE_LIST_END : block_offset(pred);
+    links->next = pred == NULL ? free_list_head : free_links(pred)->next;
+    if (pred == NULL) {
+        free_list_head = block_offset(block);
+    } else {
+        free_links(pred)->next = block_offset(block);
+    }
+    if (links->next != FREE_LIST_END) {
+        free_links(offset_block(links->next))->prev = block_offset(block);
+    }
+
+    size_t g = block_offset(block) / ALIGNMENT;
+    free_map[g / 64] |= 1ULL << (g % 64);
+}
+
+/**
+ * @brief Removes a listed block from the explicit free list.
+ */
+static void unlink_free_block(BlockHeader* block) {
+    FreeLinks* links = free_links(block);
+    if (links->prev == FREE_LIST_END) {
+        free_list_head = links->next;
+    } else {
+        free_links(offset_block(links->prev))->next = links->next;
+    }
+    if (links->next != FREE_LIST_END) {
+        free_links(offset_block(links->next))->prev = links->prev;
+    }
+
+    size_t g = block_offset(block) / ALIGNMENT;
+    free_map[g / 64] &= ~(1ULL << (g % 64));
+}
+
+/**
+ * @brief Checks a free block's links against its listed neighbours.
+ *
+ * Links must stay inside the used heap, point at listed blocks on the correct side,
+ * and be mirrored by the neighbour's opposite link; only the head has no prev.
+ */
+static bool free_links_valid(BlockHeader* block) {
+    uint32_t offset = block_offset(block);
+    FreeLinks* links = free_links(block);
+    if (links->next != FREE_LIST_END) {
+        if (links->next <= offset || links->next >= heap_size || links->next % ALIGNMENT != 0 ||
+            !is_listed(offset_block(links->next)) || free_links(offset_block(links->next))->prev != offset) {
+            return false;
+        }
+    }
+    if (links->prev == FREE_LIST_END) {
+        return free_list_head == offset;
+    }
+    return links->prev < offset && links->prev % ALIGNMENT == 0 &&
+           is_listed(offset_block(links->prev)) && free_links(offset_block(links->prev))->next == offset;
+}
+
+/**
+ * @brief Rebuilds the explicit free list from the block list.
+ */
+static void rebuild_free_list() {
+    memset(free_map, 0, free_map_words * sizeof(uint64_t));
+    free_list_head = FREE_LIST_END;
+    BlockHeader* tail = NULL;
+    for (BlockHeader* curr = first_block; curr != NULL; curr = NEXT_BLOCK(curr)) {
+        if (!curr->free) {
+            continue;
+        }
+        // Blocks arrive in address order, so each one is appended
+        free_links(curr)->prev = tail == NULL ? FREE_LIST_END : block_offset(tail);
+        free_links(curr)->next = FREE_LIST_END;
+        if (tail == NULL) {
+            free_list_head = block_offset(curr);
+        } else {
+            free_links(tail)->next = block_offset(curr);
+        }
+        size_t g = block_offset(curr) / ALIGNMENT;
+        free_map[g / 64] |= 1ULL << (g % 64);
+        tail = curr;
+    }
+}
+
+/**
+ * @brief Reports whether free blocks are kept in the best-fit index.
+ *
+ * The index replaces the list walk of inline best fit; side-table best fit keeps its
+ * vectorized scan. set_allocation_strategy and set_metadata_mode rebuild the index
+ * whenever this becomes true. Allocator instances walk their free list instead, since
+ * index nodes are 16-bit granules of the process heap.
+ */
+static bool best_fit_indexed() {
+    return current_strategy == BEST_FIT && metadata_mode == METADATA_INLINE && active_heap == &process_heap_state;
+}
+
+/**
+ * @brief Moves a free block's best-fit index entry to where the block now starts.
+ *
+ * Called before a split or merge rewrites the headers, so the block_absorbed and
+ * sync_block calls that follow find the index already up to date and skip it.
+ *
+ * @param from Block whose entry is moved (may be unindexed).
+ * @param to Block that is free once the headers are rewritten.
+ * @param size Size of that block in bytes.
+ */
+static void fit_index_moved(BlockHeader* from, BlockHeader* to, size_t size) {
+    if (best_fit_indexed()) {
+        fit_tree_move((uint16_t)(((char*)from - heap) / ALIGNMENT),
+                      (uint16_t)(((char*)to - heap) / ALIGNMENT), (uint16_t)(size / ALIGNMENT));
+    }
+}
+
+/**
+ * @brief Retires the header of a block that is merged into its neighbour.
+ *
+ * The old header stays in memory as payload of the merged block, so its canary is
+ * cleared to make stale pointers to it fail validation. The incremental verifier's
+ * cursor is moved onto the absorbing block so it stays on a block boundary.
+ *
+ * @param absorbed Block that is being merged away.
+ * @param into Block that absorbs it.
+ */
+static void block_absorbed(BlockHeader* absorbed, BlockHeader* into) {
+    absorbed->canary = 0;
+    if (best_fit_indexed()) {
+        fit_tree_remove((uint16_t)(((char*)absorbed - heap) / ALIGNMENT));
+    }
+    if (metadata_mode == METADATA_INLINE && is_listed(absorbed)) {
+        unlink_free_block(absorbed);
+    }
+    if (metadata_mode == METADATA_SIDE_TABLE) {
+        size_t g = (size_t)((char*)absorbed - heap) / ALIGNMENT;
+        block_granules[g] = 0;
+        free_granules[g] = 0;
+        free_map[g / 64] &= ~(1ULL << (g % 64));
+    }
+    if (verify_cursor == absorbed) {
+        verify_cursor = into;
+    }
+    if (next_fit_cursor == absorbed) {
+        next_fit_cursor = into;
+    }
+    if (compact_cursor == absorbed) {
+        compact_cursor = into;
+    }
+}
+
+/**
+ * @brief Mirrors a block's size and free flag into the free list, side table or best-fit index.
+ *
+ * The explicit free list is maintained in METADATA_INLINE mode, the side table in
+ * METADATA_SIDE_TABLE mode and the index only while best_fit_indexed(); each is
+ * rebuilt when it is switched on.
+ *
+ * @param block Block whose header changed.
+ */
+static void sync_block(BlockHeader* block) {
+    size_t g = (size_t)((char*)block - heap) / ALIGNMENT;
+    uint16_t granules = (uint16_t)(block->size / ALIGNMENT);
+    if (metadata_mode == METADATA_INLINE) {
+        if (block->free && !is_listed(block)) {
+            link_free_block(block);
+        } else if (!block->free && is_listed(block)) {
+            unlink_free_block(block);
+        }
+    }
+    if (best_fit_indexed()) {
+        if (fit_tree_key((uint16_t)g) != (block->free ? granules : 0)) {
+            fit_tree_remove((uint16_t)g);
+            if (block->free) {
+                fit_tree_insert((uint16_t)g, granules);
+            }
+        }
+        return;
+    }
+    if (metadata_mode != METADATA_SIDE_TABLE) {
+        return;
+    }
+    block_granules[g] = granules;
+    free_granules[g] = block->free ? granules : 0;
+    if (block->free) {
+        free_map[g / 64] |= 1ULL << (g % 64);
+    } else {
+        free_map[g / 64] &= ~(1ULL << (g % 64));
+    }
+    if (g + 1 > side_table_granules) {
+        side_table_granules = g + 1;
+    }
+}
+
+/**
+ * @brief Clears the side table and rebuilds it from the block list.
+ */
+static void rebuild_side_table() {
+    memset(block_granules, 0, side_table_granules * sizeof(uint16_t));
+    memset(free_granules, 0, side_table_granules * sizeof(uint16_t));
+    memset(free_map, 0, free_map_words * sizeof(uint64_t));
+    side_table_granules = 0;
+    for (BlockHeader* curr = first_block; curr != NULL; curr = NEXT_BLOCK(curr)) {
+        sync_block(curr);
+    }
+}
+
+/**
+ * @brief Rebuilds the best-fit index from the block list.
+ */
+static void rebuild_fit_tree() {
+    fit_tree_reset();
+    for (BlockHeader* curr = first_block; curr != NULL; curr = NEXT_BLOCK(curr)) {
+        sync_block(curr);
+    }
+}
+
+/**
+ * @brief Invalidates every handle, as their blocks belong to a heap that no longer
+ * exists, and restarts incremental compaction.
+ */
+static void reset_handles() {
+    handle_count = 0;
+    handle_free_head = HANDLE_UNUSED;
+    compact_cursor = NULL;
+}
+
+/**
+ * @brief Resets auxiliary metadata when the first block of an empty heap is created.
+ *
+ * Callers reset the heap by clearing heap, heap_size and first_block, so state kept
+ * beside the heap is brought back in line here.
+ */
+static void reset_heap_metadata() {
+    if (active_heap == &process_heap_state) {
+        reset_handles();
+    }
+    verify_cursor = NULL;
+    next_fit_cursor = NULL;
+    fit_searches = 0;
+    fit_search_steps = 0;
+    if (metadata_mode == METADATA_INLINE) {
+        rebuild_free_list();
+    } else {
+        rebuild_side_table();
+    }
+    if (active_heap == &process_heap_state && fit_tree_count() > 0) {
+        rebuild_fit_tree();
+    }
+}
+
 /**
  * @brief Merges adjacent free blocks with the given block.
  *
@@ -58,28 +681,26 @@ void coalesce_blocks(BlockHeader* header) {
     DEBUG_PRINT("Attempting to coalesce block at %p, size: %zu\n", header, header->size);
 
     // Forward Coalescing
-    BlockHeader* next = header->next;
+    BlockHeader* next = NEXT_BLOCK(header);
     while (next != NULL && next->free == true) {
         DEBUG_PRINT("Found next free block at %p, size: %zu\n", next, next->size);
+        block_absorbed(next, header);
         header->size += next->size;
-        header->next = next->next;
+        SET_NEXT_BLOCK(header, NEXT_BLOCK(next));
         DEBUG_PRINT("Coalesced forward, new size: %zu\n", header->size);
-        next = header->next;
-    }
-
-    // Backward Coalescing
-    BlockHeader* curr = first_block;
-    BlockHeader* prev = NULL;
-
-    while (curr != NULL && curr != header) {
-        prev = curr;
-        curr = curr->next;
+        next = NEXT_BLOCK(header);
     }
+    sync_block(header);
 
-    if (prev != NULL && prev->free == true) {
+    // Backward Coalescing: the nearest free block below is the only candidate, and
+    // free_map (kept in both metadata modes) finds it without walking the block list
+    BlockHeader* prev = free_block_below(block_offset(header) / ALIGNMENT);
+    if (prev != NULL && (char*)prev + prev->size == (char*)header) {
         DEBUG_PRINT("Found previous free block at %p, size: %zu\n", prev, prev->size);
+        block_absorbed(header, prev);
         prev->size += header->size;
-        prev->next = header->next;
+        SET_NEXT_BLOCK(prev, NEXT_BLOCK(header));
+        sync_block(prev);
         DEBUG_PRINT("Coalesced backward, new size: %zu\n", prev->size);
     }
 }
@@ -127,75 +748,272 @@ void* split_block(BlockHeader* block_ptr, size_t total_size) {
     }
 
     // Set other properties of the second block
+    fit_index_moved(block_ptr, secondBox, secondBox->size);
     secondBox->free = true;
-    secondBox->next = block_ptr->next;
+    SET_NEXT_BLOCK(secondBox, NEXT_BLOCK(block_ptr));
+    stamp_block(secondBox);
 
     // Update the first block
     block_ptr->size = aligned_size;
-    block_ptr->next = secondBox;
+    SET_NEXT_BLOCK(block_ptr, secondBox);
     block_ptr->free = false;
+    sync_block(block_ptr);
+    sync_block(secondBox);
 
     DEBUG_PRINT("Second block created at %p with size: %zu\n", secondBox, secondBox->size);
     return (void*)((char*)block_ptr + sizeof(BlockHeader));
 }
 
 /**
- * @brief Finds the first free block that fits the requested size.
- *
- * This function traverses the linked list of blocks and returns the first block
- * that is free and large enough to accommodate the requested size.
- *
- * @param requested_size The size of memory requested by the user.
+ * @brief Converts a side table index back to its block header.
+ */
+static BlockHeader* granule_block(size_t g) {
+    return (BlockHeader*)(heap + g * ALIGNMENT);
+}
+
+/**
+ * @brief Iterates over the granule index of every free block, in address order.
  *
- * @return Pointer to the first suitable block, or NULL if no suitable block is found.
+ * Whole 64-granule words without a free block are skipped, so a search touches one
+ * bit per granule plus one size entry per free block.
  */
-BlockHeader* find_fit_first(size_t requested_size) {
-    BlockHeader* curr_block = first_block;
-    while (curr_block != NULL) {
-        if (curr_block->free == true && curr_block->size >= requested_size) {
-            set_last_status(ALLOC_SUCCESS);
-            return curr_block;
+#define FOR_EACH_FREE_GRANULE(g)                                                \
+    for (size_t word_ = 0; word_ < (heap_size / ALIGNMENT + 63) / 64; word_++)   \
+        for (uint64_t bits_ = free_map[word_]; bits_ != 0; bits_ &= bits_ - 1)    \
+            for (size_t g = word_ * 64 + __builtin_ctzll(bits_), once_ = 1; once_; once_ = 0)
+
+/**
+ * @brief First fit over the side table: the lowest free block of at least requested_size bytes.
+ */
+static BlockHeader* side_fit_first(size_t requested_size) {
+    size_t need = requested_size / ALIGNMENT;
+    FOR_EACH_FREE_GRANULE(g) {
+        fit_search_steps++;
+        if (free_granules[g] >= need) {
+            return granule_block(g);
         }
-        curr_block = curr_block->next;
     }
-    set_last_status(ALLOC_OUT_OF_MEMORY);
     return NULL;
 }
 
 /**
- * @brief Finds the best-fitting free block.
- *
- * This function traverses the linked list of blocks and returns the block
- * that is free and has the smallest size that is still larger than or equal to
- * the requested size.
+ * @brief Best fit over the side table: the smallest free block of at least requested_size bytes.
  *
- * @param requested_size The size of memory requested by the user.
- *
- * @return Pointer to the best-fitting block, or NULL if no suitable block is found.
+ * Each 64-granule chunk that holds a free block is reduced by the vectorized
+ * min kernel (see fit_kernels.h); the search stops early on an exact fit. Ties go to
+ * the lowest address, as in the list-based search.
  */
-BlockHeader* find_fit_best(size_t requested_size) {
-    BlockHeader* curr_block = first_block;
-    BlockHeader* best_block = NULL;
-    size_t best_size = SIZE_MAX;  // Start with maximum possible size
-
-    DEBUG_PRINT("\nLooking for best fit of size %zu\n", requested_size);
-    while (curr_block != NULL) {
-        DEBUG_PRINT("Examining block at %p, size: %zu, free: %d\n",
-               curr_block, curr_block->size, curr_block->free);
+static BlockHeader* side_fit_best(size_t requested_size) {
+    size_t need = requested_size / ALIGNMENT;
+    if (need >= FIT_NO_ENTRY) {
+        return NULL;
+    }
 
-        if (curr_block->free && curr_block->size >= requested_size) {
-            DEBUG_PRINT("  This block is suitable\n");
-            // Find the smallest block that fits
-            if (curr_block->size < best_size) {
-                best_block = curr_block;
-                best_size = curr_block->size;
-                DEBUG_PRINT("  New best block found: %p, size: %zu\n", best_block, best_size);
+    size_t words = (heap_size / ALIGNMENT + 63) / 64;
+    uint16_t best = FIT_NO_ENTRY;
+    size_t best_word = 0;
+    for (size_t word = 0; word < words; word++) {
+        if (free_map[word] == 0) {
+            continue;
+        }
+        fit_search_steps++;
+        uint16_t chunk_best = fit_chunk_min_at_least(&free_granules[word * 64], (uint16_t)need);
+        if (chunk_best < best) {
+            best = chunk_best;
+            best_word = word;
+            if (best == need) {
+                break;
             }
         }
-        curr_block = curr_block->next;
+    }
+    if (best == FIT_NO_ENTRY) {
+        return NULL;
     }
 
-    if (best_block != NULL) {
+    size_t g = best_word * 64;
+    while (free_granules[g] != best) {
+        g++;
+    }
+    return granule_block(g);
+}
+
+/**
+ * @brief Worst fit over the side table: the largest free block, if it holds requested_size bytes.
+ *
+ * Uses the vectorized max kernel per chunk; ties go to the lowest address.
+ */
+static BlockHeader* side_fit_worst(size_t requested_size) {
+    size_t need = requested_size / ALIGNMENT;
+    size_t words = (heap_size / ALIGNMENT + 63) / 64;
+    uint16_t worst = 0;
+    size_t worst_word = 0;
+    for (size_t word = 0; word < words; word++) {
+        if (free_map[word] == 0) {
+            continue;
+        }
+        fit_search_steps++;
+        uint16_t chunk_worst = fit_chunk_max(&free_granules[word * 64]);
+        if (chunk_worst > worst) {
+            worst = chunk_worst;
+            worst_word = word;
+        }
+    }
+    if (worst == 0 || worst < need) {
+        return NULL;
+    }
+
+    size_t g = worst_word * 64;
+    while (free_granules[g] != worst) {
+        g++;
+    }
+    return granule_block(g);
+}
+
+/**
+ * @brief Next fit over the free bitmap, starting at the cursor's granule and wrapping.
+ */
+static BlockHeader* side_fit_next(size_t requested_size) {
+    size_t need = requested_size / ALIGNMENT;
+    size_t words = (heap_size / ALIGNMENT + 63) / 64;
+    size_t start = next_fit_cursor != NULL ? (size_t)((char*)next_fit_cursor - heap) / ALIGNMENT : 0;
+
+    // The start word is visited twice: from the cursor on, and after wrapping, below it
+    for (size_t i = 0; words > 0 && i <= words; i++) {
+        size_t word = (start / 64 + i) % words;
+        uint64_t bits = free_map[word];
+        if (i == 0) {
+            bits &= ~0ULL << (start % 64);
+        } else if (i == words) {
+            bits &= ~(~0ULL << (start % 64));
+        }
+        for (; bits != 0; bits &= bits - 1) {
+            size_t g = word * 64 + __builtin_ctzll(bits);
+            fit_search_steps++;
+            if (free_granules[g] >= need) {
+                return granule_block(g);
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Counts blocks and sums their sizes from the side table.
+ *
+ * @param only_free Count only free blocks.
+ * @param bytes Receives the total size of the counted blocks (may be NULL).
+ *
+ * @return size_t Number of counted blocks.
+ */
+static size_t side_table_totals(bool only_free, size_t* bytes) {
+    size_t count = 0;
+    size_t granules = 0;
+    if (only_free) {
+        FOR_EACH_FREE_GRANULE(g) {
+            count++;
+            granules += free_granules[g];
+        }
+    } else {
+        size_t end = heap_size / ALIGNMENT;
+        for (size_t g = 0; g < end; g++) {
+            count += block_granules[g] != 0;
+            granules += block_granules[g];
+        }
+    }
+    if (bytes != NULL) {
+        *bytes = granules * ALIGNMENT;
+    }
+    return count;
+}
+
+/**
+ * @brief Finds the first free block that fits the requested size.
+ *
+ * This function walks the address-ordered free list and returns the first block
+ * that is large enough to accommodate the requested size, so the cost grows with
+ * the number of free blocks rather than all blocks.
+ *
+ * @param requested_size The size of memory requested by the user.
+ *
+ * @return Pointer to the first suitable block, or NULL if no suitable block is found.
+ */
+BlockHeader* find_fit_first(size_t requested_size) {
+    if (metadata_mode == METADATA_SIDE_TABLE) {
+        BlockHeader* found = side_fit_first(requested_size);
+        set_last_status(found != NULL ? ALLOC_SUCCESS : ALLOC_OUT_OF_MEMORY);
+        return found;
+    }
+
+    uint32_t offset = first_block != NULL ? free_list_head : FREE_LIST_END;
+    size_t steps = 0;
+    while (offset != FREE_LIST_END) {
+        BlockHeader* curr_block = offset_block(offset);
+        steps++;
+        if (curr_block->size >= requested_size) {
+            fit_search_steps += steps;
+            set_last_status(ALLOC_SUCCESS);
+            return curr_block;
+        }
+        offset = free_links(curr_block)->next;
+    }
+    fit_search_steps += steps;
+    set_last_status(ALLOC_OUT_OF_MEMORY);
+    return NULL;
+}
+
+/**
+ * @brief Finds the best-fitting free block.
+ *
+ * This function returns the block that is free and has the smallest size that is
+ * still larger than or equal to the requested size, preferring the lowest address
+ * among equal sizes. While BEST_FIT is the active strategy the free blocks are kept
+ * in a (size, address)-ordered AVL tree, so the lookup is O(log n); otherwise it
+ * walks the free list.
+ *
+ * @param requested_size The size of memory requested by the user.
+ *
+ * @return Pointer to the best-fitting block, or NULL if no suitable block is found.
+ */
+BlockHeader* find_fit_best(size_t requested_size) {
+    if (metadata_mode == METADATA_SIDE_TABLE) {
+        BlockHeader* found = side_fit_best(requested_size);
+        set_last_status(found != NULL ? ALLOC_SUCCESS : ALLOC_OUT_OF_MEMORY);
+        return found;
+    }
+
+    if (best_fit_indexed()) {
+        size_t need = (requested_size + ALIGNMENT - 1) / ALIGNMENT;
+        uint16_t g = first_block != NULL && need < FIT_TREE_NONE ?
+                     fit_tree_best((uint16_t)need, &fit_search_steps) : FIT_TREE_NONE;
+        BlockHeader* found = g != FIT_TREE_NONE ? (BlockHeader*)(heap + (size_t)g * ALIGNMENT) : NULL;
+        set_last_status(found != NULL ? ALLOC_SUCCESS : ALLOC_OUT_OF_MEMORY);
+        return found;
+    }
+
+    uint32_t offset = first_block != NULL ? free_list_head : FREE_LIST_END;
+    BlockHeader* best_block = NULL;
+    size_t best_size = SIZE_MAX;  // Start with maximum possible size
+
+    DEBUG_PRINT("\nLooking for best fit of size %zu\n", requested_size);
+    while (offset != FREE_LIST_END) {
+        BlockHeader* curr_block = offset_block(offset);
+        fit_search_steps++;
+        DEBUG_PRINT("Examining block at %p, size: %zu, free: %d\n",
+               curr_block, curr_block->size, curr_block->free);
+
+        if (curr_block->size >= requested_size) {
+            DEBUG_PRINT("  This block is suitable\n");
+            // Find the smallest block that fits
+            if (curr_block->size < best_size) {
+                best_block = curr_block;
+                best_size = curr_block->size;
+                DEBUG_PRINT("  New best block found: %p, size: %zu\n", best_block, best_size);
+            }
+        }
+        offset = free_links(curr_block)->next;
+    }
+
+    if (best_block != NULL) {
         DEBUG_PRINT("Best fit found: %p, size: %zu\n", best_block, best_block->size);
         set_last_status(ALLOC_SUCCESS);
         return best_block;
@@ -209,8 +1027,8 @@ BlockHeader* find_fit_best(size_t requested_size) {
 /**
  * @brief Finds the worst-fitting free block.
  *
- * This function traverses the linked list of blocks and returns the block
- * that is free and has the largest size that is still larger than or equal to
+ * This function walks the free list and returns the block
+ * that has the largest size that is still larger than or equal to
  * the requested size.
  *
  * @param requested_size The size of memory requested by the user.
@@ -218,11 +1036,19 @@ BlockHeader* find_fit_best(size_t requested_size) {
  * @return Pointer to the worst-fitting block, or NULL if no suitable block is found.
  */
 BlockHeader* find_fit_worst(size_t requested_size) {
-    BlockHeader* curr_block = first_block;
+    if (metadata_mode == METADATA_SIDE_TABLE) {
+        BlockHeader* found = side_fit_worst(requested_size);
+        set_last_status(found != NULL ? ALLOC_SUCCESS : ALLOC_OUT_OF_MEMORY);
+        return found;
+    }
+
+    uint32_t offset = first_block != NULL ? free_list_head : FREE_LIST_END;
     BlockHeader* worst_block = NULL;
 
-    while (curr_block != NULL) {
-        if (curr_block->free == true && curr_block->size >= requested_size) {
+    while (offset != FREE_LIST_END) {
+        BlockHeader* curr_block = offset_block(offset);
+        fit_search_steps++;
+        if (curr_block->size >= requested_size) {
             if (worst_block == NULL) {
                 worst_block = curr_block;
             }
@@ -230,7 +1056,7 @@ BlockHeader* find_fit_worst(size_t requested_size) {
                 worst_block = curr_block;
             }
         }
-        curr_block = curr_block->next;
+        offset = free_links(curr_block)->next;
     }
     if (worst_block != NULL) {
         set_last_status(ALLOC_SUCCESS);
@@ -243,18 +1069,70 @@ BlockHeader* find_fit_worst(size_t requested_size) {
 }
 
 /**
- * @brief Allocates a block of memory from the heap.
+ * @brief Finds the next free block that fits, resuming from the last allocation.
  *
- * This function attempts to allocate a block of memory from the heap
- * based on the current allocation strategy (first-fit, best-fit, or worst-fit).
- * If no suitable free block is found, it will extend the heap and allocate a new block
- * if there is enough space.
+ * Next fit scans like first fit but starts at the block where the previous allocation
+ * was placed and wraps around to the first block, so small splinters at the low end
+ * of the heap are not stepped over by every search.
  *
- * @param requested_bytes The number of bytes to allocate (excluding alignment and header)
+ * @param requested_size The size of memory requested by the user.
  *
- * @return Pointer to the allocated memory block, or NULL if allocation fails.
+ * @return Pointer to the first suitable block after the cursor, or NULL if no suitable
+ *         block is found.
  */
-void* heap_alloc(size_t requested_bytes) {
+BlockHeader* find_fit_next(size_t requested_size) {
+    if (first_block == NULL) {
+        set_last_status(ALLOC_OUT_OF_MEMORY);
+        return NULL;
+    }
+    if (metadata_mode == METADATA_SIDE_TABLE) {
+        BlockHeader* found = side_fit_next(requested_size);
+        set_last_status(found != NULL ? ALLOC_SUCCESS : ALLOC_OUT_OF_MEMORY);
+        return found;
+    }
+
+    // The cursor is usually the block just allocated, so start at the next free block
+    BlockHeader* cursor = next_fit_cursor != NULL ? next_fit_cursor : first_block;
+    BlockHeader* start = free_block_from(block_offset(cursor) / ALIGNMENT);
+    BlockHeader* curr_block = start;
+    while (curr_block != NULL) {
+        fit_search_steps++;
+        if (curr_block->size >= requested_size) {
+            set_last_status(ALLOC_SUCCESS);
+            return curr_block;
+        }
+        uint32_t next = free_links(curr_block)->next;
+        curr_block = offset_block(next != FREE_LIST_END ? next : free_list_head);
+        if (curr_block == start) {
+            break;
+        }
+    }
+
+    set_last_status(ALLOC_OUT_OF_MEMORY);
+    return NULL;
+}
+
+/**
+ * @brief Reports whether a strategy keeps its own header-less heap layout.
+ *
+ * BITMAP and BUDDY track blocks in their own metadata instead of the block list, so
+ * the list-based code paths hand off to their modules.
+ */
+static bool has_own_layout(AllocationStrategy strategy) {
+    return strategy == BITMAP || strategy == BUDDY;
+}
+
+/**
+ * @brief Counts blocks of the current header-less strategy (see bitmap_totals).
+ */
+static size_t own_layout_totals(bool only_free, size_t* bytes) {
+    return current_strategy == BITMAP ? bitmap_totals(only_free, bytes) : buddy_totals(only_free, bytes);
+}
+
+/**
+ * @brief Allocates a block without taking the heap mutex (see heap_alloc).
+ */
+static void* alloc_block(size_t requested_bytes) {
     // Handle zero-size request
     if (requested_bytes == 0) {
         set_last_status(ALLOC_ERROR);
@@ -274,17 +1152,27 @@ void* heap_alloc(size_t requested_bytes) {
         case WORST_FIT:
             found = find_fit_worst(total_size);
             break;
+        case NEXT_FIT:
+            found = find_fit_next(total_size);
+            break;
+        case BITMAP:
+            return bitmap_alloc(requested_bytes);
+        case BUDDY:
+            return buddy_alloc(requested_bytes);
         default:
             set_last_status(ALLOC_ERROR);
             return NULL;
     }
+    fit_searches++;
 
     if (found != NULL) {
         found->free = false;
+        next_fit_cursor = found;
 
-        // Split the block if it's large enough
-        if (found->size >= total_size + sizeof(BlockHeader) + ALIGNMENT) {
-            split_block(found, total_size);
+        // Split the block if it's large enough; split_block syncs both halves
+        if (found->size < total_size + sizeof(BlockHeader) + ALIGNMENT ||
+            split_block(found, total_size) == NULL) {
+            sync_block(found);
         }
 
         set_last_status(ALLOC_SUCCESS);
@@ -293,7 +1181,7 @@ void* heap_alloc(size_t requested_bytes) {
     }
 
     // Need to allocate a new block
-    if (heap_size + total_size > HEAP_CAPACITY) {
+    if (heap_size + total_size > heap_capacity) {
         set_last_status(ALLOC_OUT_OF_MEMORY);
         return NULL;
     }
@@ -308,21 +1196,23 @@ void* heap_alloc(size_t requested_bytes) {
     BlockHeader* new_block = (BlockHeader*) result;
     new_block->size = total_size;
     new_block->free = false;
-    new_block->next = NULL;
 
     // If the heap is empty, set the first block.
     if (first_block == NULL) {
         first_block = new_block; // Set the first block if heap is empty
     } else {
-        BlockHeader* curr_block = first_block;
-        while (curr_block->next != NULL) {
-            curr_block = curr_block->next;
-        }
-        curr_block->next = new_block;
+        SET_NEXT_BLOCK(last_block, new_block);
+    }
+    SET_NEXT_BLOCK(new_block, NULL);
+    stamp_block(new_block);
+    if (first_block == new_block) {
+        reset_heap_metadata();
     }
 
     // Update the total heap size
     heap_size += total_size;
+    sync_block(new_block);
+    next_fit_cursor = new_block;
 
     set_last_status(ALLOC_SUCCESS);
     DEBUG_PRINT("Allocated new block of %zu bytes at %p\n", total_size, result);
@@ -330,23 +1220,97 @@ void* heap_alloc(size_t requested_bytes) {
 }
 
 /**
- * @brief Frees a previously allocated block of memory.
+ * @brief Allocates a block of memory from the heap.
  *
- * This function marks a blow of memory as free, making it available for
- * future allocations. It will also attempt to coalesce adajacent free blocks
- * to prevent fragmentation.
+ * This function attempts to allocate a block of memory from the heap
+ * based on the current allocation strategy (first-fit, best-fit, or worst-fit).
+ * If no suitable free block is found, it will extend the heap and allocate a new block
+ * if there is enough space.
  *
- * @param ptr Pointer to the block of memory to be freed.
+ * @param requested_bytes The number of bytes to allocate (excluding alignment and header)
  *
- * @return void
+ * @return Pointer to the allocated memory block, or NULL if allocation fails.
  */
-void heap_free(void* ptr) {
+void* heap_alloc(size_t requested_bytes) {
+    lock_heap();
+    void* ptr = alloc_block(requested_bytes);
+    profiler_record_alloc(ptr, requested_bytes);
+    verify_after_operation();
+    unlock_heap();
+    return ptr;
+}
+
+/**
+ * @brief Reports an allocation to the profiler if it is in the process heap.
+ *
+ * The profiler's tables are guarded by the process heap's mutex, so blocks of
+ * allocator instances, which only hold their own mutex, are never sampled.
+ */
+static void record_alloc(void* ptr, size_t size) {
+    if (active_heap == &process_heap_state) {
+        profiler_record_alloc(ptr, size);
+    }
+}
+
+/**
+ * @brief Reports a free to the profiler if it is in the process heap (see record_alloc).
+ */
+static void record_free(void* ptr) {
+    if (active_heap == &process_heap_state) {
+        profiler_record_free(ptr);
+    }
+}
+
+/**
+ * @brief Checks that a pointer is the start of a block's payload (heap mutex held).
+ *
+ * The pointer must lie within the used heap, sit exactly one header past a block
+ * boundary, and the header in front of it must carry the canary expected at that
+ * address. Interior pointers, pointers to blocks that have since been merged away
+ * and random in-range values are rejected without walking the block list.
+ *
+ * @param ptr Pointer to the memory to be validated.
+ *
+ * @return bool True if the pointer is valid, false otherwise.
+ */
+static bool pointer_valid(void* ptr) {
+    if (current_strategy == BITMAP) {
+        return bitmap_validate_pointer(ptr);
+    }
+    if (current_strategy == BUDDY) {
+        return buddy_validate_pointer(ptr);
+    }
+
+    uintptr_t start = (uintptr_t) heap;
+    uintptr_t end   = (uintptr_t) heap_size;
+    uintptr_t p     = (uintptr_t) ptr;
+    if (p < start + sizeof(BlockHeader) || p >= start + end ||
+        (p - sizeof(BlockHeader) - start) % ALIGNMENT != 0) {
+        return false;
+    }
+    BlockHeader* header = (BlockHeader*)(p - sizeof(BlockHeader));
+    return header->canary == block_canary(header);
+}
+
+/**
+ * @brief Frees a block without taking the heap mutex (see heap_free).
+ */
+static void free_block(void* ptr) {
     if (ptr == NULL) {
         set_last_status(ALLOC_INVALID_FREE);
         return;
     }
 
-    if (validate_pointer(ptr) == false) {
+    if (current_strategy == BITMAP) {
+        bitmap_free(ptr);
+        return;
+    }
+    if (current_strategy == BUDDY) {
+        buddy_free(ptr);
+        return;
+    }
+
+    if (pointer_valid(ptr) == false) {
         set_last_status(ALLOC_HEAP_ERROR);
         return;
     }
@@ -359,7 +1323,9 @@ void heap_free(void* ptr) {
 
     DEBUG_PRINT("Freeing block at %p, size: %zu\n", header, header->size);
 
+    record_free(ptr);
     header->free = true;
+    sync_block(header);
 
     coalesce_blocks(header);
 
@@ -367,34 +1333,55 @@ void heap_free(void* ptr) {
 }
 
 /**
- * @brief Resizes a previously allocated block of memory.
+ * @brief Frees a previously allocated block of memory.
  *
- * This function will attempt to resize an existing block of memory to a new size.
- * If the block can be resized in place, it will either split or coalesce
- * adjacent blocks as needed. If the block can't be resized in place, a ne w
- * block will be allocated, the data will be copied over, and the old block will be freed.
+ * This function marks a blow of memory as free, making it available for
+ * future allocations. It will also attempt to coalesce adajacent free blocks
+ * to prevent fragmentation.
  *
- * @param ptr Pointer to the previously allocated block of memory to be resized.
- * @param new_size The new size of the block (in bytes).
+ * @param ptr Pointer to the block of memory to be freed.
  *
- * @return void* Pointer to the resized block of memory, or NULL is an error occured.
+ * @return void
  */
-void* heap_realloc(void* ptr, size_t new_size) {
+void heap_free(void* ptr) {
+    lock_heap();
+    free_block(ptr);
+    verify_after_operation();
+    unlock_heap();
+}
+
+/**
+ * @brief Resizes a block without taking the heap mutex (see heap_realloc).
+ */
+static void* realloc_block(void* ptr, size_t new_size) {
     if (ptr == NULL) {
-        return heap_alloc(new_size);
+        void* new_ptr = alloc_block(new_size);
+        record_alloc(new_ptr, new_size);
+        return new_ptr;
     }
 
     if (new_size == 0) {
-        heap_free(ptr);
+        free_block(ptr);
         return NULL;
     }
 
-    if (validate_pointer(ptr) == false) {
+    if (current_strategy == BITMAP) {
+        return bitmap_realloc(ptr, new_size);
+    }
+    if (current_strategy == BUDDY) {
+        return buddy_realloc(ptr, new_size);
+    }
+
+    if (pointer_valid(ptr) == false) {
         set_last_status(ALLOC_HEAP_ERROR);
         return NULL;
     }
 
     BlockHeader* curr = (BlockHeader*)((char*)ptr - sizeof(BlockHeader));
+    if (curr->free) {
+        set_last_status(ALLOC_INVALID_FREE);
+        return NULL;
+    }
     size_t total_new_size = align(new_size + sizeof(BlockHeader));
 
     // If current block is large enough to fit new size, split the block if possible.
@@ -403,45 +1390,73 @@ void* heap_realloc(void* ptr, size_t new_size) {
             BlockHeader* new_block = (BlockHeader*)((char*)curr + total_new_size);
             new_block->size = curr->size - total_new_size;
             new_block->free = true;
-            new_block->next = curr->next;
+            SET_NEXT_BLOCK(new_block, NEXT_BLOCK(curr));
+            stamp_block(new_block);
 
             curr->size = total_new_size;
-            curr->next = new_block;
+            SET_NEXT_BLOCK(curr, new_block);
+
+            // The freed tail may now sit next to a free block; merge them
+            BlockHeader* after = NEXT_BLOCK(new_block);
+            if (after != NULL && after->free == true) {
+                fit_index_moved(after, new_block, new_block->size + after->size);
+                block_absorbed(after, new_block);
+                new_block->size += after->size;
+                SET_NEXT_BLOCK(new_block, NEXT_BLOCK(after));
+            }
+            sync_block(curr);
+            sync_block(new_block);
 
             DEBUG_PRINT("Split during realloc: created free block at %p with size %zu\n", new_block, new_block->size);
         }
 
+        // Resizing in place counts as a free plus a fresh allocation for the profiler
+        record_free(ptr);
+        record_alloc(ptr, new_size);
+
         set_last_status(ALLOC_SUCCESS);
         return ptr;
     }
 
     // If the next block is free and large enough to fit the new size, coalesce the blocks.
-    if (curr->next != NULL && curr->next->free == true &&
-        (curr->size + curr->next->size + sizeof(BlockHeader)) >= total_new_size) {
-
-        size_t combined_size = curr->size + curr->next->size + sizeof(BlockHeader);
+    if (NEXT_BLOCK(curr) != NULL && NEXT_BLOCK(curr)->free == true &&
+        (curr->size + NEXT_BLOCK(curr)->size) >= total_new_size) {
+
+        size_t combined_size = curr->size + NEXT_BLOCK(curr)->size;
+        if (combined_size > total_new_size + sizeof(BlockHeader) + ALIGNMENT) {
+            // The remainder of the split below takes over the free block's index entry
+            fit_index_moved(NEXT_BLOCK(curr), (BlockHeader*)((char*)curr + total_new_size),
+                            combined_size - total_new_size);
+        }
+        block_absorbed(NEXT_BLOCK(curr), curr);
         curr->size = combined_size;
-        curr->next = curr->next->next;
+        SET_NEXT_BLOCK(curr, NEXT_BLOCK(NEXT_BLOCK(curr)));
 
         // Now split if needed
         if (curr->size > total_new_size + sizeof(BlockHeader) + ALIGNMENT) {
             BlockHeader* new_block = (BlockHeader*)((char*)curr + total_new_size);
             new_block->size = curr->size - total_new_size;
             new_block->free = true;
-            new_block->next = curr->next;
+            SET_NEXT_BLOCK(new_block, NEXT_BLOCK(curr));
+            stamp_block(new_block);
 
             curr->size = total_new_size;
-            curr->next = new_block;
+            SET_NEXT_BLOCK(curr, new_block);
+            sync_block(new_block);
 
             DEBUG_PRINT("Split after coalesce in realloc: created free block at %p with size %zu\n", new_block, new_block->size);
         }
 
+        sync_block(curr);
+        record_free(ptr);
+        record_alloc(ptr, new_size);
+
         set_last_status(ALLOC_SUCCESS);
         return ptr;
     }
 
     // If the block cannot be resized in place, allocate a new block and copy data.
-    void* new_ptr = heap_alloc(new_size);
+    void* new_ptr = alloc_block(new_size);
     if (new_ptr == NULL) {
         set_last_status(ALLOC_OUT_OF_MEMORY);
         return NULL;
@@ -453,89 +1468,389 @@ void* heap_realloc(void* ptr, size_t new_size) {
     }
 
     memcpy(new_ptr, ptr, copy_size);
-    heap_free(ptr);
+    free_block(ptr);
+    record_alloc(new_ptr, new_size);
 
     set_last_status(ALLOC_SUCCESS);
     return new_ptr;
 }
 
 /**
- * @brief Checks the integrity of the heap.
+ * @brief Resizes a previously allocated block of memory.
  *
- * This function will verify the heap's structure for any inconsistencies, such as
- * cycles, alginment issues, out-of-bounds blocks, or adjacent free blocks that should
- * have been coalesced. If any errors are found, the function will return false and set
- * an appropriate error status. Otherwise, it wil return true.
+ * This function will attempt to resize an existing block of memory to a new size.
+ * If the block can be resized in place, it will either split or coalesce
+ * adjacent blocks as needed. If the block can't be resized in place, a ne w
+ * block will be allocated, the data will be copied over, and the old block will be freed.
  *
- * @return bool True if the heap is valid, false otherwise.
+ * @param ptr Pointer to the previously allocated block of memory to be resized.
+ * @param new_size The new size of the block (in bytes).
+ *
+ * @return void* Pointer to the resized block of memory, or NULL is an error occured.
  */
-bool check_heap_integrity() {
-    BlockHeader* visited[HEAP_CAPACITY / sizeof(BlockHeader)];
-    size_t visited_count = 0;
+void* heap_realloc(void* ptr, size_t new_size) {
+    lock_heap();
+    void* new_ptr = realloc_block(ptr, new_size);
+    verify_after_operation();
+    unlock_heap();
+    return new_ptr;
+}
 
-    BlockHeader* curr_block = first_block;
-    void* heap_start = (void*)first_block;
-    void* heap_end = heap_start + HEAP_CAPACITY;
+/**
+ * @brief Checks a block's header and its link to the next block.
+ *
+ * The block itself must already be known to start on a block boundary. Its canary must
+ * match, its size must be aligned and fit in the used heap, its next link must point
+ * exactly past its end (or be NULL for the last block), and it must not be free next
+ * to another free block. Passing this for every block makes the block list safe to walk.
+ *
+ * @param block Block to check.
+ * @param status Receives the status describing a violation.
+ *
+ * @return Description of the violated invariant, or NULL if the block is valid.
+ */
+static const char* check_block_layout(BlockHeader* block, AllocatorStatus* status) {
+    char* heap_end = heap + heap_size;
 
-    while (curr_block != NULL) {
-        // Check if we've already seen this block (cycle)
-        for (size_t i = 0; i < visited_count; ++i) {
-            if (visited[i] == curr_block) {
-                set_last_status(ALLOC_HEAP_ERROR);
-                return false;
-            }
-        }
+    // Check the header canary
+    if (block->canary != block_canary(block)) {
+        *status = ALLOC_HEAP_ERROR;
+        return "header canary mismatch";
+    }
 
-        // Store current block
-        if (visited_count < HEAP_CAPACITY / sizeof(BlockHeader)) {
-            visited[visited_count++] = curr_block;
-        }
-        else {
-            set_last_status(ALLOC_HEAP_ERROR);
-            return false;
-        }
+    // Check size
+    if (block->size == 0 || block->size % ALIGNMENT != 0) {
+        *status = ALLOC_ALIGNMENT_ERROR;
+        return "misaligned block size";
+    }
 
-        // Check size
-        if (curr_block->size == 0 || curr_block->size % ALIGNMENT != 0) {
-            set_last_status(ALLOC_ALIGNMENT_ERROR);
-            return false;
-        }
+    // Check block boundaries
+    if (block->size < sizeof(BlockHeader) || block->size > (size_t)(heap_end - (char*)block)) {
+        *status = ALLOC_HEAP_ERROR;
+        return "block extends past the end of the heap";
+    }
 
-        // Check block boundaries
-        void* curr_block_end = (void*)curr_block + curr_block->size;
-        if ((void*)curr_block < heap_start || curr_block_end > heap_end) {
+    // Blocks tile the heap in address order, so the next block must start exactly where
+    // this one ends. Addresses strictly increase, which also rules out cycles.
+    char* block_end = (char*)block + block->size;
+    if (NEXT_BLOCK(block) != (block_end == heap_end ? NULL : (BlockHeader*)block_end)) {
+        *status = ALLOC_HEAP_ERROR;
+        return "next link does not point to the adjacent block";
+    }
+
+    // Check for adjacent free blocks (these should have been coalesced)
+    if (block->free == true && NEXT_BLOCK(block) != NULL && NEXT_BLOCK(block)->free == true) {
+        *status = ALLOC_HEAP_ERROR;
+        return "adjacent free blocks were not coalesced";
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Checks the invariants of a single block and its link to the next one.
+ *
+ * On top of check_block_layout, its free list links (inline mode), side table entry
+ * (side table mode) and best-fit index entry must match the header.
+ *
+ * @param block Block to check.
+ * @param status Receives the status describing a violation.
+ *
+ * @return Description of the violated invariant, or NULL if the block is valid.
+ */
+static const char* check_block(BlockHeader* block, AllocatorStatus* status) {
+    const char* reason = check_block_layout(block, status);
+    if (reason != NULL) {
+        return reason;
+    }
+
+    // In side table mode the table must agree with the header
+    if (metadata_mode == METADATA_SIDE_TABLE) {
+        size_t g = (size_t)((char*)block - heap) / ALIGNMENT;
+        size_t granules = block->size / ALIGNMENT;
+        bool mapped_free = (free_map[g / 64] >> (g % 64)) & 1;
+        if (block_granules[g] != granules || free_granules[g] != (block->free ? granules : 0) ||
+            mapped_free != block->free) {
+            *status = ALLOC_HEAP_ERROR;
+            return "side table disagrees with block header";
+        }
+    }
+
+    // In inline mode free blocks must be on the free list, linked to listed neighbours
+    // in address order; free_map is checked first so the links are only followed to
+    // blocks known to be free
+    if (metadata_mode == METADATA_INLINE) {
+        if (is_listed(block) != block->free) {
+            *status = ALLOC_HEAP_ERROR;
+            return "free list membership disagrees with block header";
+        }
+        if (block->free && !free_links_valid(block)) {
+            *status = ALLOC_HEAP_ERROR;
+            return "free list links are corrupted";
+        }
+    }
+
+    // The best-fit index must hold exactly the free blocks, with their current sizes
+    if (best_fit_indexed()) {
+        uint16_t g = (uint16_t)(((char*)block - heap) / ALIGNMENT);
+        if (fit_tree_key(g) != (block->free ? block->size / ALIGNMENT : 0)) {
+            *status = ALLOC_HEAP_ERROR;
+            return "best-fit index disagrees with block header";
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Records a corruption found by the verifier (only the first one is kept).
+ */
+static void record_corruption(BlockHeader* block, AllocatorStatus status, const char* reason) {
+    pthread_mutex_lock(&verify_mutex);
+    if (!verify_failed) {
+        verify_corruption.status = status;
+        verify_corruption.offset = (size_t)((char*)block - heap);
+        verify_corruption.reason = reason;
+        __atomic_store_n(&verify_failed, true, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&verify_mutex);
+}
+
+/**
+ * @brief Checks heap integrity without taking the heap mutex (see check_heap_integrity).
+ */
+static bool check_integrity() {
+    AllocatorStatus status = ALLOC_HEAP_ERROR;
+
+    if (current_strategy == BITMAP) {
+        return bitmap_check_integrity();
+    }
+    if (current_strategy == BUDDY) {
+        return buddy_check_integrity();
+    }
+
+    if (heap_size > heap_capacity || (first_block == NULL && heap_size != 0) ||
+        (first_block != NULL && first_block != (BlockHeader*)heap)) {
+        set_last_status(ALLOC_HEAP_ERROR);
+        return false;
+    }
+
+    size_t free_blocks = 0;
+    BlockHeader* tail = NULL;
+    for (BlockHeader* curr_block = first_block; curr_block != NULL; curr_block = NEXT_BLOCK(curr_block)) {
+        if (check_block(curr_block, &status) != NULL) {
+            set_last_status(status);
+            return false;
+        }
+        free_blocks += curr_block->free;
+        tail = curr_block;
+    }
+
+    // New blocks are appended after last_block, so it must be the end of the list
+    if (tail != last_block && first_block != NULL) {
+        set_last_status(ALLOC_HEAP_ERROR);
+        return false;
+    }
+
+    // Every free block's bit was matched above, so a stray bit inside a block or past
+    // the heap end shows up in the count; free_block_below would take it for a block
+    if (first_block != NULL) {
+        size_t granules = heap_size / ALIGNMENT;
+        size_t mapped = 0;
+        for (size_t word = 0; word < free_map_words; word++) {
+            uint64_t allowed = word * 64 + 64 <= granules ? ~0ULL :
+                               word * 64 >= granules ? 0 : ~(~0ULL << (granules % 64));
+            if ((free_map[word] & ~allowed) != 0) {
+                set_last_status(ALLOC_HEAP_ERROR);
+                return false;
+            }
+            mapped += (size_t)__builtin_popcountll(free_map[word]);
+        }
+        if (mapped != free_blocks) {
             set_last_status(ALLOC_HEAP_ERROR);
             return false;
         }
+    }
+
+    // Every indexed block was matched above, so extra entries show up in the count
+    if (best_fit_indexed() && first_block != NULL && fit_tree_count() != free_blocks) {
+        set_last_status(ALLOC_HEAP_ERROR);
+        return false;
+    }
 
-        // Check for adjacent free blocks (these should have been coalesced)
-        if (curr_block->free == true && curr_block->next != NULL && curr_block->next->free == true) {
+    // Each free block links to its neighbours, so a list that starts at the lowest
+    // free block and holds as many entries as there are free blocks holds all of them
+    if (metadata_mode == METADATA_INLINE && first_block != NULL) {
+        BlockHeader* lowest = free_block_from(0);
+        if (free_list_head != (lowest != NULL ? block_offset(lowest) : FREE_LIST_END)) {
+            set_last_status(ALLOC_HEAP_ERROR);
+            return false;
+        }
+        size_t listed = 0;
+        for (uint32_t offset = free_list_head; offset != FREE_LIST_END && listed <= free_blocks;
+             offset = free_links(offset_block(offset))->next) {
+            listed++;
+        }
+        if (listed != free_blocks) {
             set_last_status(ALLOC_HEAP_ERROR);
             return false;
         }
-        curr_block = curr_block->next;
     }
+
     set_last_status(ALLOC_HEAP_OK);
     return true;
 }
 
 /**
- * @brief Validates if a pointer is within the heap's allocated memory range.
+ * @brief Verifies up to max_blocks blocks without taking the heap mutex (see heap_verify_step).
+ */
+static bool verify_step(size_t max_blocks) {
+    if (__atomic_load_n(&verify_failed, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+    if (first_block == NULL) {
+        verify_cursor = NULL;
+        return true;
+    }
+    if (verify_cursor == NULL) {
+        if (first_block != (BlockHeader*)heap) {
+            record_corruption(first_block, ALLOC_HEAP_ERROR, "first block is not at the heap start");
+            return false;
+        }
+        verify_cursor = first_block;
+    }
+
+    AllocatorStatus status = ALLOC_HEAP_ERROR;
+    for (size_t i = 0; i < max_blocks && verify_cursor != NULL; i++) {
+        const char* reason = check_block(verify_cursor, &status);
+        if (reason != NULL) {
+            record_corruption(verify_cursor, status, reason);
+            return false;
+        }
+        verify_cursor = NEXT_BLOCK(verify_cursor);  // NULL after the last block: the next step starts over
+    }
+    return true;
+}
+
+/**
+ * @brief Runs the per-operation verification budget, if one is set.
+ *
+ * The operation's own status is preserved; corruption is reported through
+ * heap_verify_get_corruption.
+ */
+static void verify_after_operation() {
+    size_t budget = __atomic_load_n(&verify_budget, __ATOMIC_RELAXED);
+    if (budget > 0) {
+        verify_step(budget);
+        if (__atomic_load_n(&verify_failed, __ATOMIC_ACQUIRE)) {
+            DEBUG_PRINT("Heap corruption at offset %zu: %s\n", verify_corruption.offset, verify_corruption.reason);
+        }
+    }
+}
+
+/**
+ * @brief Checks the integrity of the heap.
+ *
+ * This function will verify the heap's structure for any inconsistencies, such as
+ * cycles, alginment issues, out-of-bounds blocks, or adjacent free blocks that should
+ * have been coalesced. If any errors are found, the function will return false and set
+ * an appropriate error status. Otherwise, it wil return true.
+ *
+ * The check is a single pass over the block list using constant stack space: every
+ * block must begin where the previous one ended, so a cycle or a stray link shows up
+ * as a block at an unexpected address. It is cheap enough to run periodically.
+ *
+ * @return bool True if the heap is valid, false otherwise.
+ */
+bool check_heap_integrity() {
+    lock_heap();
+    bool result = check_integrity();
+    unlock_heap();
+    return result;
+}
+
+/**
+ * @brief Verifies the next few blocks of the heap.
+ *
+ * The incremental verifier keeps a cursor between calls and checks at most max_blocks
+ * blocks per call, applying the same per-block checks as check_heap_integrity. Once
+ * it passes the last block it starts over from the first. This spreads the cost of a
+ * full check over many calls, so the heap can be verified continuously in production.
+ *
+ * @param max_blocks Maximum number of blocks to check in this call.
+ *
+ * @return bool False if a corruption has been found (see heap_verify_get_corruption).
+ */
+bool heap_verify_step(size_t max_blocks) {
+    lock_heap();
+    bool result = verify_step(max_blocks);
+    pthread_mutex_lock(&verify_mutex);
+    set_last_status(result ? ALLOC_HEAP_OK : verify_corruption.status);
+    pthread_mutex_unlock(&verify_mutex);
+    unlock_heap();
+    return result;
+}
+
+/**
+ * @brief Sets how many blocks are verified after every heap operation.
+ *
+ * With a non-zero budget, heap_alloc, heap_free and heap_realloc each advance the
+ * incremental verifier by that many blocks.
+ *
+ * @param blocks_per_op Blocks to verify per operation, or 0 to disable (the default).
+ *
+ * @return void
+ */
+void heap_verify_set_budget(size_t blocks_per_op) {
+    __atomic_store_n(&verify_budget, blocks_per_op, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Gets the first corruption found by the incremental verifier.
+ *
+ * @param out Receives the corruption's status, block offset and description.
+ *
+ * @return bool True if a corruption has been found, false otherwise.
+ */
+bool heap_verify_get_corruption(HeapCorruption* out) {
+    pthread_mutex_lock(&verify_mutex);
+    bool failed = verify_failed;
+    if (failed && out != NULL) {
+        *out = verify_corruption;
+    }
+    pthread_mutex_unlock(&verify_mutex);
+    return failed;
+}
+
+/**
+ * @brief Clears any recorded corruption and restarts verification at the first block.
+ *
+ * @return void
+ */
+void heap_verify_reset() {
+    lock_heap();
+    pthread_mutex_lock(&verify_mutex);
+    __atomic_store_n(&verify_failed, false, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&verify_mutex);
+    verify_cursor = NULL;
+    unlock_heap();
+}
+
+/**
+ * @brief Validates that a pointer is the start of a process heap block's payload.
  *
- * This function will check if the provided pointer is within the range of the heap.
- * It's an internal function that helps ensure that a pointer being freed or accessed is
- * part of the allocated heap memory.
+ * This function checks in O(1) under the heap mutex, which also makes sure the
+ * canary secret is initialized before any canary is computed (see pointer_valid).
  *
  * @param ptr Pointer to the memory to be validated.
  *
  * @return bool True if the pointer is valid, false otherwise.
  */
 bool validate_pointer(void* ptr) {
-    uintptr_t start = (uintptr_t) heap;
-    uintptr_t end   = (uintptr_t) heap_size;
-    uintptr_t p     = (uintptr_t) ptr;
-    bool result = (p >= start && p < start + end);
-    return result;
+    lock_heap();
+    bool valid = pointer_valid(ptr);
+    unlock_heap();
+    return valid;
 }
 
 /**
@@ -548,157 +1863,1589 @@ bool validate_pointer(void* ptr) {
  * @return void
  */
 void defragment_heap() {
+    lock_heap();
     BlockHeader* curr_block = first_block;
 
-    while (curr_block != NULL && curr_block->next != NULL) {
-        if (curr_block->free == true && curr_block->next->free == true) {
+    while (curr_block != NULL && NEXT_BLOCK(curr_block) != NULL) {
+        if (curr_block->free == true && NEXT_BLOCK(curr_block)->free == true) {
             coalesce_blocks(curr_block);
         }
         else {
-            curr_block = curr_block->next;
+            curr_block = NEXT_BLOCK(curr_block);
+        }
+    }
+    unlock_heap();
+}
+
+/**
+ * @brief Gets the block a handle refers to (heap mutex held).
+ *
+ * The handle's id is kept in the first HANDLE_TAG_SIZE bytes of the block's payload,
+ * so a block is the handle's only if its tag and the handle's table entry agree.
+ *
+ * @return BlockHeader* The block, or NULL if the handle is not live.
+ */
+static BlockHeader* handle_block(Handle handle) {
+    if (handle == HANDLE_NONE || handle > handle_count || has_own_layout(current_strategy)) {
+        return NULL;
+    }
+    uint32_t offset = handle_table[handle - 1].offset;
+    if (offset == HANDLE_UNUSED || offset + sizeof(BlockHeader) + HANDLE_TAG_SIZE > heap_size) {
+        return NULL;
+    }
+    BlockHeader* block = (BlockHeader*)(heap + offset);
+    if (block->canary != block_canary(block) || block->free || *(uint64_t*)(block + 1) != handle) {
+        return NULL;
+    }
+    return block;
+}
+
+/**
+ * @brief Checks whether compaction may move a block: a handle's block that is not locked.
+ */
+static bool block_movable(BlockHeader* block) {
+    if (block->free) {
+        return false;
+    }
+    uint64_t tag = *(uint64_t*)(block + 1);
+    if (tag == HANDLE_NONE || tag > handle_count) {
+        return false;
+    }
+    HandleEntry* entry = &handle_table[tag - 1];
+    return entry->offset == block_offset(block) && entry->locks == 0;
+}
+
+/**
+ * @brief Allocates a block whose address the allocator may change.
+ *
+ * The block is reached through the returned handle: handle_lock gives its current
+ * address and keeps it in place until the matching handle_unlock, and heap_compact
+ * may move it while it is unlocked. Handles live in the process heap and need one of
+ * the list strategies (not BITMAP or BUDDY).
+ *
+ * @param size Number of bytes (not 0).
+ *
+ * @return Handle The new handle, or HANDLE_NONE on failure.
+ */
+Handle handle_alloc(size_t size) {
+    lock_heap();
+    Handle handle = HANDLE_NONE;
+    if (size == 0 || size > SIZE_MAX - HANDLE_TAG_SIZE - sizeof(BlockHeader) - ALIGNMENT) {
+        set_last_status(ALLOC_ERROR);
+    } else if (has_own_layout(current_strategy)) {
+        set_last_status(ALLOC_INVALID_OPERATION);
+    } else if (handle_free_head == HANDLE_UNUSED && handle_count == HANDLE_CAPACITY) {
+        set_last_status(ALLOC_OUT_OF_MEMORY);
+    } else {
+        char* payload = alloc_block(size + HANDLE_TAG_SIZE);
+        if (payload != NULL) {
+            uint32_t index = handle_free_head;
+            if (index != HANDLE_UNUSED) {
+                handle_free_head = handle_table[index].locks;
+            } else {
+                index = handle_count++;
+            }
+            handle_table[index].offset = block_offset((BlockHeader*)(payload - sizeof(BlockHeader)));
+            handle_table[index].locks = 0;
+            handle = index + 1;
+            *(uint64_t*)payload = handle;
+            profiler_record_alloc(payload, size);
+        }
+    }
+    verify_after_operation();
+    unlock_heap();
+    return handle;
+}
+
+/**
+ * @brief Pins a handle's block and gets its address.
+ *
+ * Locks nest: the block stays where it is until every handle_lock has been matched by
+ * a handle_unlock, after which the address must no longer be used.
+ *
+ * @param handle Handle from handle_alloc.
+ *
+ * @return void* The block's memory, aligned to ALIGNMENT, or NULL if the handle is not live.
+ */
+void* handle_lock(Handle handle) {
+    lock_heap();
+    BlockHeader* block = handle_block(handle);
+    void* ptr = NULL;
+    if (block == NULL || handle_table[handle - 1].locks == UINT32_MAX) {
+        set_last_status(ALLOC_INVALID_OPERATION);
+    } else {
+        handle_table[handle - 1].locks++;
+        ptr = (char*)(block + 1) + HANDLE_TAG_SIZE;
+        set_last_status(ALLOC_SUCCESS);
+    }
+    unlock_heap();
+    return ptr;
+}
+
+/**
+ * @brief Releases one handle_lock on a handle's block.
+ *
+ * @param handle Locked handle.
+ *
+ * @return void
+ */
+void handle_unlock(Handle handle) {
+    lock_heap();
+    if (handle_block(handle) == NULL || handle_table[handle - 1].locks == 0) {
+        set_last_status(ALLOC_INVALID_OPERATION);
+    } else {
+        handle_table[handle - 1].locks--;
+        set_last_status(ALLOC_SUCCESS);
+    }
+    unlock_heap();
+}
+
+/**
+ * @brief Frees a handle's block and retires the handle.
+ *
+ * A locked handle is refused, since its address may still be in use.
+ *
+ * @param handle Unlocked handle from handle_alloc.
+ *
+ * @return void
+ */
+void handle_free(Handle handle) {
+    lock_heap();
+    BlockHeader* block = handle_block(handle);
+    if (block == NULL) {
+        set_last_status(ALLOC_INVALID_FREE);
+    } else if (handle_table[handle - 1].locks != 0) {
+        set_last_status(ALLOC_INVALID_OPERATION);
+    } else {
+        free_block(block + 1);
+        handle_table[handle - 1].offset = HANDLE_UNUSED;
+        handle_table[handle - 1].locks = handle_free_head;
+        handle_free_head = handle - 1;
+    }
+    verify_after_operation();
+    unlock_heap();
+}
+
+/**
+ * @brief Moves a movable block down into the free block in front of it.
+ *
+ * The two blocks trade places: the moved block starts where the free one did and the
+ * free space follows it, merged with the next block if that is free. Every step
+ * leaves a consistent heap, with the handle pointing at the block's new home.
+ *
+ * @param gap Free block directly below block.
+ * @param block Movable block (see block_movable).
+ *
+ * @return BlockHeader* The free block, now above the moved block.
+ */
+static BlockHeader* slide_block(BlockHeader* gap, BlockHeader* block) {
+    size_t gap_size = gap->size;
+    size_t block_size = block->size;
+    BlockHeader* after = NEXT_BLOCK(block);
+    uint64_t handle = *(uint64_t*)(block + 1);
+
+    profiler_record_free(block + 1);
+    block_absorbed(gap, gap);
+    block_absorbed(block, gap);
+    memmove(gap, block, block_size);
+
+    BlockHeader* moved = gap;
+    BlockHeader* hole = (BlockHeader*)((char*)moved + block_size);
+    hole->size = gap_size;
+    hole->free = true;
+    SET_NEXT_BLOCK(moved, hole);
+    SET_NEXT_BLOCK(hole, after);
+    stamp_block(moved);
+    stamp_block(hole);
+    sync_block(moved);
+    sync_block(hole);
+    handle_table[handle - 1].offset = block_offset(moved);
+    profiler_record_alloc(moved + 1, block_size - sizeof(BlockHeader) - HANDLE_TAG_SIZE);
+
+    if (after != NULL && after->free) {
+        coalesce_blocks(hole);
+    }
+    return hole;
+}
+
+/**
+ * @brief Continues the compaction pass from compact_cursor (heap mutex held).
+ *
+ * Moving a block costs its size and stepping past one costs a header, so runs of
+ * blocks that cannot move count against the budget too. The first move or step is
+ * always made, so every call makes progress.
+ *
+ * @param max_bytes Budget for this call.
+ *
+ * @return bool True if the pass reached the end of the heap.
+ */
+static bool compact_blocks(size_t max_bytes) {
+    BlockHeader* curr = first_block != NULL && compact_cursor != NULL ? compact_cursor : first_block;
+    size_t spent = 0;
+    while (curr != NULL) {
+        BlockHeader* next = NEXT_BLOCK(curr);
+        bool move = curr->free && next != NULL && block_movable(next);
+        size_t cost = move ? next->size : sizeof(BlockHeader);
+        if (spent > 0 && spent + cost > max_bytes) {
+            break;
+        }
+        spent += cost;
+        curr = move ? slide_block(curr, next) : next;
+    }
+    compact_cursor = curr;
+    return curr == NULL;
+}
+
+/**
+ * @brief Compacts the heap by sliding unlocked handle blocks down over free space.
+ *
+ * Free space bubbles up past every movable block, so a heap whose live blocks all
+ * belong to unlocked handles ends with one free block at the top. Blocks from
+ * heap_alloc and locked handles stay put; free space directly below them is left
+ * where it is.
+ *
+ * @return size_t Size of the free block at the end of the heap, 0 if there is none.
+ */
+size_t heap_compact() {
+    lock_heap();
+    if (has_own_layout(current_strategy)) {
+        set_last_status(ALLOC_INVALID_OPERATION);
+        unlock_heap();
+        return 0;
+    }
+
+    compact_cursor = NULL;
+    compact_blocks(SIZE_MAX);
+
+    size_t tail = first_block != NULL && last_block->free ? last_block->size : 0;
+    set_last_status(ALLOC_SUCCESS);
+    verify_after_operation();
+    unlock_heap();
+    return tail;
+}
+
+/**
+ * @brief Advances compaction by a bounded amount of work.
+ *
+ * Like heap_verify_step, this keeps a cursor between calls, so a full heap_compact
+ * pass can be spread over idle time or a background thread without a long pause.
+ * Each call moves at most about max_bytes of blocks (but always at least one block,
+ * which may be larger), and the heap is consistent between calls: allocations, frees
+ * and handle locks may come in between, and space freed behind the cursor is picked
+ * up by the next pass.
+ *
+ * @param max_bytes Bytes to move per call; stepping past a block counts as
+ *                  sizeof(BlockHeader) bytes.
+ *
+ * @return bool True if this call finished a pass; the next call starts a new one.
+ */
+bool heap_compact_step(size_t max_bytes) {
+    lock_heap();
+    bool done = true;
+    if (has_own_layout(current_strategy)) {
+        set_last_status(ALLOC_INVALID_OPERATION);
+    } else {
+        done = compact_blocks(max_bytes);
+        set_last_status(ALLOC_SUCCESS);
+        verify_after_operation();
+    }
+    unlock_heap();
+    return done;
+}
+
+/**
+ * @brief Sets the last status of the allocator.
+ *
+ * This function updates the last status code of the allocator.
+ *
+ * @param status The new status code to set.
+ *
+ * @return void
+ */
+void set_last_status(AllocatorStatus status) {
+    last_status = status;
+}
+
+/**
+ * @brief Sets the allocation strategy for the allocator.
+ *
+ * This function updates the current allocation strategy used by the allocator.
+ *
+ * @param strategy The new allocation strategy to set.
+ *
+ * @return void
+ */
+void set_allocation_strategy(AllocationStrategy strategy) {
+    lock_heap();
+    // BITMAP and BUDDY blocks have no headers, so the heap cannot change layout once in use
+    if (heap_size != 0 && strategy != current_strategy &&
+        (has_own_layout(strategy) || has_own_layout(current_strategy))) {
+        set_last_status(ALLOC_INVALID_OPERATION);
+        unlock_heap();
+        return;
+    }
+    current_strategy = strategy;
+    if (best_fit_indexed()) {
+        rebuild_fit_tree();
+    }
+    unlock_heap();
+}
+
+/**
+ * @brief Sets where fit searches and statistics read block metadata from.
+ *
+ * In METADATA_SIDE_TABLE mode every block's size and free flag are mirrored into dense
+ * arrays indexed by 16-byte granule, plus a bitmap of free block starts. Fit searches
+ * and statistics then stream through the bitmap and read the size of each free block
+ * from the array, instead of following next links through a header in every block.
+ * The headers stay in place, since heap_free and heap_realloc find and validate a
+ * block from its header; the integrity checks compare each header against its side
+ * table entry, so a header overwritten by a payload overflow is detected.
+ *
+ * @param mode The new metadata mode.
+ *
+ * @return void
+ */
+void set_metadata_mode(MetadataMode mode) {
+    lock_heap();
+    metadata_mode = mode;
+    if (mode == METADATA_SIDE_TABLE) {
+        rebuild_side_table();
+    } else {
+        rebuild_free_list();
+        if (best_fit_indexed()) {
+            rebuild_fit_tree();
+        }
+    }
+    unlock_heap();
+}
+
+/**
+ * @brief Gets the allocation strategy of the process heap.
+ *
+ * @return AllocationStrategy The current strategy.
+ */
+AllocationStrategy get_allocation_strategy() {
+    lock_heap();
+    AllocationStrategy strategy = current_strategy;
+    unlock_heap();
+    return strategy;
+}
+
+/**
+ * @brief Gets the metadata mode of the process heap.
+ *
+ * @return MetadataMode The current metadata mode.
+ */
+MetadataMode get_metadata_mode() {
+    lock_heap();
+    MetadataMode mode = metadata_mode;
+    unlock_heap();
+    return mode;
+}
+
+/**
+ * @brief Gets the number of allocated blocks in the heap.
+ *
+ * This function traverses the heap and counts the number of allocated blocks.
+ *
+ * @return size_t The number of allocated blocks.
+ */
+size_t get_alloc_count() {
+    lock_heap();
+    if (has_own_layout(current_strategy)) {
+        size_t count = own_layout_totals(false, NULL);
+        unlock_heap();
+        return count;
+    }
+    if (metadata_mode == METADATA_SIDE_TABLE) {
+        size_t count = side_table_totals(false, NULL) - side_table_totals(true, NULL);
+        unlock_heap();
+        return count;
+    }
+    size_t count = 0;
+    BlockHeader* curr_block = first_block;
+    while (curr_block != NULL) {
+        if (curr_block->free == false) {
+            count++;
+        }
+        curr_block = NEXT_BLOCK(curr_block);
+    }
+    unlock_heap();
+    return count;
+}
+
+/**
+ * @brief Gets the number of free blocks in the heap.
+ *
+ * This function traverses the heap and counts the number of free blocks.
+ *
+ * @return size_t The number of free blocks.
+ */
+size_t get_free_block_count() {
+    lock_heap();
+    if (has_own_layout(current_strategy)) {
+        size_t count = own_layout_totals(true, NULL);
+        unlock_heap();
+        return count;
+    }
+    if (metadata_mode == METADATA_SIDE_TABLE) {
+        size_t count = side_table_totals(true, NULL);
+        unlock_heap();
+        return count;
+    }
+    size_t count = 0;
+    BlockHeader* curr_block = first_block;
+    while (curr_block != NULL) {
+        if (curr_block->free == true) {
+            count++;
+        }
+        curr_block = NEXT_BLOCK(curr_block);
+    }
+    unlock_heap();
+    return count;
+}
+
+/**
+ * @brief Sums the sizes of all blocks without taking the heap mutex (see get_used_heap_size).
+ */
+static size_t used_heap_size() {
+    if (has_own_layout(current_strategy)) {
+        // Every granule below heap_size belongs to an allocation or a free run
+        return heap_size;
+    }
+    size_t size = 0;
+    for (BlockHeader* curr_block = first_block; curr_block != NULL; curr_block = NEXT_BLOCK(curr_block)) {
+        size += curr_block->size;
+    }
+    return size;
+}
+
+/**
+ * @brief Gets the total size of the used heap.
+ *
+ * This function traverses the heap and calculates the total size of all allocated blocks.
+ *
+ * @return size_t The total size of used heap (in bytes).
+ */
+size_t get_used_heap_size() {
+    lock_heap();
+    size_t size = used_heap_size();
+    unlock_heap();
+    return size;
+}
+
+/**
+ * @brief Sums the sizes of the free blocks without taking the heap mutex (see get_free_heap_size).
+ */
+static size_t free_heap_size() {
+    size_t size = 0;
+    if (has_own_layout(current_strategy)) {
+        own_layout_totals(true, &size);
+        return size;
+    }
+    if (metadata_mode == METADATA_SIDE_TABLE) {
+        side_table_totals(true, &size);
+        return size;
+    }
+    for (BlockHeader* curr_block = first_block; curr_block != NULL; curr_block = NEXT_BLOCK(curr_block)) {
+        if (curr_block->free == true) {
+            size += curr_block->size;
+        }
+    }
+    return size;
+}
+
+/**
+ * @brief Gets the total size of the free heap.
+ *
+ * This function traverses the heap and calculates the total size of all free blocks.
+ *
+ * @return size_t The total size of free heap (in bytes).
+ */
+size_t get_free_heap_size() {
+    lock_heap();
+    size_t size = free_heap_size();
+    unlock_heap();
+    return size;
+}
+
+/**
+ * @brief Gets the fragmentation ratio of the heap.
+ *
+ * This function calculates the fragmentation ratio of the heap by dividing
+ * the average size of free blocks by the total size of free memory.
+ *
+ * @return double The fragmentation ratio (0.0 if no free blocks).
+ */
+double get_fragmentation_ratio() {
+    size_t free_block_count = 0;
+    size_t total_free_size = 0;
+
+    lock_heap();
+    if (has_own_layout(current_strategy)) {
+        free_block_count = own_layout_totals(true, &total_free_size);
+    } else if (metadata_mode == METADATA_SIDE_TABLE) {
+        free_block_count = side_table_totals(true, &total_free_size);
+    } else {
+        BlockHeader* curr_block = first_block;
+        while (curr_block != NULL) {
+            if (curr_block->free) {
+                free_block_count++;
+                total_free_size += curr_block->size;
+            }
+            curr_block = NEXT_BLOCK(curr_block);
+        }
+    }
+    unlock_heap();
+
+    if (free_block_count == 0 || total_free_size == 0) {
+        return 0.0;
+    }
+
+    double avg_free_block_size = (double)total_free_size / free_block_count;
+    return avg_free_block_size / total_free_size;
+}
+
+/**
+ * @brief Gets the number of fit searches since the heap was last reset.
+ *
+ * @return size_t The number of searches run by heap_alloc.
+ */
+size_t get_fit_search_count() {
+    lock_heap();
+    size_t count = fit_searches;
+    unlock_heap();
+    return count;
+}
+
+/**
+ * @brief Gets the metadata entries examined by fit searches since the heap was last reset.
+ *
+ * Entries are blocks for list walks and side-table first/next fit, tree nodes for the
+ * best-fit index and 64-granule chunks for side-table best/worst fit. Divided by
+ * get_fit_search_count it gives the average search length.
+ *
+ * @return size_t The number of entries examined.
+ */
+size_t get_fit_search_steps() {
+    lock_heap();
+    size_t steps = fit_search_steps;
+    unlock_heap();
+    return steps;
+}
+
+/**
+ * @brief Gets the start of the process heap.
+ *
+ * The process heap never moves, so no lock is needed.
+ *
+ * @return char* The first byte of the process heap.
+ */
+char* get_heap_base() {
+    return process_heap;
+}
+
+/**
+ * @brief Gets the extent of the process heap: the bytes up to the end of its last block.
+ *
+ * @return size_t The heap's extent (in bytes).
+ */
+size_t get_heap_size() {
+    lock_heap();
+    size_t size = heap_size;
+    unlock_heap();
+    return size;
+}
+
+/**
+ * @brief Gets the first block of the process heap.
+ *
+ * @return BlockHeader* The first block, or NULL if the heap is empty or uses the
+ *         header-less BITMAP or BUDDY layout.
+ */
+BlockHeader* get_first_block() {
+    lock_heap();
+    BlockHeader* block = first_block;
+    unlock_heap();
+    return block;
+}
+
+/**
+ * @brief Gets the extent of the active heap for the BITMAP and BUDDY modules.
+ *
+ * Unlike get_heap_size this takes no lock; the caller already holds the heap mutex.
+ *
+ * @return size_t The heap's extent (in bytes).
+ */
+size_t heap_extent() {
+    return heap_size;
+}
+
+/**
+ * @brief Sets the extent of the active heap for the BITMAP and BUDDY modules (heap mutex held).
+ *
+ * @param size The new extent, a multiple of ALIGNMENT no larger than the heap's capacity.
+ *
+ * @return void
+ */
+void heap_set_extent(size_t size) {
+    heap_size = size;
+}
+
+/**
+ * @brief Gets the last status of the allocator.
+ *
+ * This function retrieves the last status code set by the allocator.
+ *
+ * @return AllocatorStatus The last status code.
+ */
+AllocatorStatus get_last_status() {
+    AllocatorStatus status = last_status;
+    return status;
+}
+
+/**
+ * @brief Points an Allocator's state at its bitmap and heap from its size.
+ *
+ * The layout depends only on the Allocator's address and size, so it is recomputed
+ * the same way wherever the heap is mapped.
+ *
+ * @return bool False if the buffer is too small for a heap.
+ */
+static bool place_heap(Allocator* allocator) {
+    uintptr_t start = (uintptr_t)allocator;
+    size_t header = align(sizeof(Allocator));
+
+    // The bitmap needs a bit per granule of what is left after it, so sizing it from
+    // everything after the header is always enough
+    size_t rest = allocator->size - header;
+    size_t words = (rest / ALIGNMENT + 63) / 64;
+    size_t map_bytes = align(words * sizeof(uint64_t));
+    if (rest <= map_bytes + sizeof(BlockHeader) + ALIGNMENT) {
+        return false;
+    }
+
+    allocator->state.map = (uint64_t*)(start + header);
+    allocator->state.map_words = words;
+    allocator->state.base = (char*)(start + header + map_bytes);
+    allocator->state.capacity = (rest - map_bytes) & ~(size_t)(ALIGNMENT - 1);
+    return true;
+}
+
+/**
+ * @brief Moves an Allocator's state to the address it is mapped at in this process.
+ *
+ * The block pointers in state were saved by whichever process last used the heap, so
+ * they are shifted by the distance between that process's heap base and ours.
+ *
+ * @return bool False if the buffer is too small for a heap.
+ */
+static bool rebase_heap(Allocator* allocator) {
+    HeapState* state = &allocator->state;
+    uintptr_t old_base = (uintptr_t)state->base;
+    if (!place_heap(allocator)) {
+        return false;
+    }
+    uintptr_t delta = (uintptr_t)state->base - old_base;   // wraps when moving down
+    BlockHeader** pointers[] = { &state->first, &state->last, &state->verify_next,
+                                 &state->fit_next, &state->compact_next };
+    for (size_t i = 0; i < sizeof(pointers) / sizeof(pointers[0]); i++) {
+        if (*pointers[i] != NULL) {
+            *pointers[i] = (BlockHeader*)((uintptr_t)*pointers[i] + delta);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Locks an instance's mutex and makes its state the calling thread's active heap.
+ *
+ * Each instance has its own mutex, so threads working on different heaps do not wait
+ * for each other. If a shared heap's previous owner died holding its mutex, the heap is
+ * re-verified from the start, and any damage left by the interrupted operation is
+ * reported through heap_verify_get_corruption.
+ *
+ * @param allocator Instance to operate on.
+ *
+ * @return HeapState* The previously active heap, for unbind_allocator.
+ */
+static HeapState* bind_allocator(Allocator* allocator) {
+    bool owner_died = pthread_mutex_lock(&allocator->mutex) == EOWNERDEAD;
+    if (owner_died) {
+        pthread_mutex_consistent(&allocator->mutex);
+    }
+    if (allocator->shared) {
+        rebase_heap(allocator);
+    }
+    HeapState* saved = active_heap;
+    active_heap = &allocator->state;
+    if (owner_died) {
+        verify_cursor = NULL;
+        verify_step(SIZE_MAX);
+    }
+    return saved;
+}
+
+/**
+ * @brief Makes the previously active heap active again and unlocks the instance.
+ */
+static void unbind_allocator(Allocator* allocator, HeapState* saved) {
+    active_heap = saved;
+    pthread_mutex_unlock(&allocator->mutex);
+}
+
+/**
+ * @brief Initializes an Allocator's mutex, process-shared and robust for a shared heap.
+ */
+static void init_allocator_mutex(Allocator* allocator) {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    if (allocator->shared) {
+        pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    }
+    pthread_mutex_init(&allocator->mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+/**
+ * @brief Sets up an Allocator over size bytes at an aligned address.
+ *
+ * @param shared Whether other processes will map the heap (see heap_open_shared).
+ *
+ * @return bool False if the buffer is too small for a heap.
+ */
+static bool init_allocator(Allocator* allocator, size_t size, bool shared) {
+    memset(allocator, 0, sizeof(Allocator));
+    allocator->size = size;
+    if (!place_heap(allocator)) {
+        return false;
+    }
+    allocator->layout_version = HEAP_LAYOUT_VERSION;
+    allocator->state.strategy = FIRST_FIT;
+    allocator->state.mode = METADATA_INLINE;
+    allocator->state.list_head = FREE_LIST_END;
+    allocator->shared = shared;
+    init_allocator_mutex(allocator);
+
+    // Instances start with the process's canary key; lock_heap makes sure it is picked
+    lock_heap();
+    allocator->state.secret = process_heap_state.secret;
+    unlock_heap();
+
+    __atomic_store_n(&allocator->magic, HEAP_FILE_MAGIC, __ATOMIC_RELEASE);
+    return true;
+}
+
+/**
+ * @brief Creates an allocator instance over a caller-supplied buffer.
+ *
+ * The instance is independent of the process heap and of other instances: its blocks,
+ * strategy and statistics are its own, and it is reset or dropped without touching
+ * them. The Allocator and a free-block bitmap (one bit per 16 bytes) are placed at the
+ * start of the buffer. Instances support the FIRST_FIT, BEST_FIT, WORST_FIT and
+ * NEXT_FIT strategies with inline metadata. Each instance has its own mutex, so threads
+ * working on different heaps run in parallel.
+ *
+ * @param buffer Memory for the instance; it must outlive the instance.
+ * @param size Size of the buffer in bytes.
+ *
+ * @return Allocator* The new instance, or NULL if the buffer is too small (or larger
+ *         than 4 GB).
+ */
+Allocator* allocator_create(void* buffer, size_t size) {
+    uintptr_t start = ((uintptr_t)buffer + ALIGNMENT - 1) & ~(uintptr_t)(ALIGNMENT - 1);
+    if (buffer == NULL || size < (start - (uintptr_t)buffer) + align(sizeof(Allocator)) ||
+        size > UINT32_MAX) {
+        set_last_status(ALLOC_ERROR);
+        return NULL;
+    }
+
+    Allocator* allocator = (Allocator*)start;
+    if (!init_allocator(allocator, size - (start - (uintptr_t)buffer), false)) {
+        set_last_status(ALLOC_ERROR);
+        return NULL;
+    }
+    set_last_status(ALLOC_SUCCESS);
+    return allocator;
+}
+
+/**
+ * @brief Creates an allocator instance over its own anonymous memory mapping.
+ *
+ * @param size Size of the mapping in bytes (the Allocator and its bitmap come out of it).
+ *
+ * @return Allocator* The new instance, or NULL if the mapping failed.
+ */
+Allocator* allocator_create_mapped(size_t size) {
+    void* region = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED) {
+        set_last_status(ALLOC_OUT_OF_MEMORY);
+        return NULL;
+    }
+    Allocator* allocator = allocator_create(region, size);
+    if (allocator == NULL) {
+        munmap(region, size);
+        return NULL;
+    }
+    allocator->mapped_size = size;
+    return allocator;
+}
+
+/**
+ * @brief Checks an existing heap once when it is opened.
+ *
+ * Everything but the base pointers comes from the file, so the whole heap is checked
+ * as check_heap_integrity_in would, the strategy and metadata mode must be ones an
+ * instance can use, and the saved cursors must be blocks on the list.
+ *
+ * @return bool True if the heap can be used.
+ */
+static bool opened_heap_valid(Allocator* allocator) {
+    HeapState* saved = bind_allocator(allocator);
+    bool valid = !has_own_layout(current_strategy) && current_strategy <= NEXT_FIT &&
+                 metadata_mode == METADATA_INLINE && check_integrity();
+    BlockHeader** cursors[] = { &verify_cursor, &next_fit_cursor, &compact_cursor };
+    for (size_t i = 0; valid && i < sizeof(cursors) / sizeof(cursors[0]); i++) {
+        BlockHeader* curr = first_block;
+        while (curr != NULL && curr != *cursors[i]) {
+            curr = NEXT_BLOCK(curr);
+        }
+        valid = curr == *cursors[i];
+    }
+    unbind_allocator(allocator, saved);
+    return valid;
+}
+
+/**
+ * @brief Maps a heap file or shared memory object and sets up or checks its Allocator.
+ *
+ * The descriptor is closed whatever happens.
+ *
+ * @param fd Descriptor opened for reading and writing.
+ * @param length Size of the object in bytes.
+ * @param fresh Whether to create a new heap rather than open the one in the object.
+ * @param shared Whether other processes map the object at the same time.
+ *
+ * @return Allocator* The heap, or NULL if the object could not be mapped (ALLOC_ERROR)
+ *         or holds no ready, intact heap of this layout version and kind
+ *         (ALLOC_HEAP_ERROR).
+ */
+static Allocator* map_heap(int fd, size_t length, bool fresh, bool shared) {
+    void* region = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (region == MAP_FAILED) {
+        set_last_status(ALLOC_ERROR);
+        return NULL;
+    }
+
+    Allocator* allocator = region;
+    if (fresh) {
+        if (length > UINT32_MAX || !init_allocator(allocator, length, shared)) {
+            set_last_status(ALLOC_ERROR);
+            allocator = NULL;
+        }
+    } else if (length < sizeof(Allocator) ||
+               __atomic_load_n(&allocator->magic, __ATOMIC_ACQUIRE) != HEAP_FILE_MAGIC ||
+               allocator->layout_version != HEAP_LAYOUT_VERSION || allocator->size != length ||
+               allocator->shared != shared) {
+        set_last_status(ALLOC_HEAP_ERROR);
+        allocator = NULL;
+    } else if (!shared && !rebase_heap(allocator)) {
+        set_last_status(ALLOC_HEAP_ERROR);
+        allocator = NULL;
+    } else {
+        if (!shared) {
+            // Only the base pointers are stale; the blocks and free list are offsets.
+            // A shared heap is rebased each time it is locked instead. A heap file has
+            // a single user, so whatever state its mutex was left in is stale too.
+            init_allocator_mutex(allocator);
+        }
+        if (!opened_heap_valid(allocator)) {
+            set_last_status(ALLOC_HEAP_ERROR);
+            allocator = NULL;
+        }
+    }
+    if (allocator == NULL) {
+        munmap(region, length);
+        return NULL;
+    }
+    allocator->mapped_size = length;
+    set_last_status(ALLOC_SUCCESS);
+    return allocator;
+}
+
+/**
+ * @brief Opens a heap kept in a file, creating the file if it does not exist.
+ *
+ * The file is mapped shared, so the heap's blocks and the allocator's own state live
+ * in the file. Block links, free list links and the root are offsets from the heap
+ * base, so reopening the file in a later process only recomputes a few base pointers:
+ * nothing is rebuilt, and pointers into the heap are recovered from offsets with
+ * heap_get_root. A heap file must not be open twice at the same time; use
+ * heap_open_shared for a heap that several processes use at once.
+ *
+ * @param path Path of the heap file.
+ * @param size Size of a new file in bytes (an existing file keeps its size).
+ *
+ * @return Allocator* The heap, or NULL if the file could not be opened or mapped
+ *         (ALLOC_ERROR) or holds no heap of this layout version (ALLOC_HEAP_ERROR).
+ */
+Allocator* heap_open(const char* path, size_t size) {
+    int fd = open(path, O_RDWR | O_CREAT, 0600);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        set_last_status(ALLOC_ERROR);
+        return NULL;
+    }
+
+    bool fresh = st.st_size == 0;
+    size_t length = fresh ? size : (size_t)st.st_size;
+    if (length == 0 || (fresh && ftruncate(fd, (off_t)length) != 0)) {
+        close(fd);
+        set_last_status(ALLOC_ERROR);
+        return NULL;
+    }
+    return map_heap(fd, length, fresh, false);
+}
+
+/**
+ * @brief Opens a heap in a POSIX shared memory object, creating it if it does not exist.
+ *
+ * Any number of processes can open the same name and allocate and free in the heap at
+ * the same time. Each maps the heap at its own address, so pointers must not be passed
+ * between processes: pass heap_offset_in offsets instead and turn them back into
+ * pointers with heap_pointer_in. Operations are serialized by a robust process-shared
+ * mutex in the heap, so a process that dies mid-operation does not leave the heap
+ * locked; the next process to lock it re-verifies the heap (see bind_allocator).
+ *
+ * A process that opens the heap while its creator is still setting it up gets
+ * ALLOC_HEAP_ERROR and can simply retry.
+ *
+ * @param name Name of the shared memory object, such as "/workers".
+ * @param size Size of a new object in bytes (an existing object keeps its size).
+ *
+ * @return Allocator* The heap, or NULL if the object could not be opened or mapped
+ *         (ALLOC_ERROR) or holds no ready shared heap of this layout version
+ *         (ALLOC_HEAP_ERROR).
+ */
+Allocator* heap_open_shared(const char* name, size_t size) {
+    // Exactly one opener creates the object, and only it sets up the heap
+    bool fresh = true;
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0 && errno == EEXIST) {
+        fresh = false;
+        fd = shm_open(name, O_RDWR, 0600);
+    }
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        set_last_status(ALLOC_ERROR);
+        return NULL;
+    }
+
+    size_t length = fresh ? size : (size_t)st.st_size;
+    if (fresh && (length == 0 || ftruncate(fd, (off_t)length) != 0)) {
+        close(fd);
+        shm_unlink(name);
+        set_last_status(ALLOC_ERROR);
+        return NULL;
+    }
+    if (length == 0) {
+        // Created but not sized yet
+        close(fd);
+        set_last_status(ALLOC_HEAP_ERROR);
+        return NULL;
+    }
+    Allocator* allocator = map_heap(fd, length, fresh, true);
+    if (allocator == NULL && fresh) {
+        shm_unlink(name);
+    }
+    return allocator;
+}
+
+/**
+ * @brief Removes a shared heap's name, so later heap_open_shared calls create a new heap.
+ *
+ * Processes that have the heap open keep using it; its memory is released when the
+ * last of them closes it with allocator_destroy.
+ *
+ * @param name Name given to heap_open_shared.
+ *
+ * @return bool True if the name was removed.
+ */
+bool heap_unlink_shared(const char* name) {
+    bool removed = shm_unlink(name) == 0;
+    set_last_status(removed ? ALLOC_SUCCESS : ALLOC_ERROR);
+    return removed;
+}
+
+/**
+ * @brief Gets a block's offset in an allocator instance, for passing to another process.
+ *
+ * @param allocator Heap the block was allocated from.
+ * @param ptr Pointer returned by heap_alloc_in or heap_realloc_in (may be NULL).
+ *
+ * @return size_t The block's offset, or 0 for NULL (no block is at offset 0).
+ */
+size_t heap_offset_in(Allocator* allocator, void* ptr) {
+    HeapState* saved = bind_allocator(allocator);
+    size_t offset = ptr == NULL ? 0 : (size_t)((char*)ptr - heap);
+    unbind_allocator(allocator, saved);
+    return offset;
+}
+
+/**
+ * @brief Gets the pointer at an offset from heap_offset_in, in this process's mapping.
+ *
+ * @param allocator Heap the offset belongs to.
+ * @param offset Offset from heap_offset_in (0 for NULL).
+ *
+ * @return void* The block at the offset, or NULL for offset 0.
+ */
+void* heap_pointer_in(Allocator* allocator, size_t offset) {
+    HeapState* saved = bind_allocator(allocator);
+    void* ptr = offset == 0 ? NULL : heap + offset;
+    unbind_allocator(allocator, saved);
+    return ptr;
+}
+
+/**
+ * @brief Writes a file-backed heap's changes to its file.
+ *
+ * @param allocator Heap from heap_open.
+ *
+ * @return bool True once the data is on disk, false if the heap is not file-backed or
+ *         the write failed.
+ */
+bool heap_sync(Allocator* allocator) {
+    if (allocator->mapped_size == 0) {
+        set_last_status(ALLOC_INVALID_OPERATION);
+        return false;
+    }
+    HeapState* saved = bind_allocator(allocator);
+    bool synced = msync(allocator, allocator->mapped_size, MS_SYNC) == 0;
+    unbind_allocator(allocator, saved);
+    set_last_status(synced ? ALLOC_SUCCESS : ALLOC_ERROR);
+    return synced;
+}
+
+/**
+ * @brief Records an application's root object, so it can be found after heap_open.
+ *
+ * @param allocator Heap the object was allocated from.
+ * @param ptr The root object, or NULL to clear it.
+ *
+ * @return void
+ */
+void heap_set_root(Allocator* allocator, void* ptr) {
+    HeapState* saved = bind_allocator(allocator);
+    allocator->root = ptr == NULL ? 0 : (size_t)((char*)ptr - heap);
+    unbind_allocator(allocator, saved);
+}
+
+/**
+ * @brief Gets the root object recorded with heap_set_root.
+ *
+ * @param allocator Heap to look in.
+ *
+ * @return void* The root object at the heap's current address, or NULL if none is set.
+ */
+void* heap_get_root(Allocator* allocator) {
+    HeapState* saved = bind_allocator(allocator);
+    void* root = allocator->root == 0 ? NULL : heap + allocator->root;
+    unbind_allocator(allocator, saved);
+    return root;
+}
+
+/**
+ * @brief Destroys an allocator instance, unmapping it if it owns its memory.
+ *
+ * Every pointer allocated from the instance becomes invalid. A caller-supplied buffer
+ * can be reused once this returns. For a shared heap only this process's mapping is
+ * released; other processes keep using the heap.
+ *
+ * @param allocator Instance to destroy (may be NULL).
+ *
+ * @return void
+ */
+void allocator_destroy(Allocator* allocator) {
+    if (allocator != NULL && allocator->mapped_size != 0) {
+        munmap(allocator, allocator->mapped_size);
+    }
+}
+
+/**
+ * @brief Releases every block of an allocator instance in O(1).
+ *
+ * Nothing is written to the heap; the instance simply forgets its blocks, and the
+ * free-block bitmap is cleared when the first block is allocated again. The strategy
+ * is kept.
+ *
+ * @param allocator Instance to reset.
+ *
+ * @return void
+ */
+void allocator_reset(Allocator* allocator) {
+    HeapState* saved = bind_allocator(allocator);
+    heap_size = 0;
+    first_block = NULL;
+    unbind_allocator(allocator, saved);
+}
+
+/**
+ * @brief Releases every block of the process heap in O(1).
+ *
+ * Like allocator_reset, the heap memory is not cleared; the strategy and metadata mode
+ * are kept, and auxiliary metadata is rebuilt when the first block is allocated.
+ *
+ * @return void
+ */
+void heap_reset() {
+    lock_heap();
+    heap_size = 0;
+    first_block = NULL;
+    unlock_heap();
+}
+
+/**
+ * @brief Describes the process heap in a snapshot header (heap mutex held).
+ *
+ * @return size_t Size of the whole snapshot in bytes.
+ */
+static size_t describe_snapshot(HeapSnapshot* snapshot) {
+    memset(snapshot, 0, sizeof(HeapSnapshot));
+    snapshot->magic = HEAP_SNAPSHOT_MAGIC;
+    snapshot->layout_version = HEAP_LAYOUT_VERSION;
+    snapshot->size = heap_size;
+    snapshot->map_words = (heap_size / ALIGNMENT + 63) / 64;
+    snapshot->last = first_block != NULL ? (uint64_t)((char*)last_block - heap) : 0;
+    snapshot->fit_next = next_fit_cursor != NULL ? (uint64_t)((char*)next_fit_cursor - heap)
+                                                        : SNAPSHOT_NO_BLOCK;
+    snapshot->searches = fit_searches;
+    snapshot->search_steps = fit_search_steps;
+    snapshot->secret = canary_secret;
+    snapshot->list_head = free_list_head;
+    snapshot->strategy = (uint8_t)current_strategy;
+    snapshot->mode = (uint8_t)metadata_mode;
+    return sizeof(HeapSnapshot) + heap_size + snapshot->map_words * sizeof(uint64_t);
+}
+
+/**
+ * @brief Checks that a snapshot header describes an image the process heap can take.
+ *
+ * @return AllocatorStatus ALLOC_SUCCESS, ALLOC_INVALID_OPERATION if the snapshot or the
+ *         heap uses BITMAP or BUDDY, or ALLOC_HEAP_ERROR if the header is not valid.
+ */
+static AllocatorStatus check_snapshot(const HeapSnapshot* snapshot) {
+    if (snapshot->magic != HEAP_SNAPSHOT_MAGIC || snapshot->layout_version != HEAP_LAYOUT_VERSION ||
+        snapshot->size > heap_capacity || snapshot->size % ALIGNMENT != 0 ||
+        snapshot->map_words != (snapshot->size / ALIGNMENT + 63) / 64 ||
+        snapshot->strategy > BUDDY || snapshot->mode > METADATA_SIDE_TABLE ||
+        (snapshot->size != 0 && snapshot->last >= snapshot->size) ||
+        (snapshot->fit_next != SNAPSHOT_NO_BLOCK && snapshot->fit_next >= snapshot->size)) {
+        return ALLOC_HEAP_ERROR;
+    }
+    if (has_own_layout((AllocationStrategy)snapshot->strategy) || has_own_layout(current_strategy)) {
+        return ALLOC_INVALID_OPERATION;
+    }
+    return ALLOC_SUCCESS;
+}
+
+/**
+ * @brief Checks a snapshot image before it replaces the process heap (heap mutex held).
+ *
+ * The image is checked where it lies, through a HeapState over its bytes, so a
+ * malformed image is refused while the current heap is still intact. Every block must
+ * pass check_block_layout under the image's canary secret, and the last block and the
+ * next-fit cursor must be on the block list. Inline images then get the whole
+ * check_integrity, as their free list and free_map are adopted as they are; side-table
+ * images have theirs rebuilt from the block list.
+ *
+ * @return bool True if the image can be adopted.
+ */
+static bool snapshot_valid(const HeapSnapshot* snapshot, const char* bytes, const uint64_t* map) {
+    HeapState image = {
+        .base = (char*)bytes,
+        .capacity = snapshot->size,
+        .size = snapshot->size,
+        .first = snapshot->size != 0 ? (BlockHeader*)bytes : NULL,
+        .last = snapshot->size != 0 ? (BlockHeader*)(bytes + snapshot->last) : NULL,
+        .strategy = (AllocationStrategy)snapshot->strategy,
+        .mode = (MetadataMode)snapshot->mode,
+        .map = (uint64_t*)map,
+        .map_words = snapshot->map_words,
+        .list_head = snapshot->list_head,
+        .secret = snapshot->secret,
+    };
+    HeapState* saved = active_heap;
+    active_heap = &image;
+
+    AllocatorStatus status = ALLOC_HEAP_ERROR;
+    bool valid = true;
+    bool fit_next_found = snapshot->fit_next == SNAPSHOT_NO_BLOCK;
+    BlockHeader* curr = first_block;
+    while (curr != NULL) {
+        if (check_block_layout(curr, &status) != NULL) {
+            valid = false;
+            break;
+        }
+        fit_next_found |= block_offset(curr) == snapshot->fit_next;
+        if (NEXT_BLOCK(curr) == NULL) {
+            valid = block_offset(curr) == snapshot->last;
+        }
+        curr = NEXT_BLOCK(curr);
+    }
+    valid = valid && fit_next_found;
+    if (valid && metadata_mode == METADATA_INLINE) {
+        valid = check_integrity();
+    }
+
+    active_heap = saved;
+    return valid;
+}
+
+/**
+ * @brief Replaces the process heap with a snapshot image (heap mutex held).
+ *
+ * The image is checked first, so the heap is untouched if it is refused. The restored
+ * blocks are stamped with this process's canary secret rather than adopting the
+ * image's, and metadata kept outside the heap (the best-fit index or the side table)
+ * is rebuilt.
+ *
+ * @param snapshot Header that passed check_snapshot.
+ * @param bytes The heap bytes, followed by the free_map words.
+ *
+ * @return AllocatorStatus ALLOC_SUCCESS, or ALLOC_HEAP_ERROR if the image is malformed.
+ */
+static AllocatorStatus restore_image(const HeapSnapshot* snapshot, const char* bytes) {
+    const uint64_t* map = (const uint64_t*)(bytes + snapshot->size);
+    if (!snapshot_valid(snapshot, bytes, map)) {
+        return ALLOC_HEAP_ERROR;
+    }
+
+    memcpy(heap, bytes, snapshot->size);
+    memcpy(free_map, map, snapshot->map_words * sizeof(uint64_t));
+    memset(free_map + snapshot->map_words, 0, (free_map_words - snapshot->map_words) * sizeof(uint64_t));
+    heap_size = snapshot->size;
+    first_block = heap_size != 0 ? (BlockHeader*)heap : NULL;
+    last_block = heap_size != 0 ? (BlockHeader*)(heap + snapshot->last) : NULL;
+    next_fit_cursor = snapshot->fit_next != SNAPSHOT_NO_BLOCK ?
+                      (BlockHeader*)(heap + snapshot->fit_next) : NULL;
+    verify_cursor = NULL;
+    reset_handles();
+    fit_searches = snapshot->searches;
+    fit_search_steps = snapshot->search_steps;
+    free_list_head = snapshot->list_head;
+    current_strategy = (AllocationStrategy)snapshot->strategy;
+    metadata_mode = (MetadataMode)snapshot->mode;
+    for (BlockHeader* curr = first_block; curr != NULL; curr = NEXT_BLOCK(curr)) {
+        stamp_block(curr);
+    }
+    if (metadata_mode == METADATA_SIDE_TABLE) {
+        rebuild_side_table();
+    } else if (best_fit_indexed()) {
+        rebuild_fit_tree();
+    } else {
+        fit_tree_reset();
+    }
+    return ALLOC_SUCCESS;
+}
+
+/**
+ * @brief Checks that the process heap can be snapshotted (heap mutex held).
+ *
+ * Heaps using BITMAP or BUDDY keep their state in separate tables. The handle table
+ * is not part of a snapshot either, so a heap with live handles is refused: restored
+ * handle blocks could be neither freed nor moved.
+ *
+ * @return bool True if describe_snapshot captures the whole heap.
+ */
+static bool snapshot_allowed() {
+    if (has_own_layout(current_strategy)) {
+        return false;
+    }
+    // heap_reset leaves the table to be cleared when the first block is allocated
+    for (uint32_t i = 0; first_block != NULL && i < handle_count; i++) {
+        if (handle_table[i].offset != HANDLE_UNUSED) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Writes a compact binary snapshot of the process heap into a buffer.
+ *
+ * The snapshot holds the used part of the heap (heap_size bytes, not the whole
+ * capacity) and the allocator's state, so heap_restore brings back a byte-identical
+ * heap. Call with a NULL buffer to learn the size. Heaps using BITMAP or BUDDY keep
+ * their state in separate tables and cannot be snapshotted, nor can a heap with live
+ * handles (see heap_restore).
+ *
+ * @param buffer Buffer for the snapshot, or NULL.
+ * @param capacity Size of the buffer in bytes.
+ *
+ * @return size_t Size of the snapshot in bytes (nothing is written if it exceeds
+ *         capacity), or 0 if the heap cannot be snapshotted.
+ */
+size_t heap_snapshot(void* buffer, size_t capacity) {
+    lock_heap();
+    if (!snapshot_allowed()) {
+        unlock_heap();
+        set_last_status(ALLOC_INVALID_OPERATION);
+        return 0;
+    }
+    HeapSnapshot snapshot;
+    size_t size = describe_snapshot(&snapshot);
+    if (buffer != NULL && size <= capacity) {
+        char* out = buffer;
+        memcpy(out, &snapshot, sizeof(snapshot));
+        memcpy(out + sizeof(snapshot), heap, heap_size);
+        memcpy(out + sizeof(snapshot) + heap_size, free_map, snapshot.map_words * sizeof(uint64_t));
+    }
+    unlock_heap();
+    set_last_status(ALLOC_SUCCESS);
+    return size;
+}
+
+/**
+ * @brief Replaces the process heap with a snapshot from heap_snapshot.
+ *
+ * Every pointer into the current heap becomes invalid, and pointers from when the
+ * snapshot was taken become valid again. The strategy and metadata mode are restored
+ * too. Sampled allocations known to the profiler are not part of a snapshot.
+ *
+ * Handles are not part of a snapshot either: heap_snapshot refuses a heap with live
+ * handles, so a snapshot never holds a handle's block, and restoring one invalidates
+ * every handle of the current heap.
+ *
+ * The image's block list (and, in inline mode, its free list) is checked before the
+ * heap is touched. Restored blocks are stamped with this process's canary secret; the
+ * image's secret is only used to check its canaries.
+ *
+ * @param snapshot The snapshot.
+ * @param size Size of the snapshot in bytes.
+ *
+ * @return bool True if the heap was restored; false (and the heap is unchanged) if the
+ *         snapshot is not valid (ALLOC_HEAP_ERROR) or BITMAP or BUDDY is involved
+ *         (ALLOC_INVALID_OPERATION).
+ */
+bool heap_restore(const void* snapshot, size_t size) {
+    HeapSnapshot header;
+    if (size < sizeof(header)) {
+        set_last_status(ALLOC_HEAP_ERROR);
+        return false;
+    }
+    memcpy(&header, snapshot, sizeof(header));
+
+    lock_heap();
+    AllocatorStatus status = check_snapshot(&header);
+    if (status == ALLOC_SUCCESS &&
+        size != sizeof(header) + header.size + header.map_words * sizeof(uint64_t)) {
+        status = ALLOC_HEAP_ERROR;
+    }
+    if (status == ALLOC_SUCCESS) {
+        status = restore_image(&header, (const char*)snapshot + sizeof(header));
+    }
+    unlock_heap();
+    set_last_status(status);
+    return status == ALLOC_SUCCESS;
+}
+
+/**
+ * @brief Writes all of a buffer to a file descriptor, retrying short writes.
+ */
+static bool write_all(int fd, const void* data, size_t size) {
+    const char* p = data;
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+/**
+ * @brief Fills a buffer from a file descriptor, retrying short reads.
+ */
+static bool read_all(int fd, void* data, size_t size) {
+    char* p = data;
+    while (size > 0) {
+        ssize_t n = read(fd, p, size);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
         }
+        p += n;
+        size -= (size_t)n;
     }
+    return true;
 }
 
 /**
- * @brief Sets the last status of the allocator.
+ * @brief Writes a snapshot of the process heap to a file descriptor (see heap_snapshot).
  *
- * This function updates the last status code of the allocator.
+ * The heap is written straight from memory, without an intermediate copy.
  *
- * @param status The new status code to set.
+ * @param fd Descriptor open for writing, at the position to write the snapshot.
  *
- * @return void
+ * @return bool True if the whole snapshot was written; false with ALLOC_ERROR if a
+ *         write failed, or ALLOC_INVALID_OPERATION as for heap_snapshot.
  */
-void set_last_status(AllocatorStatus status) {
-    last_status = status;
+bool heap_snapshot_fd(int fd) {
+    lock_heap();
+    if (!snapshot_allowed()) {
+        unlock_heap();
+        set_last_status(ALLOC_INVALID_OPERATION);
+        return false;
+    }
+    HeapSnapshot snapshot;
+    describe_snapshot(&snapshot);
+    bool written = write_all(fd, &snapshot, sizeof(snapshot)) && write_all(fd, heap, heap_size) &&
+                   write_all(fd, free_map, snapshot.map_words * sizeof(uint64_t));
+    unlock_heap();
+    set_last_status(written ? ALLOC_SUCCESS : ALLOC_ERROR);
+    return written;
 }
 
 /**
- * @brief Sets the allocation strategy for the allocator.
+ * @brief Replaces the process heap with a snapshot read from a file descriptor.
  *
- * This function updates the current allocation strategy used by the allocator.
+ * Like heap_restore, except that the snapshot is read from a file. It is read into a
+ * scratch mapping and checked there, so the heap is unchanged if the read fails.
  *
- * @param strategy The new allocation strategy to set.
+ * @param fd Descriptor open for reading, at the start of a snapshot.
  *
- * @return void
+ * @return bool True if the heap was restored; false with ALLOC_HEAP_ERROR or
+ *         ALLOC_INVALID_OPERATION as for heap_restore, ALLOC_ERROR if the read failed,
+ *         or ALLOC_OUT_OF_MEMORY if the scratch mapping could not be created.
  */
-void set_allocation_strategy(AllocationStrategy strategy) {
-    current_strategy = strategy;
+bool heap_restore_fd(int fd) {
+    HeapSnapshot header;
+    if (!read_all(fd, &header, sizeof(header))) {
+        set_last_status(ALLOC_HEAP_ERROR);
+        return false;
+    }
+
+    lock_heap();
+    AllocatorStatus status = check_snapshot(&header);
+    if (status == ALLOC_SUCCESS) {
+        size_t length = header.size + header.map_words * sizeof(uint64_t);
+        char* image = mmap(NULL, length > 0 ? length : 1, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (image == MAP_FAILED) {
+            status = ALLOC_OUT_OF_MEMORY;
+        } else {
+            status = read_all(fd, image, length) ? restore_image(&header, image) : ALLOC_ERROR;
+            munmap(image, length > 0 ? length : 1);
+        }
+    }
+    unlock_heap();
+    set_last_status(status);
+    return status == ALLOC_SUCCESS;
 }
 
 /**
- * @brief Gets the number of allocated blocks in the heap.
- *
- * This function traverses the heap and counts the number of allocated blocks.
- *
- * @return size_t The number of allocated blocks.
+ * @brief Allocates a block from an allocator instance (see heap_alloc).
  */
-size_t get_alloc_count() {
-    size_t count = 0;
-    BlockHeader* curr_block = first_block;
-    while (curr_block != NULL) {
-        if (curr_block->free == false) {
-            count++;
-        }
-        curr_block = curr_block->next;
-    }
-    return count;
+void* heap_alloc_in(Allocator* allocator, size_t requested_bytes) {
+    HeapState* saved = bind_allocator(allocator);
+    void* ptr = alloc_block(requested_bytes);
+    unbind_allocator(allocator, saved);
+    return ptr;
 }
 
 /**
- * @brief Gets the number of free blocks in the heap.
- *
- * This function traverses the heap and counts the number of free blocks.
- *
- * @return size_t The number of free blocks.
+ * @brief Frees a block allocated from an allocator instance (see heap_free).
  */
-size_t get_free_block_count() {
-    size_t count = 0;
-    BlockHeader* curr_block = first_block;
-    while (curr_block != NULL) {
-        if (curr_block->free == true) {
-            count++;
-        }
-        curr_block = curr_block->next;
-    }
-    return count;
+void heap_free_in(Allocator* allocator, void* ptr) {
+    HeapState* saved = bind_allocator(allocator);
+    free_block(ptr);
+    unbind_allocator(allocator, saved);
 }
 
 /**
- * @brief Gets the total size of the used heap.
- *
- * This function traverses the heap and calculates the total size of all allocated blocks.
- *
- * @return size_t The total size of used heap (in bytes).
+ * @brief Resizes a block allocated from an allocator instance (see heap_realloc).
  */
-size_t get_used_heap_size() {
-    size_t size = 0;
-    BlockHeader* curr_block = first_block;
-    while (curr_block != NULL) {
-        size += curr_block->size;
-        curr_block = curr_block->next;
-    }
-    return size;
+void* heap_realloc_in(Allocator* allocator, void* ptr, size_t new_size) {
+    HeapState* saved = bind_allocator(allocator);
+    void* new_ptr = realloc_block(ptr, new_size);
+    unbind_allocator(allocator, saved);
+    return new_ptr;
 }
 
 /**
- * @brief Gets the total size of the free heap.
+ * @brief Sets an allocator instance's strategy (see set_allocation_strategy).
  *
- * This function traverses the heap and calculates the total size of all free blocks.
+ * BITMAP and BUDDY keep their metadata in process-wide tables, so instances refuse
+ * them with ALLOC_INVALID_OPERATION.
  *
- * @return size_t The total size of free heap (in bytes).
+ * @param allocator Instance to configure.
+ * @param strategy The new allocation strategy.
+ *
+ * @return void
  */
-size_t get_free_heap_size() {
-    size_t size = 0;
-    BlockHeader* curr_block = first_block;
-    while (curr_block != NULL) {
-        if (curr_block->free == true) {
-            size += curr_block->size;
-        }
-        curr_block = curr_block->next;
+void set_allocation_strategy_in(Allocator* allocator, AllocationStrategy strategy) {
+    if (has_own_layout(strategy)) {
+        set_last_status(ALLOC_INVALID_OPERATION);
+        return;
     }
-    return size;
+    HeapState* saved = bind_allocator(allocator);
+    current_strategy = strategy;
+    unbind_allocator(allocator, saved);
+    set_last_status(ALLOC_SUCCESS);
 }
 
 /**
- * @brief Gets the fragmentation ratio of the heap.
- *
- * This function calculates the fragmentation ratio of the heap by dividing
- * the average size of free blocks by the total size of free memory.
- *
- * @return double The fragmentation ratio (0.0 if no free blocks).
+ * @brief Checks the integrity of an allocator instance (see check_heap_integrity).
  */
-double get_fragmentation_ratio() {
-    size_t free_block_count = 0;
-    size_t total_free_size = 0;
-
-    BlockHeader* curr_block = first_block;
-    while (curr_block != NULL) {
-        if (curr_block->free) {
-            free_block_count++;
-            total_free_size += curr_block->size;
-        }
-        curr_block = curr_block->next;
-    }
+bool check_heap_integrity_in(Allocator* allocator) {
+    HeapState* saved = bind_allocator(allocator);
+    bool result = check_integrity();
+    unbind_allocator(allocator, saved);
+    return result;
+}
 
-    if (free_block_count == 0 || total_free_size == 0) {
-        return 0.0;
-    }
+/**
+ * @brief Gets the bytes an allocator instance's blocks occupy (see get_used_heap_size).
+ */
+size_t get_used_heap_size_in(Allocator* allocator) {
+    HeapState* saved = bind_allocator(allocator);
+    size_t size = used_heap_size();
+    unbind_allocator(allocator, saved);
+    return size;
+}
 
-    double avg_free_block_size = (double)total_free_size / free_block_count;
-    return avg_free_block_size / total_free_size;
+/**
+ * @brief Gets the bytes in an allocator instance's free blocks (see get_free_heap_size).
+ */
+size_t get_free_heap_size_in(Allocator* allocator) {
+    HeapState* saved = bind_allocator(allocator);
+    size_t size = free_heap_size();
+    unbind_allocator(allocator, saved);
+    return size;
 }
 
 /**
- * @brief Gets the last status of the allocator.
- *
- * This function retrieves the last status code set by the allocator.
- *
- * @return AllocatorStatus The last status code.
+ * @brief Gets the usable capacity of an allocator instance's heap.
  */
-AllocatorStatus get_last_status() {
-    AllocatorStatus status = last_status;
-    return status;
+size_t get_heap_capacity_in(Allocator* allocator) {
+    return allocator->state.capacity;
 }
 
 /**
@@ -710,6 +3457,7 @@ AllocatorStatus get_last_status() {
  * @return void
  */
 void print_heap() {
+    lock_heap();
     BlockHeader* curr = first_block;
     int i = 0;
     printf("Heap Layout:\n");
@@ -720,9 +3468,170 @@ void print_heap() {
         printf("  Block Data Size: %zu bytes\n", curr->size - sizeof(BlockHeader));
         printf("  Block State: %s\n", curr->free ? "Free" : "Allocated");
         printf("\n");
-        curr = curr->next;
+        curr = NEXT_BLOCK(curr);
     }
     printf("End of Heap\n");
+    unlock_heap();
+}
+
+// Upper bound on the bytes an exporter writes per block, and for everything else
+#define EXPORT_BYTES_PER_BLOCK 320
+#define EXPORT_FIXED_BYTES 1024
+
+/**
+ * ExportBuffer collects an export's output, so the heap is walked once under the
+ * mutex and the file is written with a single fwrite after it is released.
+ */
+typedef struct {
+    char* data;
+    size_t len;
+    size_t cap;
+} ExportBuffer;
+
+/**
+ * Totals an export gathers while it walks the blocks.
+ */
+typedef struct {
+    size_t alloc_blocks;
+    size_t free_blocks;
+    size_t used_size;
+    size_t free_size;
+} ExportStats;
+
+/**
+ * @brief Reserves room for exporting the heap (heap mutex held).
+ *
+ * Every block is at least a header long, which bounds the block count. The buffer is
+ * an anonymous mapping, so only the pages actually written are touched.
+ *
+ * @return bool False if the memory could not be mapped.
+ */
+static bool export_begin(ExportBuffer* out) {
+    out->len = 0;
+    out->cap = (heap_size / sizeof(BlockHeader) + 1) * EXPORT_BYTES_PER_BLOCK + EXPORT_FIXED_BYTES;
+    out->data = mmap(NULL, out->cap, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return out->data != MAP_FAILED;
+}
+
+/**
+ * @brief Reports whether another block still fits below the room kept for the trailer.
+ *
+ * This also ends the walk of a block list corrupted into a cycle.
+ */
+static bool export_has_room(const ExportBuffer* out) {
+    return out->len + EXPORT_BYTES_PER_BLOCK + EXPORT_FIXED_BYTES <= out->cap;
+}
+
+/**
+ * @brief Writes the buffer to the file, closes the file and releases the buffer.
+ */
+static void export_finish(ExportBuffer* out, FILE* fptr) {
+    fwrite(out->data, 1, out->len, fptr);
+    fclose(fptr);
+    munmap(out->data, out->cap);
+}
+
+/**
+ * @brief Appends a string literal.
+ */
+#define PUT_LITERAL(out, text) put_bytes((out), (text), sizeof(text) - 1)
+
+static void put_bytes(ExportBuffer* out, const char* bytes, size_t n) {
+    memcpy(out->data + out->len, bytes, n);
+    out->len += n;
+}
+
+/**
+ * @brief Appends an unsigned integer in decimal.
+ */
+static void put_uint(ExportBuffer* out, uint64_t value) {
+    char digits[20];
+    size_t n = 0;
+    do {
+        digits[sizeof(digits) - ++n] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    put_bytes(out, digits + sizeof(digits) - n, n);
+}
+
+/**
+ * @brief Appends a pointer the way printf's %p does ("0x..." or "(nil)").
+ */
+static void put_pointer(ExportBuffer* out, const void* ptr) {
+    if (ptr == NULL) {
+        PUT_LITERAL(out, "(nil)");
+        return;
+    }
+    char digits[2 + 2 * sizeof(uintptr_t)];
+    size_t n = 0;
+    for (uintptr_t value = (uintptr_t)ptr; value != 0; value >>= 4) {
+        digits[sizeof(digits) - ++n] = "0123456789abcdef"[value & 15];
+    }
+    digits[sizeof(digits) - ++n] = 'x';
+    digits[sizeof(digits) - ++n] = '0';
+    put_bytes(out, digits + sizeof(digits) - n, n);
+}
+
+/**
+ * @brief Appends a non-negative ratio with four decimals, like printf's %.4f.
+ */
+static void put_ratio(ExportBuffer* out, double value) {
+    uint64_t scaled = (uint64_t)(value * 10000.0 + 0.5);
+    put_uint(out, scaled / 10000);
+    char decimals[5] = { '.', 0, 0, 0, 0 };
+    for (int i = 4; i >= 1; i--, scaled /= 10) {
+        decimals[i] = (char)('0' + scaled % 10);
+    }
+    put_bytes(out, decimals, sizeof(decimals));
+}
+
+/**
+ * @brief Counts a block into an export's totals.
+ */
+static void export_count_block(ExportStats* stats, const BlockHeader* block) {
+    stats->used_size += block->size;
+    if (block->free) {
+        stats->free_blocks++;
+        stats->free_size += block->size;
+    } else {
+        stats->alloc_blocks++;
+    }
+}
+
+/**
+ * @brief Fills in totals the block walk cannot see (heap mutex held).
+ *
+ * BITMAP and BUDDY keep no block headers, so their totals come from their own tables.
+ */
+static void export_finish_stats(ExportStats* stats) {
+    if (has_own_layout(current_strategy)) {
+        stats->alloc_blocks = get_alloc_count();
+        stats->free_blocks = get_free_block_count();
+        stats->used_size = get_used_heap_size();
+        stats->free_size = get_free_heap_size();
+    }
+}
+
+/**
+ * @brief Computes the fragmentation ratio from export totals (see get_fragmentation_ratio).
+ */
+static double export_fragmentation(const ExportStats* stats) {
+    if (stats->free_blocks == 0 || stats->free_size == 0) {
+        return 0.0;
+    }
+    double avg_free_block_size = (double)stats->free_size / stats->free_blocks;
+    return avg_free_block_size / stats->free_size;
+}
+
+/**
+ * @brief Opens an export file with fopen's mode, reporting a failure on stderr.
+ */
+static FILE* export_open(const char* filename, const char* mode) {
+    FILE* fptr = fopen(filename, mode);
+    if (fptr == NULL) {
+        fprintf(stderr, "Error: Unable to open file: %s for writing.\n", filename);
+    }
+    return fptr;
 }
 
 /**
@@ -730,35 +3639,70 @@ void print_heap() {
  *
  * This function traverses the heap and writes the details of each block
  * to a file, including its block number, address, size, and whether it is free or allocated.
+ * The text is built in one pass under the heap mutex and written after it is released.
  *
  * @param filename The name of the file to save the heap state.
  *
  * @return void
  */
 void save_heap_state(const char* filename) {
-    FILE *fptr;
-    fptr = fopen(filename, "w");
-
+    FILE* fptr = export_open(filename, "w");
     if (fptr == NULL) {
-        fprintf(stderr, "Error: Unable to open file: %s for writing.\n", filename);
         return;
     }
 
-    BlockHeader* curr = first_block;
-    int i = 0;
-    fprintf(fptr, "Heap Layout:\n");
-    while (curr != NULL) {
-        fprintf(fptr, "Block %d:\n", i++);
-        fprintf(fptr, "  Block Header Address: %p\n", (void*)curr);
-        fprintf(fptr, "  Block Total Size: %zu bytes\n", curr->size);
-        fprintf(fptr, "  Block Data Size: %zu bytes\n", curr->size - sizeof(BlockHeader));
-        fprintf(fptr, "  Block State: %s\n", curr->free ? "Free" : "Allocated");
-        fprintf(fptr, "\n");
-        curr = curr->next;
+    lock_heap();
+    ExportBuffer out;
+    if (!export_begin(&out)) {
+        unlock_heap();
+        fclose(fptr);
+        return;
     }
-    fprintf(fptr, "End of Heap\n");
+    PUT_LITERAL(&out, "Heap Layout:\n");
+    size_t i = 0;
+    for (BlockHeader* curr = first_block; curr != NULL && export_has_room(&out); curr = NEXT_BLOCK(curr)) {
+        PUT_LITERAL(&out, "Block ");
+        put_uint(&out, i++);
+        PUT_LITERAL(&out, ":\n  Block Header Address: ");
+        put_pointer(&out, curr);
+        PUT_LITERAL(&out, "\n  Block Total Size: ");
+        put_uint(&out, curr->size);
+        PUT_LITERAL(&out, " bytes\n  Block Data Size: ");
+        put_uint(&out, curr->size - sizeof(BlockHeader));
+        if (curr->free) {
+            PUT_LITERAL(&out, " bytes\n  Block State: Free\n\n");
+        } else {
+            PUT_LITERAL(&out, " bytes\n  Block State: Allocated\n\n");
+        }
+    }
+    PUT_LITERAL(&out, "End of Heap\n");
+    unlock_heap();
 
-    fclose(fptr);
+    export_finish(&out, fptr);
+}
+
+/**
+ * @brief Appends the heap_stats object shared by the JSON exports.
+ */
+static void put_stats_fields(ExportBuffer* out, const ExportStats* stats, const char* separator) {
+    size_t separator_len = strlen(separator);
+    PUT_LITERAL(out, "\"heap_size\": ");
+    put_uint(out, heap_size);
+    put_bytes(out, separator, separator_len);
+    PUT_LITERAL(out, "\"allocated_blocks\": ");
+    put_uint(out, stats->alloc_blocks);
+    put_bytes(out, separator, separator_len);
+    PUT_LITERAL(out, "\"free_blocks\": ");
+    put_uint(out, stats->free_blocks);
+    put_bytes(out, separator, separator_len);
+    PUT_LITERAL(out, "\"used_heap_size\": ");
+    put_uint(out, stats->used_size);
+    put_bytes(out, separator, separator_len);
+    PUT_LITERAL(out, "\"free_heap_size\": ");
+    put_uint(out, stats->free_size);
+    put_bytes(out, separator, separator_len);
+    PUT_LITERAL(out, "\"fragmentation_ratio\": ");
+    put_ratio(out, export_fragmentation(stats));
 }
 
 /**
@@ -766,53 +3710,193 @@ void save_heap_state(const char* filename) {
  *
  * This function traverses the heap and writes the details of each block
  * to a JSON file, including its block number, address, size, and whether it is free or allocated.
+ * The heap_stats totals are gathered in the same pass, and the file is written after
+ * the heap mutex is released.
  *
  * @param filename The name of the file to save the heap state in JSON format.
  *
  * @return void
  */
 void export_heap_json(const char* filename) {
-    FILE* fptr = fopen(filename, "w");
+    FILE* fptr = export_open(filename, "w");
     if (fptr == NULL) {
-        fprintf(stderr, "Error: Unable to open file: %s for writing.\n", filename);
         return;
     }
 
-    fprintf(fptr, "{\n");
-    fprintf(fptr, "  \"heap_layout\": [\n");
+    lock_heap();
+    ExportBuffer out;
+    if (!export_begin(&out)) {
+        unlock_heap();
+        fclose(fptr);
+        return;
+    }
+    ExportStats stats = { 0, 0, 0, 0 };
+    PUT_LITERAL(&out, "{\n  \"heap_layout\": [\n");
 
-    BlockHeader* curr_block = first_block;
-    int block_index = 0;
+    size_t block_index = 0;
+    BlockHeader* curr = first_block;
+    while (curr != NULL && export_has_room(&out)) {
+        BlockHeader* next = NEXT_BLOCK(curr);
+        export_count_block(&stats, curr);
+        PUT_LITERAL(&out, "    {\n      \"block_index\": ");
+        put_uint(&out, block_index++);
+        PUT_LITERAL(&out, ",\n      \"header_address\": \"");
+        put_pointer(&out, curr);
+        PUT_LITERAL(&out, "\",\n      \"total_size\": ");
+        put_uint(&out, curr->size);
+        PUT_LITERAL(&out, ",\n      \"data_size\": ");
+        put_uint(&out, curr->size - sizeof(BlockHeader));
+        if (curr->free) {
+            PUT_LITERAL(&out, ",\n      \"state\": \"Free\",\n      \"next_block\": \"");
+        } else {
+            PUT_LITERAL(&out, ",\n      \"state\": \"Allocated\",\n      \"next_block\": \"");
+        }
+        put_pointer(&out, next);
+        if (next != NULL) {
+            PUT_LITERAL(&out, "\"\n    },\n");
+        } else {
+            PUT_LITERAL(&out, "\"\n    }\n");
+        }
+        curr = next;
+    }
+    export_finish_stats(&stats);
 
-    while (curr_block != NULL) {
-        fprintf(fptr, "    {\n");
-        fprintf(fptr, "      \"block_index\": %d,\n", block_index++);
-        fprintf(fptr, "      \"header_address\": \"%p\",\n", (void*)curr_block);
-        fprintf(fptr, "      \"total_size\": %zu,\n", curr_block->size);
-        fprintf(fptr, "      \"data_size\": %zu,\n", curr_block->size - sizeof(BlockHeader));
-        fprintf(fptr, "      \"state\": \"%s\",\n", curr_block->free ? "Free" : "Allocated");
-        fprintf(fptr, "      \"next_block\": \"%p\"\n", (void*)curr_block->next);
-        curr_block = curr_block->next;
-
-        if (curr_block != NULL) {
-            fprintf(fptr, "    },\n");
+    PUT_LITERAL(&out, "  ],\n  \"heap_stats\": {\n    ");
+    put_stats_fields(&out, &stats, ",\n    ");
+    PUT_LITERAL(&out, "\n  }\n}\n");
+    unlock_heap();
+
+    export_finish(&out, fptr);
+}
+
+/**
+ * @brief Exports the heap as newline-delimited JSON, for tools that stream the output.
+ *
+ * Each block is a line such as {"type": "block", "offset": 0, "size": 48, "free": false},
+ * with the offset from the heap base, and a last {"type": "stats", ...} line carries
+ * the same totals as export_heap_json's heap_stats, gathered in the same pass.
+ *
+ * @param filename The name of the file to write.
+ *
+ * @return void
+ */
+void export_heap_ndjson(const char* filename) {
+    FILE* fptr = export_open(filename, "w");
+    if (fptr == NULL) {
+        return;
+    }
+
+    lock_heap();
+    ExportBuffer out;
+    if (!export_begin(&out)) {
+        unlock_heap();
+        fclose(fptr);
+        return;
+    }
+    ExportStats stats = { 0, 0, 0, 0 };
+    for (BlockHeader* curr = first_block; curr != NULL && export_has_room(&out); curr = NEXT_BLOCK(curr)) {
+        export_count_block(&stats, curr);
+        PUT_LITERAL(&out, "{\"type\": \"block\", \"offset\": ");
+        put_uint(&out, (uint64_t)((char*)curr - heap));
+        PUT_LITERAL(&out, ", \"size\": ");
+        put_uint(&out, curr->size);
+        if (curr->free) {
+            PUT_LITERAL(&out, ", \"free\": true}\n");
         } else {
-            fprintf(fptr, "    }\n");
+            PUT_LITERAL(&out, ", \"free\": false}\n");
         }
     }
+    export_finish_stats(&stats);
 
-    fprintf(fptr, "  ],\n");
+    PUT_LITERAL(&out, "{\"type\": \"stats\", ");
+    put_stats_fields(&out, &stats, ", ");
+    PUT_LITERAL(&out, "}\n");
+    unlock_heap();
 
-    // Add heap stats
-    fprintf(fptr, "  \"heap_stats\": {\n");
-    fprintf(fptr, "    \"heap_size\": %zu,\n", heap_size);
-    fprintf(fptr, "    \"allocated_blocks\": %zu,\n", get_alloc_count());
-    fprintf(fptr, "    \"free_blocks\": %zu,\n", get_free_block_count());
-    fprintf(fptr, "    \"used_heap_size\": %zu,\n", get_used_heap_size());
-    fprintf(fptr, "    \"free_heap_size\": %zu,\n", get_free_heap_size());
-    fprintf(fptr, "    \"fragmentation_ratio\": %.4f\n", get_fragmentation_ratio());
-    fprintf(fptr, "  }\n");
-    fprintf(fptr, "}\n");
+    export_finish(&out, fptr);
+}
 
-    fclose(fptr);
+/**
+ * @brief Appends the length of a run to a heap map, switching state if needed.
+ *
+ * Runs alternate between allocated and free, starting with allocated, so a run in the
+ * same state as the previous one extends it and a free first run is preceded by 0.
+ */
+static void put_map_run(ExportBuffer* out, bool used, size_t granules, bool* last_used, size_t* pending) {
+    if (used == *last_used) {
+        *pending += granules;
+        return;
+    }
+    put_uint(out, *pending);
+    PUT_LITERAL(out, ", ");
+    *last_used = used;
+    *pending = granules;
+}
+
+/**
+ * @brief Appends a run-length encoded occupancy map of the heap to a file.
+ *
+ * Each call adds one line of JSON, so calling it periodically builds a history that
+ * tools/heap_map_view.py renders as an image of fragmentation over time:
+ *
+ *   {"timestamp_ns": 123, "granule": 16, "capacity_granules": 40000,
+ *    "used_granules": 1200, "runs": [3, 2, 40, ...]}
+ *
+ * runs holds the lengths, in granules, of alternating allocated and free runs from the
+ * start of the heap, beginning with an allocated run (0 if the heap starts free). A
+ * block's header counts toward the block. Granules from used_granules up to the
+ * capacity have never been handed out. Every strategy is supported.
+ *
+ * @param filename The file to append to.
+ *
+ * @return void
+ */
+void export_heap_map(const char* filename) {
+    FILE* fptr = export_open(filename, "a");
+    if (fptr == NULL) {
+        return;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    lock_heap();
+    ExportBuffer out;
+    if (!export_begin(&out)) {
+        unlock_heap();
+        fclose(fptr);
+        return;
+    }
+    PUT_LITERAL(&out, "{\"timestamp_ns\": ");
+    put_uint(&out, (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec);
+    PUT_LITERAL(&out, ", \"granule\": ");
+    put_uint(&out, ALIGNMENT);
+    PUT_LITERAL(&out, ", \"capacity_granules\": ");
+    put_uint(&out, heap_capacity / ALIGNMENT);
+    PUT_LITERAL(&out, ", \"used_granules\": ");
+    put_uint(&out, heap_size / ALIGNMENT);
+    PUT_LITERAL(&out, ", \"runs\": [");
+
+    bool last_used = true;
+    size_t pending = 0;
+    if (has_own_layout(current_strategy)) {
+        size_t offset = 0;
+        while (offset < heap_size && export_has_room(&out)) {
+            bool used;
+            size_t end = current_strategy == BITMAP ? bitmap_run_end(offset, &used) : buddy_run_end(offset, &used);
+            put_map_run(&out, used, (end - offset) / ALIGNMENT, &last_used, &pending);
+            offset = end;
+        }
+    } else {
+        for (BlockHeader* curr = first_block; curr != NULL && export_has_room(&out); curr = NEXT_BLOCK(curr)) {
+            put_map_run(&out, !curr->free, curr->size / ALIGNMENT, &last_used, &pending);
+        }
+    }
+    if (heap_size != 0) {
+        put_uint(&out, pending);
+    }
+    PUT_LITERAL(&out, "]}\n");
+    unlock_heap();
+
+    export_finish(&out, fptr);
 }
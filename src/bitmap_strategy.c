@@ -0,0 +1,348 @@
+/**
+ * @file bitmap_strategy.c
+ * @brief Implementation of the header-less bitmap allocation strategy.
+ *
+ * With the BITMAP strategy the heap is divided into 16-byte granules and managed by
+ * two bitmaps kept beside it: alloc_map has a bit set for every granule in use, and
+ * end_map marks the last granule of each allocation, which is how a block's size is
+ * recovered on free. Blocks carry no header, so payloads are 16-byte aligned and a
+ * 16-byte request uses exactly 16 bytes. Free runs are found first-fit by scanning
+ * the bitmap a 64-bit word at a time with count-trailing-zeros.
+ */
+
+#include <string.h>
+#include "allocator.h"
+#include "profiler.h"
+
+#define MAP_WORDS ((HEAP_GRANULES + 63) / 64)
+#define NO_GRANULE ((size_t)-1)
+
+static uint64_t alloc_map[MAP_WORDS];   // bit set for every granule in use
+static uint64_t end_map[MAP_WORDS];     // bit set for the last granule of each allocation
+
+/**
+ * @brief Tests one granule's bit.
+ */
+static bool test_bit(const uint64_t* map, size_t g) {
+    return (map[g / 64] >> (g % 64)) & 1;
+}
+
+/**
+ * @brief Sets or clears the bits of granules [from, to).
+ */
+static void fill_range(uint64_t* map, size_t from, size_t to, bool value) {
+    while (from < to) {
+        size_t bit = from % 64;
+        size_t count = to - from < 64 - bit ? to - from : 64 - bit;
+        uint64_t mask = (count == 64 ? ~0ULL : ((1ULL << count) - 1)) << bit;
+        if (value) {
+            map[from / 64] |= mask;
+        } else {
+            map[from / 64] &= ~mask;
+        }
+        from += count;
+    }
+}
+
+/**
+ * @brief Finds the first granule in [from, limit) whose bit equals value.
+ *
+ * @return size_t The granule, or limit if there is none.
+ */
+static size_t next_granule(const uint64_t* map, size_t from, size_t limit, bool value) {
+    while (from < limit) {
+        uint64_t word = value ? map[from / 64] : ~map[from / 64];
+        word &= ~0ULL << (from % 64);
+        if (word != 0) {
+            size_t g = (from / 64) * 64 + __builtin_ctzll(word);
+            return g < limit ? g : limit;
+        }
+        from = (from / 64 + 1) * 64;
+    }
+    return limit;
+}
+
+/**
+ * @brief Clears both bitmaps when an empty heap is first used.
+ *
+ * Bits past HEAP_GRANULES in the last word are marked used so they never form a run.
+ */
+static void reset_maps() {
+    memset(alloc_map, 0, sizeof(alloc_map));
+    memset(end_map, 0, sizeof(end_map));
+    fill_range(alloc_map, HEAP_GRANULES, MAP_WORDS * 64, true);
+}
+
+/**
+ * @brief Finds the lowest run of count free granules.
+ *
+ * Alternates between skipping to the next free granule and measuring the free run
+ * there; both steps move a whole word at a time through runs of equal bits.
+ *
+ * @return size_t First granule of the run, or NO_GRANULE if no run is long enough.
+ */
+static size_t find_free_run(size_t count) {
+    size_t g = 0;
+    while (g + count <= HEAP_GRANULES) {
+        g = next_granule(alloc_map, g, HEAP_GRANULES, false);
+        if (g + count > HEAP_GRANULES) {
+            break;
+        }
+        size_t used = next_granule(alloc_map, g, g + count, true);
+        if (used == g + count) {
+            return g;
+        }
+        g = used;
+    }
+    return NO_GRANULE;
+}
+
+/**
+ * @brief Maps a payload pointer to its allocation.
+ *
+ * @param ptr Pointer returned by bitmap_alloc.
+ * @param first Receives the allocation's first granule.
+ * @param last Receives the allocation's last granule.
+ *
+ * @return AllocatorStatus ALLOC_SUCCESS, ALLOC_INVALID_FREE for a granule that is not in
+ *         use (double free), or ALLOC_HEAP_ERROR for any other invalid pointer.
+ */
+static AllocatorStatus find_allocation(void* ptr, size_t* first, size_t* last) {
+    uintptr_t p = (uintptr_t)ptr;
+    uintptr_t start = (uintptr_t)get_heap_base();
+    if (p < start || p >= start + heap_extent() || (p - start) % ALIGNMENT != 0) {
+        return ALLOC_HEAP_ERROR;
+    }
+
+    size_t g = (p - start) / ALIGNMENT;
+    if (!test_bit(alloc_map, g)) {
+        return ALLOC_INVALID_FREE;
+    }
+    // An allocation starts after a free granule or after another allocation's end
+    if (g > 0 && test_bit(alloc_map, g - 1) && !test_bit(end_map, g - 1)) {
+        return ALLOC_HEAP_ERROR;
+    }
+
+    *first = g;
+    *last = next_granule(end_map, g, HEAP_GRANULES, true);
+    return *last < HEAP_GRANULES ? ALLOC_SUCCESS : ALLOC_HEAP_ERROR;
+}
+
+/**
+ * @brief Allocates a header-less block from the bitmap heap.
+ *
+ * @param requested_bytes The number of bytes to allocate.
+ *
+ * @return Pointer to the 16-byte aligned block, or NULL if allocation fails.
+ */
+void* bitmap_alloc(size_t requested_bytes) {
+    if (requested_bytes == 0) {
+        set_last_status(ALLOC_ERROR);
+        return NULL;
+    }
+    if (heap_extent() == 0) {
+        reset_maps();
+    }
+
+    size_t count = (requested_bytes + ALIGNMENT - 1) / ALIGNMENT;
+    size_t g = count <= HEAP_GRANULES ? find_free_run(count) : NO_GRANULE;
+    if (g == NO_GRANULE) {
+        set_last_status(ALLOC_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    fill_range(alloc_map, g, g + count, true);
+    fill_range(end_map, g + count - 1, g + count, true);
+    if ((g + count) * ALIGNMENT > heap_extent()) {
+        heap_set_extent((g + count) * ALIGNMENT);
+    }
+
+    set_last_status(ALLOC_SUCCESS);
+    return get_heap_base() + g * ALIGNMENT;
+}
+
+/**
+ * @brief Frees a block allocated by bitmap_alloc.
+ *
+ * @param ptr Pointer to the block.
+ *
+ * @return void
+ */
+void bitmap_free(void* ptr) {
+    size_t first, last;
+    AllocatorStatus status = find_allocation(ptr, &first, &last);
+    if (status != ALLOC_SUCCESS) {
+        set_last_status(status);
+        return;
+    }
+
+    profiler_record_free(ptr);
+    fill_range(alloc_map, first, last + 1, false);
+    fill_range(end_map, last, last + 1, false);
+    set_last_status(ALLOC_SUCCESS);
+}
+
+/**
+ * @brief Resizes a block allocated by bitmap_alloc.
+ *
+ * Shrinking releases the tail granules; growing claims the following granules when
+ * they are free, and otherwise moves the block.
+ *
+ * @param ptr Pointer to the block (not NULL).
+ * @param new_size The new size in bytes (not 0).
+ *
+ * @return Pointer to the resized block, or NULL if an error occurred.
+ */
+void* bitmap_realloc(void* ptr, size_t new_size) {
+    size_t first, last;
+    AllocatorStatus status = find_allocation(ptr, &first, &last);
+    if (status != ALLOC_SUCCESS) {
+        set_last_status(ALLOC_HEAP_ERROR);
+        return NULL;
+    }
+
+    size_t old_count = last - first + 1;
+    size_t new_count = (new_size + ALIGNMENT - 1) / ALIGNMENT;
+    size_t new_end = first + new_count;
+
+    if (new_count <= old_count ||
+        (new_end <= HEAP_GRANULES && next_granule(alloc_map, last + 1, new_end, true) == new_end)) {
+        fill_range(end_map, last, last + 1, false);
+        fill_range(alloc_map, first, first + old_count, false);
+        fill_range(alloc_map, first, new_end, true);
+        fill_range(end_map, new_end - 1, new_end, true);
+        if (new_end * ALIGNMENT > heap_extent()) {
+            heap_set_extent(new_end * ALIGNMENT);
+        }
+
+        profiler_record_free(ptr);
+        profiler_record_alloc(ptr, new_size);
+        set_last_status(ALLOC_SUCCESS);
+        return ptr;
+    }
+
+    void* new_ptr = bitmap_alloc(new_size);
+    if (new_ptr == NULL) {
+        return NULL;
+    }
+    memcpy(new_ptr, ptr, old_count * ALIGNMENT);
+    bitmap_free(ptr);
+    profiler_record_alloc(new_ptr, new_size);
+
+    set_last_status(ALLOC_SUCCESS);
+    return new_ptr;
+}
+
+/**
+ * @brief Reports whether ptr is the start of a live bitmap allocation.
+ */
+bool bitmap_validate_pointer(void* ptr) {
+    size_t first, last;
+    return find_allocation(ptr, &first, &last) == ALLOC_SUCCESS;
+}
+
+/**
+ * @brief Gets the bytes held for a live bitmap allocation.
+ *
+ * @param ptr Pointer to the block.
+ *
+ * @return size_t Granules held times ALIGNMENT, or 0 for an invalid pointer.
+ */
+size_t bitmap_block_size(void* ptr) {
+    size_t first, last;
+    if (find_allocation(ptr, &first, &last) != ALLOC_SUCCESS) {
+        return 0;
+    }
+    return (last - first + 1) * ALIGNMENT;
+}
+
+/**
+ * @brief Counts blocks and sums their sizes from the bitmaps.
+ *
+ * Free blocks are the maximal runs of free granules below heap_size, so the
+ * never-used tail of the heap is not reported as free, as with the list-based
+ * strategies.
+ *
+ * @param only_free Count free runs instead of allocations.
+ * @param bytes Receives the total size of the counted blocks (may be NULL).
+ *
+ * @return size_t Number of counted blocks.
+ */
+size_t bitmap_totals(bool only_free, size_t* bytes) {
+    size_t end = heap_extent() / ALIGNMENT;
+    size_t count = 0;
+    size_t granules = 0;
+
+    if (only_free) {
+        size_t g = next_granule(alloc_map, 0, end, false);
+        while (g < end) {
+            size_t used = next_granule(alloc_map, g, end, true);
+            count++;
+            granules += used - g;
+            g = next_granule(alloc_map, used, end, false);
+        }
+    } else {
+        for (size_t w = 0; w < (end + 63) / 64; w++) {
+            uint64_t below_end = w * 64 + 64 <= end ? ~0ULL : (1ULL << (end - w * 64)) - 1;
+            count += __builtin_popcountll(end_map[w]);
+            granules += __builtin_popcountll(alloc_map[w] & below_end);
+        }
+    }
+    if (bytes != NULL) {
+        *bytes = granules * ALIGNMENT;
+    }
+    return count;
+}
+
+/**
+ * @brief Finds the end of the run of used or free granules that starts at an offset.
+ *
+ * @param offset Heap offset below heap_size, a multiple of ALIGNMENT.
+ * @param used Receives whether the run's granules are in use.
+ *
+ * @return size_t Offset just past the run (at most heap_size).
+ */
+size_t bitmap_run_end(size_t offset, bool* used) {
+    size_t g = offset / ALIGNMENT;
+    *used = (alloc_map[g / 64] >> (g % 64)) & 1;
+    return next_granule(alloc_map, g, heap_extent() / ALIGNMENT, !*used) * ALIGNMENT;
+}
+
+/**
+ * @brief Checks that the bitmaps describe a consistent set of allocations.
+ *
+ * Every end bit must mark a granule in use, every run of granules in use must end
+ * with an end bit, and nothing past heap_size may be in use.
+ *
+ * @return bool True if the bitmaps are consistent, false otherwise.
+ */
+bool bitmap_check_integrity() {
+    size_t end = heap_extent() / ALIGNMENT;
+    if (heap_extent() > HEAP_CAPACITY || heap_extent() % ALIGNMENT != 0) {
+        set_last_status(ALLOC_HEAP_ERROR);
+        return false;
+    }
+    if (heap_extent() == 0) {
+        set_last_status(ALLOC_HEAP_OK);
+        return true;
+    }
+
+    for (size_t w = 0; w < MAP_WORDS; w++) {
+        size_t base = w * 64;
+        uint64_t valid = base + 64 <= end ? ~0ULL : base >= end ? 0 : (1ULL << (end - base)) - 1;
+        uint64_t used = alloc_map[w] & (base + 64 <= HEAP_GRANULES ? ~0ULL : (1ULL << (HEAP_GRANULES - base)) - 1);
+        uint64_t next_used = w + 1 < MAP_WORDS ? alloc_map[w + 1] & 1 : 0;
+        if (base + 64 >= HEAP_GRANULES) {
+            next_used = 0;
+        }
+        uint64_t run_ends = used & ~((used >> 1) | (next_used << 63));
+
+        if ((used & ~valid) != 0 || (end_map[w] & ~used) != 0 || (run_ends & ~end_map[w]) != 0) {
+            set_last_status(ALLOC_HEAP_ERROR);
+            return false;
+        }
+    }
+
+    set_last_status(ALLOC_HEAP_OK);
+    return true;
+}
@@ -0,0 +1,456 @@
+/**
+ * @file buddy_strategy.c
+ * @brief Implementation of the binary buddy allocation strategy.
+ *
+ * With the BUDDY strategy every block holds 16 << order bytes and starts at an offset
+ * that is a multiple of its size, so a block's buddy is found by flipping one bit of
+ * its offset. Free blocks of each order sit on a doubly linked list threaded through
+ * their payloads, and a bitmask records which lists are non-empty. Allocation takes
+ * the smallest suitable block and splits it in halves; free merges a block with its
+ * buddy while the buddy is free and of the same order. Both do at most one step per
+ * order, so every operation is O(log n) with no list walks.
+ *
+ * The block order lives in a side array indexed by granule, so blocks carry no header.
+ * HEAP_CAPACITY need not be a power of two: the heap starts out as the aligned
+ * power-of-two blocks of its binary decomposition, and a block never merges with a
+ * buddy that would extend past the end of the heap.
+ */
+
+#include <string.h>
+#include "allocator.h"
+#include "profiler.h"
+
+#define BUDDY_NO_BLOCK 0xFF   // block_order entry for granules where no block starts
+#define BUDDY_FREE 0x80       // set in block_order for free blocks
+
+// Free list links, stored in the first 16 bytes of a free block
+typedef struct BuddyNode {
+    struct BuddyNode* prev;
+    struct BuddyNode* next;
+} BuddyNode;
+
+static uint8_t block_order[HEAP_GRANULES];      // order (| BUDDY_FREE) where a block starts
+static BuddyNode* free_lists[BUDDY_ORDERS];     // free blocks of each order
+static uint32_t nonempty_orders = 0;            // bit set for each non-empty free list
+static size_t free_count = 0;                   // number of free blocks
+static size_t free_bytes = 0;                   // bytes in free blocks
+static size_t live_count = 0;                   // number of allocated blocks
+
+/**
+ * @brief Gets the size in bytes of a block of the given order.
+ */
+static size_t order_size(unsigned order) {
+    return (size_t)ALIGNMENT << order;
+}
+
+/**
+ * @brief Gets the heap offset of a block.
+ */
+static size_t block_offset(void* block) {
+    return (size_t)((char*)block - get_heap_base());
+}
+
+/**
+ * @brief Pushes a block onto the free list of its order and marks it free.
+ */
+static void push_free(size_t offset, unsigned order) {
+    BuddyNode* node = (BuddyNode*)(get_heap_base() + offset);
+    node->prev = NULL;
+    node->next = free_lists[order];
+    if (node->next != NULL) {
+        node->next->prev = node;
+    }
+    free_lists[order] = node;
+    nonempty_orders |= 1u << order;
+
+    block_order[offset / ALIGNMENT] = (uint8_t)(order | BUDDY_FREE);
+    free_count++;
+    free_bytes += order_size(order);
+}
+
+/**
+ * @brief Unlinks a free block from the free list of its order.
+ *
+ * The caller updates block_order for the block.
+ */
+static void remove_free(size_t offset, unsigned order) {
+    BuddyNode* node = (BuddyNode*)(get_heap_base() + offset);
+    if (node->prev != NULL) {
+        node->prev->next = node->next;
+    } else {
+        free_lists[order] = node->next;
+    }
+    if (node->next != NULL) {
+        node->next->prev = node->prev;
+    }
+    if (free_lists[order] == NULL) {
+        nonempty_orders &= ~(1u << order);
+    }
+
+    free_count--;
+    free_bytes -= order_size(order);
+}
+
+/**
+ * @brief Carves an empty heap into its top-level blocks.
+ *
+ * Taking the largest power-of-two block that fits at each step keeps every block
+ * aligned to its size.
+ */
+static void reset_buddy() {
+    memset(block_order, BUDDY_NO_BLOCK, sizeof(block_order));
+    memset(free_lists, 0, sizeof(free_lists));
+    nonempty_orders = 0;
+    free_count = 0;
+    free_bytes = 0;
+    live_count = 0;
+
+    size_t offset = 0;
+    for (int order = BUDDY_ORDERS - 1; order >= 0; order--) {
+        if (HEAP_CAPACITY - offset >= order_size(order)) {
+            push_free(offset, order);
+            offset += order_size(order);
+        }
+    }
+    heap_set_extent(offset);
+}
+
+/**
+ * @brief Gets the smallest order whose blocks hold the requested bytes.
+ *
+ * @return unsigned The order, or BUDDY_ORDERS if the request is too large.
+ */
+static unsigned request_order(size_t requested_bytes) {
+    unsigned order = 0;
+    while (order < BUDDY_ORDERS && order_size(order) < requested_bytes) {
+        order++;
+    }
+    return order;
+}
+
+/**
+ * @brief Gets the offset of a block's buddy.
+ *
+ * @return size_t The buddy's offset, or HEAP_CAPACITY if the buddy would extend past
+ *         the end of the heap (top-level blocks have no buddy).
+ */
+static size_t buddy_of(size_t offset, unsigned order) {
+    size_t buddy = offset ^ order_size(order);
+    return buddy + order_size(order) <= heap_extent() ? buddy : HEAP_CAPACITY;
+}
+
+/**
+ * @brief Reports whether a free block of the given order starts at offset.
+ */
+static bool is_free_block(size_t offset, unsigned order) {
+    return offset < heap_extent() && block_order[offset / ALIGNMENT] == (order | BUDDY_FREE);
+}
+
+/**
+ * @brief Maps a payload pointer to its allocated block.
+ *
+ * @param ptr Pointer returned by buddy_alloc.
+ * @param order Receives the block's order.
+ *
+ * @return AllocatorStatus ALLOC_SUCCESS, ALLOC_INVALID_FREE for a free block (double
+ *         free), or ALLOC_HEAP_ERROR for any other invalid pointer.
+ */
+static AllocatorStatus find_block(void* ptr, unsigned* order) {
+    uintptr_t p = (uintptr_t)ptr;
+    uintptr_t start = (uintptr_t)get_heap_base();
+    if (p < start || p >= start + heap_extent() || (p - start) % ALIGNMENT != 0) {
+        return ALLOC_HEAP_ERROR;
+    }
+
+    uint8_t entry = block_order[(p - start) / ALIGNMENT];
+    if (entry == BUDDY_NO_BLOCK) {
+        return ALLOC_HEAP_ERROR;
+    }
+    if (entry & BUDDY_FREE) {
+        return ALLOC_INVALID_FREE;
+    }
+    *order = entry;
+    return ALLOC_SUCCESS;
+}
+
+/**
+ * @brief Splits a block down to the target order, freeing the upper halves.
+ *
+ * @param offset Offset of the block.
+ * @param order Current order of the block.
+ * @param target Order to split down to.
+ */
+static void split_to(size_t offset, unsigned order, unsigned target) {
+    while (order > target) {
+        order--;
+        push_free(offset + order_size(order), order);
+    }
+}
+
+/**
+ * @brief Frees a block and merges it with its free buddies.
+ *
+ * @param offset Offset of the block.
+ * @param order Order of the block.
+ */
+static void release_block(size_t offset, unsigned order) {
+    block_order[offset / ALIGNMENT] = BUDDY_NO_BLOCK;
+    while (order + 1 < BUDDY_ORDERS) {
+        size_t buddy = buddy_of(offset, order);
+        if (!is_free_block(buddy, order)) {
+            break;
+        }
+        remove_free(buddy, order);
+        block_order[buddy / ALIGNMENT] = BUDDY_NO_BLOCK;
+        offset &= ~order_size(order);
+        order++;
+    }
+    push_free(offset, order);
+}
+
+/**
+ * @brief Allocates a block from the buddy heap.
+ *
+ * @param requested_bytes The number of bytes to allocate.
+ *
+ * @return Pointer to the block (aligned to its power-of-two size), or NULL if
+ *         allocation fails.
+ */
+void* buddy_alloc(size_t requested_bytes) {
+    if (requested_bytes == 0) {
+        set_last_status(ALLOC_ERROR);
+        return NULL;
+    }
+    if (heap_extent() == 0) {
+        reset_buddy();
+    }
+
+    unsigned order = request_order(requested_bytes);
+    uint32_t candidates = order < BUDDY_ORDERS ? nonempty_orders & (~0u << order) : 0;
+    if (candidates == 0) {
+        set_last_status(ALLOC_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    unsigned found = __builtin_ctz(candidates);
+    size_t offset = block_offset(free_lists[found]);
+    remove_free(offset, found);
+    split_to(offset, found, order);
+    block_order[offset / ALIGNMENT] = (uint8_t)order;
+    live_count++;
+
+    set_last_status(ALLOC_SUCCESS);
+    return get_heap_base() + offset;
+}
+
+/**
+ * @brief Frees a block allocated by buddy_alloc.
+ *
+ * @param ptr Pointer to the block.
+ *
+ * @return void
+ */
+void buddy_free(void* ptr) {
+    unsigned order;
+    AllocatorStatus status = find_block(ptr, &order);
+    if (status != ALLOC_SUCCESS) {
+        set_last_status(status);
+        return;
+    }
+
+    profiler_record_free(ptr);
+    release_block(block_offset(ptr), order);
+    live_count--;
+    set_last_status(ALLOC_SUCCESS);
+}
+
+/**
+ * @brief Resizes a block allocated by buddy_alloc.
+ *
+ * Shrinking splits off the upper halves. Growing absorbs the following buddies in
+ * place when the block is the lower half at every level and those buddies are free,
+ * and otherwise moves the block.
+ *
+ * @param ptr Pointer to the block (not NULL).
+ * @param new_size The new size in bytes (not 0).
+ *
+ * @return Pointer to the resized block, or NULL if an error occurred.
+ */
+void* buddy_realloc(void* ptr, size_t new_size) {
+    unsigned order;
+    if (find_block(ptr, &order) != ALLOC_SUCCESS) {
+        set_last_status(ALLOC_HEAP_ERROR);
+        return NULL;
+    }
+
+    size_t offset = block_offset(ptr);
+    unsigned new_order = request_order(new_size);
+
+    bool in_place = new_order < BUDDY_ORDERS;
+    for (unsigned o = order; in_place && o < new_order; o++) {
+        in_place = (offset & order_size(o)) == 0 && buddy_of(offset, o) != HEAP_CAPACITY &&
+                   is_free_block(offset + order_size(o), o);
+    }
+
+    if (in_place) {
+        for (unsigned o = order; o < new_order; o++) {
+            remove_free(offset + order_size(o), o);
+            block_order[(offset + order_size(o)) / ALIGNMENT] = BUDDY_NO_BLOCK;
+        }
+        split_to(offset, order, new_order);
+        block_order[offset / ALIGNMENT] = (uint8_t)new_order;
+
+        profiler_record_free(ptr);
+        profiler_record_alloc(ptr, new_size);
+        set_last_status(ALLOC_SUCCESS);
+        return ptr;
+    }
+
+    void* new_ptr = buddy_alloc(new_size);
+    if (new_ptr == NULL) {
+        return NULL;
+    }
+    memcpy(new_ptr, ptr, order_size(order));
+    buddy_free(ptr);
+    profiler_record_alloc(new_ptr, new_size);
+
+    set_last_status(ALLOC_SUCCESS);
+    return new_ptr;
+}
+
+/**
+ * @brief Reports whether ptr is the start of a live buddy block.
+ */
+bool buddy_validate_pointer(void* ptr) {
+    unsigned order;
+    return find_block(ptr, &order) == ALLOC_SUCCESS;
+}
+
+/**
+ * @brief Gets the bytes held for a live buddy block.
+ *
+ * @param ptr Pointer to the block.
+ *
+ * @return size_t The block's power-of-two size, or 0 for an invalid pointer.
+ */
+size_t buddy_block_size(void* ptr) {
+    unsigned order;
+    if (find_block(ptr, &order) != ALLOC_SUCCESS) {
+        return 0;
+    }
+    return order_size(order);
+}
+
+/**
+ * @brief Counts blocks and sums their sizes from the running totals.
+ *
+ * @param only_free Count free blocks instead of allocated ones.
+ * @param bytes Receives the total size of the counted blocks (may be NULL).
+ *
+ * @return size_t Number of counted blocks.
+ */
+size_t buddy_totals(bool only_free, size_t* bytes) {
+    if (bytes != NULL) {
+        *bytes = only_free ? free_bytes : heap_extent() - free_bytes;
+    }
+    return only_free ? free_count : live_count;
+}
+
+/**
+ * @brief Finds the end of the run of allocated or free blocks that starts at an offset.
+ *
+ * @param offset Heap offset of a block.
+ * @param used Receives whether the run's blocks are allocated.
+ *
+ * @return size_t Offset just past the run (heap_size if the blocks stop tiling the heap).
+ */
+size_t buddy_run_end(size_t offset, bool* used) {
+    *used = !(block_order[offset / ALIGNMENT] & BUDDY_FREE);
+    while (offset < heap_extent()) {
+        uint8_t entry = block_order[offset / ALIGNMENT];
+        if (entry == BUDDY_NO_BLOCK || (entry & ~BUDDY_FREE) >= BUDDY_ORDERS) {
+            return heap_extent();
+        }
+        if (!(entry & BUDDY_FREE) != *used) {
+            break;
+        }
+        offset += order_size(entry & ~BUDDY_FREE);
+    }
+    return offset < heap_extent() ? offset : heap_extent();
+}
+
+/**
+ * @brief Counts the free blocks of one order.
+ *
+ * @param order Block order (block size is ALIGNMENT << order).
+ *
+ * @return size_t Number of free blocks of that order.
+ */
+size_t buddy_free_blocks(unsigned order) {
+    size_t count = 0;
+    for (BuddyNode* node = order < BUDDY_ORDERS ? free_lists[order] : NULL; node != NULL; node = node->next) {
+        count++;
+    }
+    return count;
+}
+
+/**
+ * @brief Checks that the blocks tile the heap and the free lists match them.
+ *
+ * Blocks must tile the heap with each one aligned to its size, no free block may
+ * have a free buddy of the same order (it would have been merged), and every free
+ * list entry must be a free block of that list's order with consistent links.
+ *
+ * @return bool True if the buddy heap is consistent, false otherwise.
+ */
+bool buddy_check_integrity() {
+    if (heap_extent() == 0) {
+        set_last_status(ALLOC_HEAP_OK);
+        return true;
+    }
+
+    size_t blocks = 0;
+    size_t free_blocks = 0;
+    size_t offset = 0;
+    while (offset < heap_extent()) {
+        uint8_t entry = block_order[offset / ALIGNMENT];
+        unsigned order = entry & ~BUDDY_FREE;
+        if (entry == BUDDY_NO_BLOCK || order >= BUDDY_ORDERS || offset % order_size(order) != 0 ||
+            offset + order_size(order) > heap_extent()) {
+            set_last_status(ALLOC_HEAP_ERROR);
+            return false;
+        }
+        if (entry & BUDDY_FREE) {
+            free_blocks++;
+            if (is_free_block(buddy_of(offset, order), order)) {
+                set_last_status(ALLOC_HEAP_ERROR);
+                return false;
+            }
+        }
+        blocks++;
+        offset += order_size(order);
+    }
+
+    size_t listed = 0;
+    for (unsigned order = 0; order < BUDDY_ORDERS; order++) {
+        BuddyNode* prev = NULL;
+        for (BuddyNode* node = free_lists[order]; node != NULL; node = node->next) {
+            uintptr_t p = (uintptr_t)node;
+            uintptr_t start = (uintptr_t)get_heap_base();
+            if (p < start || p >= start + heap_extent() || (p - start) % ALIGNMENT != 0 ||
+                !is_free_block(block_offset(node), order) || node->prev != prev || ++listed > free_blocks) {
+                set_last_status(ALLOC_HEAP_ERROR);
+                return false;
+            }
+            prev = node;
+        }
+    }
+
+    if (listed != free_blocks || free_blocks != free_count || blocks - free_blocks != live_count) {
+        set_last_status(ALLOC_HEAP_ERROR);
+        return false;
+    }
+
+    set_last_status(ALLOC_HEAP_OK);
+    return true;
+}
@@ -0,0 +1,268 @@
+/**
+ * @file fit_kernels.c
+ * @brief Implementation of the vectorized fit-search kernels.
+ *
+ * Each kernel reduces one chunk of FIT_CHUNK_GRANULES side table entries. Entries are
+ * block sizes in granules (at most HEAP_CAPACITY / ALIGNMENT, so always below
+ * FIT_NO_ENTRY) or zero where no free block starts. The SSE2 kernels work around the
+ * lack of unsigned 16-bit min/max by flipping the sign bit; the AVX2 kernels are
+ * compiled with a target attribute so the rest of the library needs no -mavx2.
+ */
+
+#include <pthread.h>
+#include "fit_kernels.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define HAVE_X86_KERNELS 1
+    #include <immintrin.h>
+#endif
+
+typedef uint16_t (*MinKernelFn)(const uint16_t* chunk, uint16_t need);
+typedef uint16_t (*MaxKernelFn)(const uint16_t* chunk);
+
+static FitKernel active_kernel = FIT_KERNEL_SCALAR;
+static MinKernelFn min_kernel = NULL;
+static MaxKernelFn max_kernel = NULL;
+static pthread_once_t kernel_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Scalar minimum over the entries that are at least need.
+ */
+static uint16_t min_at_least_scalar(const uint16_t* chunk, uint16_t need) {
+    uint16_t best = FIT_NO_ENTRY;
+    for (int i = 0; i < FIT_CHUNK_GRANULES; i++) {
+        if (chunk[i] >= need && chunk[i] < best) {
+            best = chunk[i];
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Scalar maximum entry.
+ */
+static uint16_t max_scalar(const uint16_t* chunk) {
+    uint16_t worst = 0;
+    for (int i = 0; i < FIT_CHUNK_GRANULES; i++) {
+        if (chunk[i] > worst) {
+            worst = chunk[i];
+        }
+    }
+    return worst;
+}
+
+#ifdef HAVE_X86_KERNELS
+/**
+ * @brief SSE2 minimum over the entries that are at least need.
+ *
+ * Entries below need become FIT_NO_ENTRY (need - entry saturates to zero exactly when
+ * the entry is large enough), then a signed min over sign-flipped values stands in
+ * for the unsigned min that SSE2 lacks.
+ */
+static uint16_t min_at_least_sse2(const uint16_t* chunk, uint16_t need) {
+    const __m128i needv = _mm_set1_epi16((short)need);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bias = _mm_set1_epi16((short)0x8000);
+    __m128i acc = _mm_set1_epi16((short)(FIT_NO_ENTRY ^ 0x8000));
+
+    for (int i = 0; i < FIT_CHUNK_GRANULES; i += 8) {
+        __m128i v = _mm_load_si128((const __m128i*)(chunk + i));
+        __m128i fits = _mm_cmpeq_epi16(_mm_subs_epu16(needv, v), zero);
+        __m128i y = _mm_or_si128(_mm_and_si128(fits, v), _mm_andnot_si128(fits, _mm_cmpeq_epi16(v, v)));
+        acc = _mm_min_epi16(acc, _mm_xor_si128(y, bias));
+    }
+
+    acc = _mm_min_epi16(acc, _mm_srli_si128(acc, 8));
+    acc = _mm_min_epi16(acc, _mm_srli_si128(acc, 4));
+    acc = _mm_min_epi16(acc, _mm_srli_si128(acc, 2));
+    return (uint16_t)(_mm_extract_epi16(acc, 0) ^ 0x8000);
+}
+
+/**
+ * @brief SSE2 maximum entry (signed max over sign-flipped values).
+ */
+static uint16_t max_sse2(const uint16_t* chunk) {
+    const __m128i bias = _mm_set1_epi16((short)0x8000);
+    __m128i acc = bias;
+
+    for (int i = 0; i < FIT_CHUNK_GRANULES; i += 8) {
+        __m128i v = _mm_load_si128((const __m128i*)(chunk + i));
+        acc = _mm_max_epi16(acc, _mm_xor_si128(v, bias));
+    }
+
+    acc = _mm_max_epi16(acc, _mm_srli_si128(acc, 8));
+    acc = _mm_max_epi16(acc, _mm_srli_si128(acc, 4));
+    acc = _mm_max_epi16(acc, _mm_srli_si128(acc, 2));
+    return (uint16_t)(_mm_extract_epi16(acc, 0) ^ 0x8000);
+}
+
+/**
+ * @brief AVX2 minimum over the entries that are at least need.
+ *
+ * AVX2 has unsigned 16-bit min, and SSE4.1's minpos finishes the reduction.
+ */
+__attribute__((target("avx2")))
+static uint16_t min_at_least_avx2(const uint16_t* chunk, uint16_t need) {
+    const __m256i needv = _mm256_set1_epi16((short)need);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc = _mm256_set1_epi16((short)FIT_NO_ENTRY);
+
+    for (int i = 0; i < FIT_CHUNK_GRANULES; i += 16) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(chunk + i));
+        __m256i fits = _mm256_cmpeq_epi16(_mm256_subs_epu16(needv, v), zero);
+        acc = _mm256_min_epu16(acc, _mm256_blendv_epi8(acc, v, fits));
+    }
+
+    __m128i half = _mm_min_epu16(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    return (uint16_t)_mm_cvtsi128_si32(_mm_minpos_epu16(half));
+}
+
+/**
+ * @brief AVX2 maximum entry (minpos over inverted values).
+ */
+__attribute__((target("avx2")))
+static uint16_t max_avx2(const uint16_t* chunk) {
+    __m256i acc = _mm256_setzero_si256();
+
+    for (int i = 0; i < FIT_CHUNK_GRANULES; i += 16) {
+        acc = _mm256_max_epu16(acc, _mm256_loadu_si256((const __m256i*)(chunk + i)));
+    }
+
+    __m128i half = _mm_max_epu16(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    __m128i inverted = _mm_xor_si128(half, _mm_cmpeq_epi16(half, half));
+    return (uint16_t)~_mm_cvtsi128_si32(_mm_minpos_epu16(inverted));
+}
+#endif
+
+/**
+ * @brief Reports whether the CPU can run a kernel.
+ */
+static bool kernel_supported(FitKernel kernel) {
+    switch (kernel) {
+        case FIT_KERNEL_SCALAR:
+            return true;
+#ifdef HAVE_X86_KERNELS
+        case FIT_KERNEL_SSE2:
+            return __builtin_cpu_supports("sse2");
+        case FIT_KERNEL_AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Installs a supported kernel.
+ */
+static void install_kernel(FitKernel kernel) {
+    active_kernel = kernel;
+    switch (kernel) {
+#ifdef HAVE_X86_KERNELS
+        case FIT_KERNEL_SSE2:
+            min_kernel = min_at_least_sse2;
+            max_kernel = max_sse2;
+            break;
+        case FIT_KERNEL_AVX2:
+            min_kernel = min_at_least_avx2;
+            max_kernel = max_avx2;
+            break;
+#endif
+        default:
+            active_kernel = FIT_KERNEL_SCALAR;
+            min_kernel = min_at_least_scalar;
+            max_kernel = max_scalar;
+            break;
+    }
+}
+
+/**
+ * @brief Picks the widest kernel the CPU supports.
+ */
+static void install_best_kernel() {
+#ifdef HAVE_X86_KERNELS
+    __builtin_cpu_init();
+#endif
+    if (kernel_supported(FIT_KERNEL_AVX2)) {
+        install_kernel(FIT_KERNEL_AVX2);
+    } else if (kernel_supported(FIT_KERNEL_SSE2)) {
+        install_kernel(FIT_KERNEL_SSE2);
+    } else {
+        install_kernel(FIT_KERNEL_SCALAR);
+    }
+}
+
+/**
+ * @brief Selects the kernel used by side-table best-fit and worst-fit searches.
+ *
+ * The widest supported kernel is selected automatically on first use; this function
+ * overrides that choice, e.g. to compare kernels. Call it while no other thread is
+ * using the heap.
+ *
+ * @param kernel Kernel to use, or FIT_KERNEL_AUTO for the widest supported one.
+ *
+ * @return bool False if the CPU does not support the kernel (the selection is unchanged).
+ */
+bool set_fit_kernel(FitKernel kernel) {
+    pthread_once(&kernel_once, install_best_kernel);
+    if (kernel == FIT_KERNEL_AUTO) {
+        install_best_kernel();
+        return true;
+    }
+    if (!kernel_supported(kernel)) {
+        return false;
+    }
+    install_kernel(kernel);
+    return true;
+}
+
+/**
+ * @brief Gets the kernel in use.
+ *
+ * @return FitKernel The active kernel (never FIT_KERNEL_AUTO).
+ */
+FitKernel get_fit_kernel() {
+    pthread_once(&kernel_once, install_best_kernel);
+    return active_kernel;
+}
+
+/**
+ * @brief Gets the name of the kernel in use.
+ *
+ * @return const char* "scalar", "sse2" or "avx2".
+ */
+const char* get_fit_kernel_name() {
+    switch (get_fit_kernel()) {
+        case FIT_KERNEL_SSE2:
+            return "sse2";
+        case FIT_KERNEL_AVX2:
+            return "avx2";
+        default:
+            return "scalar";
+    }
+}
+
+/**
+ * @brief Finds the smallest entry of a chunk that is at least need.
+ *
+ * @param chunk FIT_CHUNK_GRANULES side table entries.
+ * @param need Minimum entry value.
+ *
+ * @return uint16_t The smallest such entry, or FIT_NO_ENTRY if there is none.
+ */
+uint16_t fit_chunk_min_at_least(const uint16_t* chunk, uint16_t need) {
+    pthread_once(&kernel_once, install_best_kernel);
+    return min_kernel(chunk, need);
+}
+
+/**
+ * @brief Finds the largest entry of a chunk.
+ *
+ * @param chunk FIT_CHUNK_GRANULES side table entries.
+ *
+ * @return uint16_t The largest entry (0 if the chunk has no free block).
+ */
+uint16_t fit_chunk_max(const uint16_t* chunk) {
+    pthread_once(&kernel_once, install_best_kernel);
+    return max_kernel(chunk);
+}
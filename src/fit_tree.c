@@ -0,0 +1,294 @@
+/**
+ * @file fit_tree.c
+ * @brief Implementation of the best-fit free block index.
+ *
+ * A node's key is the size in granules it was inserted with, and ties are broken by
+ * node id, i.e. by address. The key is stored with the node, so a block can be removed
+ * after its header has already changed. Recursion depth is bounded by the AVL height,
+ * about 1.44 log2(HEAP_GRANULES).
+ */
+
+#include <stdbool.h>
+#include <string.h>
+#include "allocator.h"
+#include "fit_tree.h"
+
+static uint16_t tree_left[HEAP_GRANULES];
+static uint16_t tree_right[HEAP_GRANULES];
+static uint16_t tree_key[HEAP_GRANULES];        // size in granules, 0 if not in the tree
+static uint8_t tree_height[HEAP_GRANULES];
+static uint16_t tree_root = FIT_TREE_NONE;
+static size_t tree_count = 0;
+static size_t tree_span = 0;                    // node ids below this may be in use
+
+/**
+ * @brief Orders nodes by (key, id).
+ */
+static bool node_less(uint16_t a, uint16_t b) {
+    return tree_key[a] < tree_key[b] || (tree_key[a] == tree_key[b] && a < b);
+}
+
+static int height(uint16_t t) {
+    return t == FIT_TREE_NONE ? 0 : tree_height[t];
+}
+
+static void update_height(uint16_t t) {
+    int l = height(tree_left[t]);
+    int r = height(tree_right[t]);
+    tree_height[t] = (uint8_t)((l > r ? l : r) + 1);
+}
+
+static uint16_t rotate_right(uint16_t t) {
+    uint16_t l = tree_left[t];
+    tree_left[t] = tree_right[l];
+    tree_right[l] = t;
+    update_height(t);
+    update_height(l);
+    return l;
+}
+
+static uint16_t rotate_left(uint16_t t) {
+    uint16_t r = tree_right[t];
+    tree_right[t] = tree_left[r];
+    tree_left[r] = t;
+    update_height(t);
+    update_height(r);
+    return r;
+}
+
+/**
+ * @brief Restores the AVL balance of a subtree whose children are balanced.
+ *
+ * @return uint16_t New root of the subtree.
+ */
+static uint16_t rebalance(uint16_t t) {
+    update_height(t);
+    int balance = height(tree_left[t]) - height(tree_right[t]);
+    if (balance > 1) {
+        if (height(tree_left[tree_left[t]]) < height(tree_right[tree_left[t]])) {
+            tree_left[t] = rotate_left(tree_left[t]);
+        }
+        return rotate_right(t);
+    }
+    if (balance < -1) {
+        if (height(tree_right[tree_right[t]]) < height(tree_left[tree_right[t]])) {
+            tree_right[t] = rotate_right(tree_right[t]);
+        }
+        return rotate_left(t);
+    }
+    return t;
+}
+
+static uint16_t insert_node(uint16_t t, uint16_t node) {
+    if (t == FIT_TREE_NONE) {
+        return node;
+    }
+    if (node_less(node, t)) {
+        tree_left[t] = insert_node(tree_left[t], node);
+    } else {
+        tree_right[t] = insert_node(tree_right[t], node);
+    }
+    return rebalance(t);
+}
+
+/**
+ * @brief Detaches the minimum node of a subtree.
+ *
+ * @param t Root of the subtree.
+ * @param min Receives the detached node.
+ *
+ * @return uint16_t New root of the subtree.
+ */
+static uint16_t remove_min(uint16_t t, uint16_t* min) {
+    if (tree_left[t] == FIT_TREE_NONE) {
+        *min = t;
+        return tree_right[t];
+    }
+    tree_left[t] = remove_min(tree_left[t], min);
+    return rebalance(t);
+}
+
+static uint16_t remove_node(uint16_t t, uint16_t node) {
+    if (t == FIT_TREE_NONE) {
+        return t;
+    }
+    if (t != node) {
+        if (node_less(node, t)) {
+            tree_left[t] = remove_node(tree_left[t], node);
+        } else {
+            tree_right[t] = remove_node(tree_right[t], node);
+        }
+        return rebalance(t);
+    }
+
+    if (tree_left[t] == FIT_TREE_NONE) {
+        return tree_right[t];
+    }
+    if (tree_right[t] == FIT_TREE_NONE) {
+        return tree_left[t];
+    }
+    uint16_t successor;
+    uint16_t right = remove_min(tree_right[t], &successor);
+    tree_left[successor] = tree_left[t];
+    tree_right[successor] = right;
+    return rebalance(successor);
+}
+
+/**
+ * @brief Empties the index.
+ *
+ * @return void
+ */
+void fit_tree_reset() {
+    memset(tree_key, 0, tree_span * sizeof(uint16_t));
+    tree_root = FIT_TREE_NONE;
+    tree_count = 0;
+    tree_span = 0;
+}
+
+/**
+ * @brief Adds a free block to the index.
+ *
+ * @param node Granule where the block starts (must not be in the index).
+ * @param granules Size of the block in granules (not 0).
+ *
+ * @return void
+ */
+void fit_tree_insert(uint16_t node, uint16_t granules) {
+    tree_left[node] = FIT_TREE_NONE;
+    tree_right[node] = FIT_TREE_NONE;
+    tree_height[node] = 1;
+    tree_key[node] = granules;
+    tree_root = insert_node(tree_root, node);
+    tree_count++;
+    if ((size_t)node + 1 > tree_span) {
+        tree_span = (size_t)node + 1;
+    }
+}
+
+/**
+ * @brief Removes a block from the index; does nothing if it is not indexed.
+ *
+ * @param node Granule where the block starts.
+ *
+ * @return void
+ */
+void fit_tree_remove(uint16_t node) {
+    if (node >= tree_span || tree_key[node] == 0) {
+        return;
+    }
+    tree_root = remove_node(tree_root, node);
+    tree_key[node] = 0;
+    tree_count--;
+}
+
+/**
+ * @brief Re-keys a free block whose start moved, in place when the order allows.
+ *
+ * Carving the front off a free block leaves the remainder at a higher granule, and
+ * absorbing a free neighbour moves a block's start down. When the new (key, id) still
+ * sorts between the node's in-order neighbours, it takes over the node's links and
+ * the tree keeps its shape; otherwise the node is removed and the block reinserted.
+ *
+ * @param node Granule where the indexed block started; if it is not indexed, the
+ *        block is simply inserted.
+ * @param to Granule where the block now starts (not indexed unless equal to node).
+ * @param granules New size of the block in granules (not 0).
+ *
+ * @return void
+ */
+void fit_tree_move(uint16_t node, uint16_t to, uint16_t granules) {
+    if (fit_tree_key(node) == 0) {
+        fit_tree_insert(to, granules);
+        return;
+    }
+
+    // Find the link to the node, remembering the nearest ancestors on either side
+    uint16_t* link = &tree_root;
+    uint16_t lower = FIT_TREE_NONE;
+    uint16_t upper = FIT_TREE_NONE;
+    while (*link != node) {
+        if (node_less(node, *link)) {
+            upper = *link;
+            link = &tree_left[*link];
+        } else {
+            lower = *link;
+            link = &tree_right[*link];
+        }
+    }
+    for (uint16_t t = tree_left[node]; t != FIT_TREE_NONE; t = tree_right[t]) {
+        lower = t;
+    }
+    for (uint16_t t = tree_right[node]; t != FIT_TREE_NONE; t = tree_left[t]) {
+        upper = t;
+    }
+
+    uint16_t key = tree_key[node];
+    tree_key[to] = granules;
+    if ((lower == FIT_TREE_NONE || node_less(lower, to)) &&
+        (upper == FIT_TREE_NONE || node_less(to, upper))) {
+        if (to != node) {
+            tree_left[to] = tree_left[node];
+            tree_right[to] = tree_right[node];
+            tree_height[to] = tree_height[node];
+            tree_key[node] = 0;
+            *link = to;
+            if ((size_t)to + 1 > tree_span) {
+                tree_span = (size_t)to + 1;
+            }
+        }
+        return;
+    }
+    tree_key[to] = 0;
+    tree_key[node] = key;
+    fit_tree_remove(node);
+    fit_tree_insert(to, granules);
+}
+
+/**
+ * @brief Finds the smallest indexed block of at least need granules.
+ *
+ * @param need Minimum size in granules.
+ * @param steps Incremented by the number of nodes visited (may be NULL).
+ *
+ * @return uint16_t The block's granule (lowest address among equal sizes), or
+ *         FIT_TREE_NONE if no block is large enough.
+ */
+uint16_t fit_tree_best(uint16_t need, size_t* steps) {
+    uint16_t best = FIT_TREE_NONE;
+    uint16_t t = tree_root;
+    size_t visited = 0;
+    while (t != FIT_TREE_NONE) {
+        visited++;
+        if (tree_key[t] >= need) {
+            best = t;
+            t = tree_left[t];
+        } else {
+            t = tree_right[t];
+        }
+    }
+    if (steps != NULL) {
+        *steps += visited;
+    }
+    return best;
+}
+
+/**
+ * @brief Gets the size a block was indexed with.
+ *
+ * @param node Granule where the block starts.
+ *
+ * @return uint16_t Size in granules, or 0 if the block is not indexed.
+ */
+uint16_t fit_tree_key(uint16_t node) {
+    return node < tree_span ? tree_key[node] : 0;
+}
+
+/**
+ * @brief Gets the number of indexed blocks.
+ *
+ * @return size_t Number of indexed blocks.
+ */
+size_t fit_tree_count() {
+    return tree_count;
+}
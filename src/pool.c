@@ -0,0 +1,316 @@
+/**
+ * @file pool.c
+ * @brief Implementation of the fixed-size object pool.
+ *
+ * Objects are rounded up to ALIGNMENT and carved from chunks with a bump pointer, so
+ * a new chunk's memory is not touched until its objects are used. Released objects go
+ * on a singly linked LIFO list whose link occupies the object's first word. The pool
+ * mutex guards the list, the carving state and the chunk list.
+ *
+ * Magazines are per-thread stacks of object pointers. Each pool keeps its threads'
+ * magazines under its own thread-specific key, so a thread only ever touches its own
+ * magazine and magazine operations need no lock; an empty magazine is refilled and a
+ * full one drained half at a time under the mutex, which amortizes the lock over
+ * POOL_MAGAZINE_SIZE / 2 operations. When a thread exits, the key's destructor spills
+ * its magazine back to the shared list and frees it.
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include "allocator.h"
+#include "pool.h"
+
+/**
+ * PoolChunk heads every chunk; the objects follow it, aligned to ALIGNMENT.
+ */
+typedef struct PoolChunk {
+    struct PoolChunk* next;
+} PoolChunk;
+
+/**
+ * A free object's first word links it to the next free object.
+ */
+typedef struct PoolObject {
+    struct PoolObject* next;
+} PoolObject;
+
+typedef struct PoolMagazine {
+    Pool* pool;                                 // owner, for the spill when the thread exits
+    struct PoolMagazine* next;                  // next magazine of the same pool
+    size_t count;
+    void* objs[POOL_MAGAZINE_SIZE];
+} PoolMagazine;
+
+struct Pool {
+    pthread_mutex_t mutex;
+    size_t obj_size;                            // object size rounded up to ALIGNMENT
+    size_t objs_per_chunk;
+    PoolChunk* chunks;                          // every chunk, newest first
+    size_t chunk_count;
+    PoolObject* free_list;                      // released objects, most recent first
+    char* carve;                                // next never-used object in the newest chunk
+    char* carve_end;                            // end of the newest chunk's objects
+    bool magazines_enabled;
+    pthread_key_t magazine_key;                 // each thread's magazine, allocated on first use
+    PoolMagazine* magazines;                    // every live magazine, for pool_destroy
+};
+
+/**
+ * @brief Takes an object from the shared list or the newest chunk (mutex held).
+ *
+ * @return void* The object, or NULL if a new chunk could not be allocated.
+ */
+static void* take_object(Pool* pool) {
+    if (pool->free_list != NULL) {
+        PoolObject* obj = pool->free_list;
+        pool->free_list = obj->next;
+        return obj;
+    }
+
+    if (pool->carve == pool->carve_end) {
+        size_t header = (sizeof(PoolChunk) + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1);
+        // heap payloads are only 8-byte aligned, so leave room to align the first object
+        PoolChunk* chunk = heap_alloc(header + ALIGNMENT + pool->obj_size * pool->objs_per_chunk);
+        if (chunk == NULL) {
+            return NULL;
+        }
+        chunk->next = pool->chunks;
+        pool->chunks = chunk;
+        pool->chunk_count++;
+        uintptr_t first = ((uintptr_t)chunk + header + ALIGNMENT - 1) & ~(uintptr_t)(ALIGNMENT - 1);
+        pool->carve = (char*)first;
+        pool->carve_end = pool->carve + pool->obj_size * pool->objs_per_chunk;
+    }
+
+    void* obj = pool->carve;
+    pool->carve += pool->obj_size;
+    return obj;
+}
+
+/**
+ * @brief Pushes an object onto the shared list (mutex held).
+ */
+static void give_object(Pool* pool, void* obj) {
+    PoolObject* node = obj;
+    node->next = pool->free_list;
+    pool->free_list = node;
+}
+
+/**
+ * @brief Spills an exiting thread's magazine back to the shared list and frees it.
+ *
+ * Runs as the destructor of the pool's magazine key.
+ */
+static void release_magazine(void* value) {
+    PoolMagazine* magazine = value;
+    Pool* pool = magazine->pool;
+    pthread_mutex_lock(&pool->mutex);
+    for (size_t i = 0; i < magazine->count; i++) {
+        give_object(pool, magazine->objs[i]);
+    }
+    PoolMagazine** link = &pool->magazines;
+    while (*link != magazine) {
+        link = &(*link)->next;
+    }
+    *link = magazine->next;
+    pthread_mutex_unlock(&pool->mutex);
+    heap_free(magazine);
+}
+
+/**
+ * @brief Creates a pool of fixed-size objects.
+ *
+ * @param obj_size Size of each object in bytes (not 0).
+ * @param objs_per_chunk Objects carved from each heap chunk (not 0).
+ *
+ * @return Pool* The new pool, or NULL if the arguments are invalid or the heap is full.
+ */
+Pool* pool_create(size_t obj_size, size_t objs_per_chunk) {
+    if (obj_size == 0 || objs_per_chunk == 0 || obj_size > HEAP_CAPACITY / objs_per_chunk) {
+        set_last_status(ALLOC_ERROR);
+        return NULL;
+    }
+
+    Pool* pool = heap_alloc(sizeof(Pool));
+    if (pool == NULL) {
+        return NULL;
+    }
+    memset(pool, 0, sizeof(Pool));
+    pthread_mutex_init(&pool->mutex, NULL);
+    pool->obj_size = (obj_size + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1);
+    pool->objs_per_chunk = objs_per_chunk;
+    return pool;
+}
+
+/**
+ * @brief Gives each thread that uses the pool its own magazine of objects.
+ *
+ * Call this before the pool is shared between threads. A thread's magazine holds up
+ * to POOL_MAGAZINE_SIZE objects that only it can get, so the objects it caches are
+ * not available to other threads until they spill back to the shared list, which
+ * happens at the latest when the thread exits. Leaves magazines off (ALLOC_ERROR) if
+ * no thread-specific key is left for the pool.
+ *
+ * @param pool Pool to configure.
+ *
+ * @return void
+ */
+void pool_enable_magazines(Pool* pool) {
+    if (pool->magazines_enabled) {
+        return;
+    }
+    if (pthread_key_create(&pool->magazine_key, release_magazine) != 0) {
+        set_last_status(ALLOC_ERROR);
+        return;
+    }
+    pool->magazines_enabled = true;
+}
+
+/**
+ * @brief Destroys a pool, returning all of its chunks to the heap.
+ *
+ * Every object from the pool becomes invalid, including objects still in magazines.
+ *
+ * @param pool Pool to destroy (may be NULL).
+ *
+ * @return void
+ */
+void pool_destroy(Pool* pool) {
+    if (pool == NULL) {
+        return;
+    }
+    if (pool->magazines_enabled) {
+        // Deleting the key first keeps exiting threads from spilling into the pool
+        pthread_key_delete(pool->magazine_key);
+    }
+    PoolMagazine* magazine = pool->magazines;
+    while (magazine != NULL) {
+        PoolMagazine* next = magazine->next;
+        heap_free(magazine);
+        magazine = next;
+    }
+    PoolChunk* chunk = pool->chunks;
+    while (chunk != NULL) {
+        PoolChunk* next = chunk->next;
+        heap_free(chunk);
+        chunk = next;
+    }
+    pthread_mutex_destroy(&pool->mutex);
+    heap_free(pool);
+}
+
+/**
+ * @brief Gets the calling thread's magazine, allocating it on first use.
+ *
+ * @return PoolMagazine* The magazine, or NULL if magazines are disabled or the magazine
+ *         could not be allocated.
+ */
+static PoolMagazine* thread_magazine(Pool* pool) {
+    if (!pool->magazines_enabled) {
+        return NULL;
+    }
+    PoolMagazine* magazine = pthread_getspecific(pool->magazine_key);
+    if (magazine == NULL) {
+        magazine = heap_alloc(sizeof(PoolMagazine));
+        if (magazine == NULL) {
+            return NULL;
+        }
+        magazine->pool = pool;
+        magazine->count = 0;
+        pthread_mutex_lock(&pool->mutex);
+        magazine->next = pool->magazines;
+        pool->magazines = magazine;
+        pthread_mutex_unlock(&pool->mutex);
+        pthread_setspecific(pool->magazine_key, magazine);
+    }
+    return magazine;
+}
+
+/**
+ * @brief Gets an object from a pool.
+ *
+ * The object's contents are undefined: a reused object holds whatever it held when it
+ * was put back, except that its first word has been overwritten.
+ *
+ * @param pool Pool to get the object from.
+ *
+ * @return void* The object, aligned to ALIGNMENT, or NULL if the heap is full.
+ */
+void* pool_get(Pool* pool) {
+    PoolMagazine* magazine = thread_magazine(pool);
+    if (magazine != NULL && magazine->count > 0) {
+        return magazine->objs[--magazine->count];
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    void* obj = take_object(pool);
+    if (obj != NULL && magazine != NULL) {
+        // Refill half the magazine so the next gets do not need the lock
+        while (magazine->count < POOL_MAGAZINE_SIZE / 2) {
+            void* extra = take_object(pool);
+            if (extra == NULL) {
+                break;
+            }
+            magazine->objs[magazine->count++] = extra;
+        }
+    }
+    if (obj == NULL) {
+        set_last_status(ALLOC_OUT_OF_MEMORY);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return obj;
+}
+
+/**
+ * @brief Returns an object to its pool.
+ *
+ * @param pool Pool the object was taken from.
+ * @param obj Object from pool_get (may be NULL).
+ *
+ * @return void
+ */
+void pool_put(Pool* pool, void* obj) {
+    if (obj == NULL) {
+        return;
+    }
+    PoolMagazine* magazine = thread_magazine(pool);
+    if (magazine != NULL && magazine->count < POOL_MAGAZINE_SIZE) {
+        magazine->objs[magazine->count++] = obj;
+        return;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    if (magazine != NULL) {
+        // Spill the older half of a full magazine back to the shared list
+        for (size_t i = 0; i < POOL_MAGAZINE_SIZE / 2; i++) {
+            give_object(pool, magazine->objs[i]);
+        }
+        memmove(magazine->objs, magazine->objs + POOL_MAGAZINE_SIZE / 2,
+                (POOL_MAGAZINE_SIZE - POOL_MAGAZINE_SIZE / 2) * sizeof(void*));
+        magazine->count -= POOL_MAGAZINE_SIZE / 2;
+        magazine->objs[magazine->count++] = obj;
+    } else {
+        give_object(pool, obj);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+/**
+ * @brief Gets the size of a pool's objects, rounded up to ALIGNMENT.
+ */
+size_t pool_object_size(Pool* pool) {
+    return pool->obj_size;
+}
+
+/**
+ * @brief Gets the number of heap chunks a pool holds.
+ */
+size_t pool_chunk_count(Pool* pool) {
+    pthread_mutex_lock(&pool->mutex);
+    size_t count = pool->chunk_count;
+    pthread_mutex_unlock(&pool->mutex);
+    return count;
+}
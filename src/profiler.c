@@ -0,0 +1,441 @@
+/**
+ * @file profiler.c
+ * @brief Implementation of the sampling heap profiler.
+ *
+ * Allocations are sampled with an exponentially distributed byte countdown (mean equal
+ * to the sample interval), so on average one sample is taken every interval bytes no
+ * matter how the sizes are distributed. Each sample records its call stack in a stack
+ * table and is tracked in an address-keyed sample table until it is freed, which keeps
+ * live-bytes-by-stack aggregates current. All storage is static so the profiler never
+ * allocates, and the unsampled fast path is a single subtraction.
+ *
+ * The hooks run with the process heap's mutex held, and the other functions take it
+ * (heap_lock) before touching the tables, so enabling, resetting or dumping the profiler
+ * never races with an allocation on another thread.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include "allocator.h"
+#include "profiler.h"
+
+// Frames belonging to the profiler and allocator themselves (not reported)
+#define PROFILER_SKIP_FRAMES 2
+
+/**
+ * StackBucket aggregates all samples that share the same call stack.
+ */
+typedef struct {
+    uint64_t hash;                          // Hash of the frames (0 = empty slot)
+    int depth;                              // Number of valid frames
+    void* frames[PROFILER_MAX_DEPTH];       // Return addresses, innermost first
+    size_t live_samples;                    // Sampled blocks still allocated
+    size_t live_raw_bytes;                  // Requested bytes of those samples
+    size_t live_est_bytes;                  // Estimated live bytes they represent
+    size_t total_samples;                   // Samples ever taken at this stack
+    size_t total_raw_bytes;                 // Requested bytes of all samples
+} StackBucket;
+
+/**
+ * SampleEntry tracks one sampled block until it is freed.
+ */
+typedef struct {
+    void* ptr;          // Payload address (NULL = empty slot)
+    size_t size;        // Requested size
+    size_t weight;      // Estimated bytes this sample represents
+    int bucket;         // Index into the stack table
+} SampleEntry;
+
+static StackBucket stacks[PROFILER_MAX_STACKS];
+static SampleEntry samples[PROFILER_MAX_SAMPLES];
+
+static bool enabled = false;                    // Are new allocations being sampled?
+static size_t interval = PROFILER_DEFAULT_INTERVAL;
+static int64_t bytes_until_sample = 0;          // Countdown to the next sample
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+static size_t live_samples = 0;
+static size_t live_est_bytes = 0;
+static size_t dropped_samples = 0;
+
+/**
+ * @brief Advances the profiler's xorshift64* generator.
+ *
+ * @return uint64_t The next pseudo-random value.
+ */
+static uint64_t next_random() {
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * @brief Draws the distance (in bytes) to the next sampled allocation.
+ *
+ * The distance is exponentially distributed with mean equal to the sample interval,
+ * which makes every allocated byte equally likely to trigger a sample.
+ *
+ * @return int64_t The number of bytes until the next sample.
+ */
+static int64_t next_sample_distance() {
+    // 53 random bits mapped into (0, 1]
+    double u = ((double)(next_random() >> 11) + 1.0) / 9007199254740992.0;
+    double distance = -log(u) * (double)interval;
+    return (int64_t)distance + 1;
+}
+
+/**
+ * @brief Hashes a heap address into the sample table.
+ */
+static size_t sample_slot(void* ptr) {
+    uint64_t key = (uint64_t)(uintptr_t)ptr >> 4;
+    return (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & (PROFILER_MAX_SAMPLES - 1);
+}
+
+/**
+ * @brief Finds or creates the stack bucket for a captured call stack.
+ *
+ * @return int Index of the bucket, or -1 if the stack table is full.
+ */
+static int find_stack_bucket(void** frames, int depth) {
+    uint64_t hash = 14695981039346656037ULL;  // FNV-1a over the frame addresses
+    for (int i = 0; i < depth; i++) {
+        hash ^= (uint64_t)(uintptr_t)frames[i];
+        hash *= 1099511628211ULL;
+    }
+    if (hash == 0) {
+        hash = 1;
+    }
+
+    size_t slot = (size_t)hash & (PROFILER_MAX_STACKS - 1);
+    for (size_t probe = 0; probe < PROFILER_MAX_STACKS; probe++) {
+        StackBucket* bucket = &stacks[slot];
+        if (bucket->hash == 0) {
+            bucket->hash = hash;
+            bucket->depth = depth;
+            memcpy(bucket->frames, frames, depth * sizeof(void*));
+            return (int)slot;
+        }
+        if (bucket->hash == hash && bucket->depth == depth &&
+            memcmp(bucket->frames, frames, depth * sizeof(void*)) == 0) {
+            return (int)slot;
+        }
+        slot = (slot + 1) & (PROFILER_MAX_STACKS - 1);
+    }
+    return -1;
+}
+
+/**
+ * @brief Enables sampling of new allocations.
+ *
+ * @param sample_interval Mean number of allocated bytes between samples
+ *                        (0 selects PROFILER_DEFAULT_INTERVAL).
+ *
+ * @return void
+ */
+void profiler_enable(size_t sample_interval) {
+    heap_lock();
+    interval = sample_interval == 0 ? PROFILER_DEFAULT_INTERVAL : sample_interval;
+    bytes_until_sample = next_sample_distance();
+    enabled = true;
+    heap_unlock();
+}
+
+/**
+ * @brief Stops sampling new allocations.
+ *
+ * Samples that are already recorded stay live until their blocks are freed, so the
+ * aggregates remain accurate and can still be dumped.
+ *
+ * @return void
+ */
+void profiler_disable() {
+    heap_lock();
+    enabled = false;
+    heap_unlock();
+}
+
+/**
+ * @brief Discards all recorded stacks and samples.
+ *
+ * @return void
+ */
+void profiler_reset() {
+    heap_lock();
+    memset(stacks, 0, sizeof(stacks));
+    memset(samples, 0, sizeof(samples));
+    live_samples = 0;
+    live_est_bytes = 0;
+    dropped_samples = 0;
+    bytes_until_sample = next_sample_distance();
+    heap_unlock();
+}
+
+/**
+ * @brief Reports whether new allocations are being sampled.
+ *
+ * @return bool True if the profiler is enabled.
+ */
+bool profiler_is_enabled() {
+    heap_lock();
+    bool value = enabled;
+    heap_unlock();
+    return value;
+}
+
+/**
+ * @brief Allocation hook: samples the allocation if the byte countdown expired.
+ *
+ * @param ptr Payload address returned to the caller.
+ * @param size Number of bytes requested by the caller.
+ *
+ * @return void
+ */
+void profiler_record_alloc(void* ptr, size_t size) {
+    if (!enabled || ptr == NULL) {
+        return;
+    }
+
+    bytes_until_sample -= (int64_t)size;
+    if (bytes_until_sample > 0) {
+        return;
+    }
+    bytes_until_sample = next_sample_distance();
+
+    void* frames[PROFILER_MAX_DEPTH + PROFILER_SKIP_FRAMES];
+    int depth = backtrace(frames, PROFILER_MAX_DEPTH + PROFILER_SKIP_FRAMES);
+    int skip = depth > PROFILER_SKIP_FRAMES ? PROFILER_SKIP_FRAMES : 0;
+
+    int bucket_index = find_stack_bucket(frames + skip, depth - skip);
+    if (bucket_index < 0 || live_samples >= PROFILER_MAX_SAMPLES / 2) {
+        dropped_samples++;
+        return;
+    }
+
+    // Each sample stands for size / P(sampled) bytes of allocations like it
+    double probability = 1.0 - exp(-(double)size / (double)interval);
+    size_t weight = probability > 0.0 ? (size_t)((double)size / probability) : size;
+
+    // Retire a stale sample left at this address by a heap reset
+    profiler_record_free(ptr);
+
+    size_t slot = sample_slot(ptr);
+    while (samples[slot].ptr != NULL) {
+        slot = (slot + 1) & (PROFILER_MAX_SAMPLES - 1);
+    }
+
+    samples[slot].ptr = ptr;
+    samples[slot].size = size;
+    samples[slot].weight = weight;
+    samples[slot].bucket = bucket_index;
+
+    StackBucket* bucket = &stacks[bucket_index];
+    bucket->live_samples++;
+    bucket->live_raw_bytes += size;
+    bucket->live_est_bytes += weight;
+    bucket->total_samples++;
+    bucket->total_raw_bytes += size;
+
+    live_samples++;
+    live_est_bytes += weight;
+}
+
+/**
+ * @brief Free hook: retires the sample for ptr, if there is one.
+ *
+ * This stays active while the profiler is disabled so recorded samples never go stale.
+ *
+ * @param ptr Payload address being freed.
+ *
+ * @return void
+ */
+void profiler_record_free(void* ptr) {
+    if (live_samples == 0 || ptr == NULL) {
+        return;
+    }
+
+    size_t slot = sample_slot(ptr);
+    while (samples[slot].ptr != ptr) {
+        if (samples[slot].ptr == NULL) {
+            return;  // Not a sampled block
+        }
+        slot = (slot + 1) & (PROFILER_MAX_SAMPLES - 1);
+    }
+
+    StackBucket* bucket = &stacks[samples[slot].bucket];
+    bucket->live_samples--;
+    bucket->live_raw_bytes -= samples[slot].size;
+    bucket->live_est_bytes -= samples[slot].weight;
+    live_samples--;
+    live_est_bytes -= samples[slot].weight;
+
+    // Backward-shift deletion keeps linear probe chains intact without tombstones
+    size_t hole = slot;
+    size_t next = (hole + 1) & (PROFILER_MAX_SAMPLES - 1);
+    while (samples[next].ptr != NULL) {
+        size_t home = sample_slot(samples[next].ptr);
+        if (((next - home) & (PROFILER_MAX_SAMPLES - 1)) >= ((next - hole) & (PROFILER_MAX_SAMPLES - 1))) {
+            samples[hole] = samples[next];
+            hole = next;
+        }
+        next = (next + 1) & (PROFILER_MAX_SAMPLES - 1);
+    }
+    samples[hole].ptr = NULL;
+}
+
+/**
+ * @brief Gets the number of sampled blocks that are still allocated.
+ *
+ * @return size_t The number of live samples.
+ */
+size_t profiler_live_samples() {
+    heap_lock();
+    size_t value = live_samples;
+    heap_unlock();
+    return value;
+}
+
+/**
+ * @brief Gets the estimated number of live bytes across all stacks.
+ *
+ * @return size_t The estimated live heap bytes.
+ */
+size_t profiler_live_bytes() {
+    heap_lock();
+    size_t value = live_est_bytes;
+    heap_unlock();
+    return value;
+}
+
+/**
+ * @brief Gets the number of samples dropped because a table was full.
+ *
+ * @return size_t The number of dropped samples.
+ */
+size_t profiler_dropped_samples() {
+    heap_lock();
+    size_t value = dropped_samples;
+    heap_unlock();
+    return value;
+}
+
+/**
+ * @brief Writes a printable name for a return address.
+ */
+static void write_frame_name(FILE* fptr, void* addr) {
+    Dl_info info;
+    int found = dladdr(addr, &info);
+    if (found != 0 && info.dli_sname != NULL) {
+        fputs(info.dli_sname, fptr);
+    } else if (found != 0 && info.dli_fname != NULL) {
+        const char* base = strrchr(info.dli_fname, '/');
+        fprintf(fptr, "%s+0x%zx", base != NULL ? base + 1 : info.dli_fname,
+                (size_t)((char*)addr - (char*)info.dli_fbase));
+    } else {
+        fprintf(fptr, "%p", addr);
+    }
+}
+
+/**
+ * @brief Dumps live bytes by stack in folded-stack format.
+ *
+ * Each line holds the frames of one stack from outermost to innermost, separated by
+ * semicolons, followed by the estimated live bytes. The output feeds directly into
+ * flamegraph.pl or speedscope. Process-heap allocations wait while the stacks are
+ * written.
+ *
+ * @param filename The name of the file to write.
+ *
+ * @return bool True on success, false if the file could not be opened.
+ */
+bool profiler_dump_folded(const char* filename) {
+    FILE* fptr = fopen(filename, "w");
+    if (fptr == NULL) {
+        fprintf(stderr, "Error: Unable to open file: %s for writing.\n", filename);
+        return false;
+    }
+
+    heap_lock();
+    for (int i = 0; i < PROFILER_MAX_STACKS; i++) {
+        StackBucket* bucket = &stacks[i];
+        if (bucket->hash == 0 || bucket->live_samples == 0) {
+            continue;
+        }
+        for (int f = bucket->depth - 1; f >= 0; f--) {
+            write_frame_name(fptr, bucket->frames[f]);
+            if (f > 0) {
+                fputc(';', fptr);
+            }
+        }
+        fprintf(fptr, " %zu\n", bucket->live_est_bytes);
+    }
+    heap_unlock();
+
+    fclose(fptr);
+    return true;
+}
+
+/**
+ * @brief Dumps the profile in the legacy gperftools heap format understood by pprof.
+ *
+ * Counts are written unscaled together with the sample interval (heap_v2), so pprof
+ * performs the same unsampling as for tcmalloc profiles. The process memory map is
+ * appended for symbolization. Process-heap allocations wait while the stacks are
+ * written.
+ *
+ * @param filename The name of the file to write.
+ *
+ * @return bool True on success, false if the file could not be opened.
+ */
+bool profiler_dump_pprof(const char* filename) {
+    FILE* fptr = fopen(filename, "w");
+    if (fptr == NULL) {
+        fprintf(stderr, "Error: Unable to open file: %s for writing.\n", filename);
+        return false;
+    }
+
+    heap_lock();
+    size_t total_live = 0, total_live_bytes = 0, total_samples = 0, total_bytes = 0;
+    for (int i = 0; i < PROFILER_MAX_STACKS; i++) {
+        total_live += stacks[i].live_samples;
+        total_live_bytes += stacks[i].live_raw_bytes;
+        total_samples += stacks[i].total_samples;
+        total_bytes += stacks[i].total_raw_bytes;
+    }
+
+    fprintf(fptr, "heap profile: %zu: %zu [%zu: %zu] @ heap_v2/%zu\n",
+            total_live, total_live_bytes, total_samples, total_bytes, interval);
+
+    for (int i = 0; i < PROFILER_MAX_STACKS; i++) {
+        StackBucket* bucket = &stacks[i];
+        if (bucket->hash == 0) {
+            continue;
+        }
+        fprintf(fptr, "%zu: %zu [%zu: %zu] @", bucket->live_samples, bucket->live_raw_bytes,
+                bucket->total_samples, bucket->total_raw_bytes);
+        for (int f = 0; f < bucket->depth; f++) {
+            fprintf(fptr, " %p", bucket->frames[f]);
+        }
+        fprintf(fptr, "\n");
+    }
+    heap_unlock();
+
+    fprintf(fptr, "\nMAPPED_LIBRARIES:\n");
+    FILE* maps = fopen("/proc/self/maps", "r");
+    if (maps != NULL) {
+        char line[512];
+        while (fgets(line, sizeof(line), maps) != NULL) {
+            fputs(line, fptr);
+        }
+        fclose(maps);
+    }
+
+    fclose(fptr);
+    return true;
+}
@@ -0,0 +1,221 @@
+/**
+ * @file region.c
+ * @brief Implementation of the region (arena) allocator.
+ *
+ * Chunks are ordinary heap blocks linked through a small header, newest first. The
+ * Region itself lives at the start of the first ("home") chunk, which is kept by
+ * region_reset, so a region that fits its working set in one chunk resets without
+ * touching the heap at all. Requests larger than a chunk get a dedicated chunk that
+ * is linked behind the current one, leaving the current chunk's free space in use.
+ */
+
+#include <stdint.h>
+#include "region.h"
+
+/**
+ * RegionChunk heads every chunk; the bump area follows it.
+ */
+typedef struct RegionChunk {
+    struct RegionChunk* next;   // next chunk held by the region
+    size_t size;                // bytes held for the chunk, including this header
+} RegionChunk;
+
+struct Region {
+    Allocator* allocator;       // heap the chunks come from, NULL for the process heap
+    RegionChunk* chunks;        // current chunk first, then older and dedicated chunks
+    char* cursor;               // next free byte in the current chunk
+    char* limit;                // end of the current chunk
+    size_t chunk_size;          // size of regular chunks
+    size_t allocated;           // bytes handed out since the last reset
+    size_t chunk_count;         // chunks held, including the home chunk
+};
+
+/**
+ * @brief Rounds a pointer up to the next ALIGNMENT boundary.
+ */
+static char* align_pointer(char* p) {
+    return (char*)(((uintptr_t)p + ALIGNMENT - 1) & ~(uintptr_t)(ALIGNMENT - 1));
+}
+
+/**
+ * @brief Gets a chunk from the region's heap.
+ */
+static RegionChunk* chunk_alloc(Allocator* allocator, size_t size) {
+    RegionChunk* chunk = allocator != NULL ? heap_alloc_in(allocator, size) : heap_alloc(size);
+    if (chunk != NULL) {
+        chunk->next = NULL;
+        chunk->size = size;
+    }
+    return chunk;
+}
+
+/**
+ * @brief Returns a chunk to the region's heap.
+ */
+static void chunk_free(Allocator* allocator, RegionChunk* chunk) {
+    if (allocator != NULL) {
+        heap_free_in(allocator, chunk);
+    } else {
+        heap_free(chunk);
+    }
+}
+
+/**
+ * @brief Points the bump cursor at the free space of the home chunk.
+ */
+static void rewind_home(Region* region) {
+    RegionChunk* home = (RegionChunk*)((char*)region - sizeof(RegionChunk));
+    region->cursor = (char*)region + sizeof(Region);
+    region->limit = (char*)home + home->size;
+}
+
+/**
+ * @brief Creates a region whose chunks come from an allocator instance.
+ *
+ * @param allocator Instance to allocate chunks from, or NULL for the process heap.
+ * @param chunk_size Size of each chunk in bytes, or 0 for REGION_DEFAULT_CHUNK_SIZE.
+ *
+ * @return Region* The new region, or NULL if the first chunk could not be allocated.
+ */
+Region* region_create_in(Allocator* allocator, size_t chunk_size) {
+    if (chunk_size == 0) {
+        chunk_size = REGION_DEFAULT_CHUNK_SIZE;
+    }
+    if (chunk_size < sizeof(RegionChunk) + sizeof(Region) + ALIGNMENT) {
+        chunk_size = sizeof(RegionChunk) + sizeof(Region) + ALIGNMENT;
+    }
+
+    RegionChunk* home = chunk_alloc(allocator, chunk_size);
+    if (home == NULL) {
+        return NULL;
+    }
+
+    Region* region = (Region*)(home + 1);
+    region->allocator = allocator;
+    region->chunks = home;
+    region->chunk_size = chunk_size;
+    region->allocated = 0;
+    region->chunk_count = 1;
+    rewind_home(region);
+    return region;
+}
+
+/**
+ * @brief Creates a region whose chunks come from the process heap.
+ *
+ * @param chunk_size Size of each chunk in bytes, or 0 for REGION_DEFAULT_CHUNK_SIZE.
+ *
+ * @return Region* The new region, or NULL if the first chunk could not be allocated.
+ */
+Region* region_create(size_t chunk_size) {
+    return region_create_in(NULL, chunk_size);
+}
+
+/**
+ * @brief Allocates memory from a region.
+ *
+ * The memory is ALIGNMENT-aligned and stays valid until the region is reset or
+ * destroyed; it cannot be freed on its own.
+ *
+ * @param region Region to allocate from.
+ * @param size Number of bytes (not 0).
+ *
+ * @return Pointer to the memory, or NULL if size is 0 or a new chunk could not be
+ *         allocated.
+ */
+void* region_alloc(Region* region, size_t size) {
+    if (size == 0) {
+        set_last_status(ALLOC_ERROR);
+        return NULL;
+    }
+
+    char* p = align_pointer(region->cursor);
+    if (p <= region->limit && size <= (size_t)(region->limit - p)) {
+        region->cursor = p + size;
+        region->allocated += size;
+        return p;
+    }
+
+    // Room for the header, the request and the worst-case alignment gap
+    size_t needed = sizeof(RegionChunk) + ALIGNMENT + size;
+    if (needed < size) {
+        set_last_status(ALLOC_OUT_OF_MEMORY);
+        return NULL;
+    }
+    bool dedicated = needed > region->chunk_size;
+    RegionChunk* chunk = chunk_alloc(region->allocator, dedicated ? needed : region->chunk_size);
+    if (chunk == NULL) {
+        return NULL;
+    }
+
+    p = align_pointer((char*)(chunk + 1));
+    if (dedicated) {
+        // Keep bumping through the current chunk; the big block has it all to itself
+        chunk->next = region->chunks->next;
+        region->chunks->next = chunk;
+    } else {
+        chunk->next = region->chunks;
+        region->chunks = chunk;
+        region->cursor = p + size;
+        region->limit = (char*)chunk + chunk->size;
+    }
+    region->chunk_count++;
+    region->allocated += size;
+    return p;
+}
+
+/**
+ * @brief Releases everything allocated from a region, keeping the region usable.
+ *
+ * Every chunk except the home chunk is returned to the heap, so the cost is one
+ * heap_free per extra chunk, independent of how many allocations were made.
+ *
+ * @param region Region to reset.
+ *
+ * @return void
+ */
+void region_reset(Region* region) {
+    RegionChunk* home = (RegionChunk*)((char*)region - sizeof(RegionChunk));
+    RegionChunk* chunk = region->chunks;
+    while (chunk != NULL) {
+        RegionChunk* next = chunk->next;
+        if (chunk != home) {
+            chunk_free(region->allocator, chunk);
+        }
+        chunk = next;
+    }
+    home->next = NULL;
+    region->chunks = home;
+    region->allocated = 0;
+    region->chunk_count = 1;
+    rewind_home(region);
+}
+
+/**
+ * @brief Releases a region and everything allocated from it.
+ *
+ * @param region Region to destroy (may be NULL).
+ *
+ * @return void
+ */
+void region_destroy(Region* region) {
+    if (region == NULL) {
+        return;
+    }
+    region_reset(region);
+    chunk_free(region->allocator, (RegionChunk*)((char*)region - sizeof(RegionChunk)));
+}
+
+/**
+ * @brief Gets the number of bytes requested from a region since it was last reset.
+ */
+size_t region_allocated_bytes(Region* region) {
+    return region->allocated;
+}
+
+/**
+ * @brief Gets the number of chunks a region holds, including its home chunk.
+ */
+size_t region_chunk_count(Region* region) {
+    return region->chunk_count;
+}
@@ -6,12 +6,24 @@
  * stress tests, and validation scenarios to ensure robust allocator behavior.
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include "allocator.h"
+#include "fit_kernels.h"
+#include "pool.h"
+#include "profiler.h"
+#include "region.h"
+#include <pthread.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 // ANSI color codes for colored console output.
 #define ANSI_COLOR_RED "\x1b[31m"
@@ -32,10 +44,10 @@
 
 // Helper functions
 void reset_allocator() {
-    memset(heap, 0, HEAP_CAPACITY);
-    heap_size = 0;
-    first_block = NULL;
-    current_strategy = FIRST_FIT;
+    heap_reset();
+    memset(get_heap_base(), 0, HEAP_CAPACITY);
+    set_allocation_strategy(FIRST_FIT);
+    set_metadata_mode(METADATA_INLINE);
     set_last_status(ALLOC_SUCCESS);
 }
 
@@ -131,123 +143,1503 @@ void test_reallocation() {
         if (((char *)ptr2)[i] != 'X')
             TEST_FAILED();
     }
-    memset((char *)ptr2 + 100, 'Y', 100);
+    memset((char *)ptr2 + 100, 'Y', 100);
+
+    void *ptr3 = heap_realloc(ptr2, 50);
+    if (ptr3 == NULL)
+        TEST_FAILED();
+    for (int i = 0; i < 50; i++) {
+        if (((char *)ptr3)[i] != 'X')
+            TEST_FAILED();
+    }
+
+    heap_free(ptr3);
+    if (get_last_status() != ALLOC_SUCCESS)
+        TEST_FAILED();
+    TEST_PASSED();
+}
+
+void test_zero_allocation() {
+    reset_allocator();
+    void *ptr = heap_alloc(0);
+    if (ptr != NULL)
+        TEST_FAILED();
+    heap_free(ptr);
+    if (get_last_status() != ALLOC_INVALID_FREE)
+        TEST_FAILED();
+    TEST_PASSED();
+}
+
+void test_large_allocation() {
+    reset_allocator();
+    size_t half_heap = HEAP_CAPACITY / 2;
+    void *ptr = heap_alloc(half_heap - sizeof(BlockHeader) - 100);
+    if (ptr == NULL)
+        TEST_FAILED();
+    heap_free(ptr);
+    if (get_last_status() != ALLOC_SUCCESS)
+        TEST_FAILED();
+    TEST_PASSED();
+}
+
+void test_too_large_allocation() {
+    reset_allocator();
+    void *ptr = heap_alloc(HEAP_CAPACITY + 1);
+    if (ptr != NULL)
+        TEST_FAILED();
+    if (get_last_status() != ALLOC_OUT_OF_MEMORY)
+        TEST_FAILED();
+    TEST_PASSED();
+}
+
+void test_maximum_fragmentation() {
+    reset_allocator();
+    void *ptrs[100];
+    for (int i = 0; i < 100; i++) {
+        ptrs[i] = heap_alloc(64);
+        if (ptrs[i] == NULL)
+            TEST_FAILED();
+    }
+    for (int i = 0; i < 100; i += 2) {
+        heap_free(ptrs[i]);
+    }
+    double frag = get_fragmentation_ratio();
+    if (frag < 0.0 || frag > 0.1)
+        TEST_FAILED();
+    for (int i = 1; i < 100; i += 2) {
+        heap_free(ptrs[i]);
+    }
+    TEST_PASSED();
+}
+
+void test_invalid_free() {
+    reset_allocator();
+    heap_free(NULL);
+    if (get_last_status() != ALLOC_INVALID_FREE)
+        TEST_FAILED();
+    int stack_var;
+    heap_free(&stack_var);
+    if (get_last_status() != ALLOC_HEAP_ERROR)
+        TEST_FAILED();
+    TEST_PASSED();
+}
+
+void test_double_free() {
+    reset_allocator();
+    void *ptr = heap_alloc(100);
+    if (ptr == NULL)
+        TEST_FAILED();
+    heap_free(ptr);
+    if (get_last_status() != ALLOC_SUCCESS)
+        TEST_FAILED();
+    heap_free(ptr);
+    if (get_last_status() != ALLOC_INVALID_FREE)
+        TEST_FAILED();
+    TEST_PASSED();
+}
+
+void test_use_after_free() {
+    reset_allocator();
+    void *ptr = heap_alloc(100);
+    if (ptr == NULL)
+        TEST_FAILED();
+    heap_free(ptr);
+    memset(ptr, 'Z', 100);
+    TEST_PASSED();
+}
+
+void test_heap_integrity() {
+    reset_allocator();
+    void *ptr1 = heap_alloc(100);
+    void *ptr2 = heap_alloc(200);
+    void *ptr3 = heap_alloc(300);
+    if (!check_heap_integrity())
+        TEST_FAILED();
+    heap_free(ptr2);
+    heap_free(ptr1);
+    heap_free(ptr3);
+    if (!check_heap_integrity())
+        TEST_FAILED();
+    TEST_PASSED();
+}
+
+void test_integrity_detects_cycle() {
+    reset_allocator();
+    heap_alloc(100);
+    heap_alloc(200);
+    BlockHeader *last = (BlockHeader *)heap_alloc(300) - 1;
+    block_set_next(last, block_next(get_first_block()));
+    if (check_heap_integrity())
+        TEST_FAILED();
+    if (get_last_status() != ALLOC_HEAP_ERROR)
+        TEST_FAILED();
+    block_set_next(last, NULL);
+    if (!check_heap_integrity())
+        TEST_FAILED();
+    TEST_PASSED();
+}
+
+void test_integrity_detects_bad_size() {
+    reset_allocator();
+    heap_alloc(100);
+    BlockHeader *middle = (BlockHeader *)heap_alloc(100) - 1;
+    heap_alloc(100);
+    middle->size += ALIGNMENT;
+    if (check_heap_integrity())
+        TEST_FAILED();
+    TEST_PASSED();
+}
+
+static void *integrity_worker(void *arg) {
+    *(bool *)arg = check_heap_integrity();
+    return NULL;
+}
+
+void test_integrity_full_heap_small_stack() {
+    reset_allocator();
+    while (heap_alloc(1) != NULL) {
+    }
+
+    // The check must not need stack proportional to the number of blocks
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, 64 * 1024);
+    bool ok = false;
+    pthread_t thread;
+    if (pthread_create(&thread, &attr, integrity_worker, &ok) != 0)
+        TEST_FAILED();
+    pthread_join(thread, NULL);
+    pthread_attr_destroy(&attr);
+    if (!ok)
+        TEST_FAILED();
+    TEST_PASSED();
+}
+
+void test_verify_step_covers_heap() {
+    reset_allocator();
+    heap_verify_reset();
+    for (int i = 0; i < 10; i++) {
+        heap_alloc(32 + i * 16);
+    }
+    // Ten blocks, three per step: four steps finish the pass and a fifth starts over
+    for (int i = 0; i < 5; i++) {
+        if (!heap_verify_step(3))
+            TEST_FAILED();
+    }
+    if (heap_verify_get_corruption(NULL))
+        TEST_FAILED();
+    TEST_PASSED();
+}
+
+void test_verify_step_reports_location() {
+    reset_allocator();
+    heap_verify_reset();
+    void *ptrs[6];
+    for (int i = 0; i < 6; i++) {
+        ptrs[i] = heap_alloc(64);
+    }
+    BlockHeader *victim = (BlockHeader *)ptrs[4] - 1;
+    victim->size = 8;
+
+    bool found = false;
+    for (int i = 0; i < 10 && !found; i++) {
+        found = !heap_verify_step(2);
+    }
+    HeapCorruption corruption;
+    if (!found || !heap_verify_get_corruption(&corruption))
+        TEST_FAILED();
+    if (corruption.offset != (size_t)((char *)victim - get_heap_base()) || corruption.status != ALLOC_ALIGNMENT_ERROR)
+        TEST_FAILED();
+    heap_verify_reset();
+    TEST_PASSED();
+}
+
+void test_verify_budget_during_operations() {
+    reset_allocator();
+    heap_verify_reset();
+    heap_verify_set_budget(2);
+    unsigned int seed = 7;
+    void *ptrs[40] = {0};
+    for (int op = 0; op < 2000; op++) {
+        int idx = rand_r(&seed) % 40;
+        if (ptrs[idx] != NULL) {
+            heap_free(ptrs[idx]);
+            ptrs[idx] = NULL;
+        } else if (op % 3 == 0) {
+            ptrs[idx] = heap_alloc(16 + rand_r(&seed) % 300);
+        } else {
+            ptrs[idx] = heap_realloc(ptrs[idx], 16 + rand_r(&seed) % 300);
+        }
+    }
+    // Merging blocks must never strand the cursor inside a block
+    if (heap_verify_get_corruption(NULL))
+        TEST_FAILED();
+
+    BlockHeader *victim = (BlockHeader *)heap_alloc(64) - 1;
+    size_t size = victim->size;
+    victim->size = 8;
+    for (int i = 0; i < 200 && !heap_verify_get_corruption(NULL); i++) {
+        heap_free(heap_alloc(16));
+    }
+    heap_verify_set_budget(0);
+    victim->size = size;
+    HeapCorruption corruption;
+    if (!heap_verify_get_corruption(&corruption) || corruption.offset != (size_t)((char *)victim - get_heap_base()))
+        TEST_FAILED();
+    heap_verify_reset();
+    TEST_PASSED();
+}
+
+void test_free_rejects_interior_pointer() {
+    reset_allocator();
+    char *ptr = heap_alloc(100);
+    heap_free(ptr + ALIGNMENT);
+    if (get_last_status() != ALLOC_HEAP_ERROR)
+        TEST_FAILED();
+    if (heap_realloc(ptr + ALIGNMENT, 200) != NULL)
+        TEST_FAILED();
+    if (validate_pointer(ptr + 1) || !validate_pointer(ptr))
+        TEST_FAILED();
+    if (get_alloc_count() != 1)
+        TEST_FAILED();
+    heap_free(ptr);
+    TEST_PASSED();
+}
+
+void test_free_rejects_merged_block() {
+    reset_allocator();
+    void *ptr1 = heap_alloc(100);
+    void *ptr2 = heap_alloc(100);
+    void *ptr3 = heap_alloc(100);
+    heap_free(ptr2);
+    heap_free(ptr1);  // Absorbs ptr2's block
+
+    heap_free(ptr2);
+    if (get_last_status() != ALLOC_HEAP_ERROR)
+        TEST_FAILED();
+    if (!check_heap_integrity())
+        TEST_FAILED();
+    heap_free(ptr3);
+    TEST_PASSED();
+}
+
+void test_realloc_rejects_freed_block() {
+    reset_allocator();
+    void *ptr1 = heap_alloc(100);
+    heap_alloc(100);  // Keeps ptr1's block from merging into the heap end
+    heap_free(ptr1);
+
+    // The freed block still has a valid canary, but it has no owner to resize it
+    if (heap_realloc(ptr1, 64) != NULL || get_last_status() != ALLOC_INVALID_FREE)
+        TEST_FAILED();
+    if (!check_heap_integrity() || heap_alloc(64) != ptr1)
+        TEST_FAILED();
+    TEST_PASSED();
+}
+
+void test_integrity_detects_forged_header() {
+    reset_allocator();
+    heap_alloc(100);
+    BlockHeader *victim = (BlockHeader *)heap_alloc(100) - 1;
+    heap_alloc(100);
+    victim->canary ^= 1;
+    if (check_heap_integrity())
+        TEST_FAILED();
+    if (validate_pointer(victim + 1))
+        TEST_FAILED();
+    victim->canary ^= 1;
+    TEST_PASSED();
+}
+
+// Runs a fixed random workload and records every returned pointer
+static void run_metadata_workload(void **trace, int ops) {
+    unsigned int seed = 11;
+    void *ptrs[60] = {0};
+    for (int op = 0; op < ops; op++) {
+        int idx = rand_r(&seed) % 60;
+        if (ptrs[idx] != NULL && rand_r(&seed) % 3 != 0) {
+            heap_free(ptrs[idx]);
+            ptrs[idx] = NULL;
+        } else {
+            ptrs[idx] = heap_realloc(ptrs[idx], 16 + rand_r(&seed) % 400);
+        }
+        trace[op] = ptrs[idx];
+    }
+}
+
+void test_side_table_matches_inline() {
+    AllocationStrategy strategies[] = {FIRST_FIT, BEST_FIT, WORST_FIT, NEXT_FIT};
+    static void *inline_trace[3000];
+    static void *side_trace[3000];
+    for (int i = 0; i < 4; i++) {
+        reset_allocator();
+        set_allocation_strategy(strategies[i]);
+        run_metadata_workload(inline_trace, 3000);
+        size_t inline_free = get_free_block_count();
+        size_t inline_bytes = get_free_heap_size();
+        size_t inline_allocs = get_alloc_count();
+
+        reset_allocator();
+        set_allocation_strategy(strategies[i]);
+        set_metadata_mode(METADATA_SIDE_TABLE);
+        run_metadata_workload(side_trace, 3000);
+        if (memcmp(inline_trace, side_trace, sizeof(inline_trace)) != 0)
+            TEST_FAILED();
+        if (get_free_block_count() != inline_free || get_free_heap_size() != inline_bytes ||
+            get_alloc_count() != inline_allocs)
+            TEST_FAILED();
+        if (!check_heap_integrity())
+            TEST_FAILED();
+    }
+    set_metadata_mode(METADATA_INLINE);
+    TEST_PASSED();
+}
+
+void test_side_table_detects_header_overwrite() {
+    reset_allocator();
+    set_metadata_mode(METADATA_SIDE_TABLE);
+    char *ptr1 = heap_alloc(64);
+    char *ptr2 = heap_alloc(64);
+    heap_alloc(64);
+    if (!check_heap_integrity())
+        TEST_FAILED();
+
+    // An overflow of ptr1 that flips the free flag of ptr2's header
+    BlockHeader *header = (BlockHeader *)(ptr2 - sizeof(BlockHeader));
+    header->free = true;
+    if (check_heap_integrity())
+        TEST_FAILED();
+    header->free = false;
+    (void)ptr1;
+    set_metadata_mode(METADATA_INLINE);
+    TEST_PASSED();
+}
+
+void test_fit_kernels_match_scalar() {
+    static uint16_t chunk[FIT_CHUNK_GRANULES] __attribute__((aligned(64)));
+    FitKernel kernels[] = {FIT_KERNEL_SSE2, FIT_KERNEL_AVX2};
+    unsigned int seed = 3;
+    for (int round = 0; round < 500; round++) {
+        for (int i = 0; i < FIT_CHUNK_GRANULES; i++) {
+            // Mostly empty entries, some small blocks, the odd huge one
+            int r = rand_r(&seed) % 10;
+            chunk[i] = r < 6 ? 0 : r < 9 ? 2 + rand_r(&seed) % 30 : 30000 + rand_r(&seed) % 10000;
+        }
+        uint16_t need = 2 + rand_r(&seed) % 40;
+
+        set_fit_kernel(FIT_KERNEL_SCALAR);
+        uint16_t expected_min = fit_chunk_min_at_least(chunk, need);
+        uint16_t expected_max = fit_chunk_max(chunk);
+        for (int k = 0; k < 2; k++) {
+            if (!set_fit_kernel(kernels[k]))
+                continue;  // Not supported on this CPU
+            if (fit_chunk_min_at_least(chunk, need) != expected_min || fit_chunk_max(chunk) != expected_max)
+                TEST_FAILED();
+        }
+    }
+    set_fit_kernel(FIT_KERNEL_AUTO);
+    TEST_PASSED();
+}
+
+void test_side_table_kernels_match_inline() {
+    AllocationStrategy strategies[] = {BEST_FIT, WORST_FIT};
+    FitKernel kernels[] = {FIT_KERNEL_SCALAR, FIT_KERNEL_SSE2, FIT_KERNEL_AVX2};
+    static void *inline_trace[3000];
+    static void *side_trace[3000];
+    for (int i = 0; i < 2; i++) {
+        reset_allocator();
+        set_allocation_strategy(strategies[i]);
+        run_metadata_workload(inline_trace, 3000);
+
+        for (int k = 0; k < 3; k++) {
+            if (!set_fit_kernel(kernels[k]))
+                continue;
+            reset_allocator();
+            set_allocation_strategy(strategies[i]);
+            set_metadata_mode(METADATA_SIDE_TABLE);
+            run_metadata_workload(side_trace, 3000);
+            if (memcmp(inline_trace, side_trace, sizeof(inline_trace)) != 0)
+                TEST_FAILED();
+        }
+    }
+    set_fit_kernel(FIT_KERNEL_AUTO);
+    set_metadata_mode(METADATA_INLINE);
+    TEST_PASSED();
+}
+
+void test_bitmap_allocations_have_no_header() {
+    reset_allocator();
+    set_allocation_strategy(BITMAP);
+    void *a = heap_alloc(16);
+    void *b = heap_alloc(1);
+    void *c = heap_alloc(40);
+    if (a != (void *)get_heap_base() || b != (void *)(get_heap_base() + 16) || c != (void *)(get_heap_base() + 32))
+        TEST_FAILED();
+    if (bitmap_block_size(a) != 16 || bitmap_block_size(b) != 16 || bitmap_block_size(c) != 48)
+        TEST_FAILED();
+    if (get_alloc_count() != 3 || get_used_heap_size() != 80 || get_free_heap_size() != 0)
+        TEST_FAILED();
+    memset(c, 'C', 40);
+    heap_free(b);
+    if (get_free_block_count() != 1 || get_free_heap_size() != 16 || !check_heap_integrity())
+        TEST_FAILED();
+    // The freed granule is reused before the heap grows
+    if (heap_alloc(10) != b || ((char *)c)[39] != 'C')
+        TEST_FAILED();
+    TEST_PASSED();
+}
+
+void test_bitmap_rejects_invalid_frees() {
+    reset_allocator();
+    set_allocation_strategy(BITMAP);
+    char *a = heap_alloc(64);
+    heap_free(a + 16);
+    if (get_last_status() != ALLOC_HEAP_ERROR)
+        TEST_FAILED();
+    heap_free(a + 1);
+    if (get_last_status() != ALLOC_HEAP_ERROR)
+        TEST_FAILED();
+    heap_free(a);
+    if (get_last_status() != ALLOC_SUCCESS)
+        TEST_FAILED();
+    heap_free(a);
+    if (get_last_status() != ALLOC_INVALID_FREE)
+        TEST_FAILED();
+    TEST_PASSED();
+}
+
+void test_bitmap_realloc() {
+    reset_allocator();
+    set_allocation_strategy(BITMAP);
+    char *a = heap_alloc(32);
+    char *b = heap_alloc(32);
+    memset(a, 'A', 32);
+    // Shrinking releases the tail, which growing then claims back in place
+    if (heap_realloc(a, 16) != a || bitmap_block_size(a) != 16 || get_free_heap_size() != 16)
+        TEST_FAILED();
+    if (heap_realloc(a, 32) != a || bitmap_block_size(a) != 32)
+        TEST_FAILED();
+    // b blocks growth in place, so the block moves with its contents
+    char *moved = heap_realloc(a, 100);
+    if (moved == a || moved == NULL || moved[0] != 'A' || moved[15] != 'A')
+        TEST_FAILED();
+    if (!validate_pointer(b) || validate_pointer(a) || !check_heap_integrity())
+        TEST_FAILED();
+    TEST_PASSED();
+}
+
+void test_bitmap_fills_heap() {
+    reset_allocator();
+    set_allocation_strategy(BITMAP);
+    size_t count = 0;
+    while (heap_alloc(ALIGNMENT) != NULL)
+        count++;
+    if (count != HEAP_GRANULES || get_last_status() != ALLOC_OUT_OF_MEMORY)
+        TEST_FAILED();
+    heap_free(get_heap_base() + 100 * ALIGNMENT);
+    if (heap_alloc(ALIGNMENT) != (void *)(get_heap_base() + 100 * ALIGNMENT) || !check_heap_integrity())
+        TEST_FAILED();
+    TEST_PASSED();
+}
+
+void test_bitmap_strategy_switch_refused() {
+    reset_allocator();
+    heap_alloc(64);
+    set_allocation_strategy(BITMAP);
+    if (get_last_status() != ALLOC_INVALID_OPERATION || get_allocation_strategy() != FIRST_FIT)
+        TEST_FAILED();
+    reset_allocator();
+    set_allocation_strategy(BITMAP);
+    heap_alloc(64);
+    set_allocation_strategy(BEST_FIT);
+    if (get_last_status() != ALLOC_INVALID_OPERATION || get_allocation_strategy() != BITMAP)
+        TEST_FAILED();
+    TEST_PASSED();
+}
+
+void test_buddy_splits_and_merges() {
+    reset_allocator();
+    set_allocation_strategy(BUDDY);
+    char *a = heap_alloc(100);
+    // The heap starts as blocks of 512K, 64K, 32K, 16K and 1K; the 1K block is split down to 128 bytes
+    if (a == NULL || buddy_block_size(a) != 128 || (size_t)(a - get_heap_base()) % 128 != 0)
+        TEST_FAILED();
+    if (get_free_block_count() != 7 || buddy_free_blocks(3) != 1 || buddy_free_blocks(6) != 0)
+        TEST_FAILED();
+    heap_free(a);
+    if (get_free_block_count() != 5 || buddy_free_blocks(6) != 1 || get_free_heap_size() != HEAP_CAPACITY)
+        TEST_FAILED();
+    if (!check_heap_integrity())
+        TEST_FAILED();
+    TEST_PASSED();
+}
+
+void test_buddy_rejects_invalid_frees() {
+    reset_allocator();
+    set_allocation_strategy(BUDDY);
+    char *a = heap_alloc(64);
+    char *b = heap_alloc(16);
+    heap_free(a + 16);
+    if (get_last_status() != ALLOC_HEAP_ERROR)
+        TEST_FAILED();
+    heap_free(a);
+    heap_free(a);
+    if (get_last_status() != ALLOC_INVALID_FREE)
+        TEST_FAILED();
+    if (!validate_pointer(b) || validate_pointer(a) || !check_heap_integrity())
+        TEST_FAILED();
+    TEST_PASSED();
+}
+
+void test_buddy_realloc() {
+    reset_allocator();
+    set_allocation_strategy(BUDDY);
+    char *a = heap_alloc(64);
+    memset(a, 'A', 64);
+    // a's buddy is free, so it grows in place and shrinks back by splitting
+    if (heap_realloc(a, 128) != a || buddy_block_size(a) != 128)
+        TEST_FAILED();
+    if (heap_realloc(a, 32) != a || buddy_block_size(a) != 32 || a[31] != 'A')
+        TEST_FAILED();
+    char *b = heap_alloc(32);
+    if (b != a + 32)
+        TEST_FAILED();
+    char *moved = heap_realloc(a, 64);
+    if (moved == a || moved == NULL || moved[0] != 'A' || moved[31] != 'A' || !check_heap_integrity())
+        TEST_FAILED();
+    TEST_PASSED();
+}
+
+void test_buddy_detects_free_list_overwrite() {
+    reset_allocator();
+    set_allocation_strategy(BUDDY);
+    char *a = heap_alloc(64);
+    char *b = heap_alloc(64);
+    heap_free(b);
+    if (!check_heap_integrity())
+        TEST_FAILED();
+    memset(b, 0x5A, 16);  // Use after free clobbers the free list links
+    if (check_heap_integrity() || get_last_status() != ALLOC_HEAP_ERROR)
+        TEST_FAILED();
+    (void)a;
+    TEST_PASSED();
+}
+
+void test_buddy_fills_and_drains_heap() {
+    reset_allocator();
+    set_allocation_strategy(BUDDY);
+    static void *blocks[HEAP_GRANULES];
+    size_t count = 0;
+    void *block;
+    while (count < HEAP_GRANULES && (block = heap_alloc(ALIGNMENT)) != NULL)
+        blocks[count++] = block;
+    if (count != HEAP_GRANULES || heap_alloc(ALIGNMENT) != NULL || get_free_block_count() != 0 || get_alloc_count() != count)
+        TEST_FAILED();
+    for (size_t i = 0; i < count; i += 2)
+        heap_free(blocks[i]);
+    for (size_t i = 1; i < count; i += 2)
+        heap_free(blocks[i]);
+    // Everything merges back into the initial top-level blocks
+    if (get_free_block_count() != 5 || get_alloc_count() != 0 || !check_heap_integrity())
+        TEST_FAILED();
+    TEST_PASSED();
+}
+
+void test_allocator_instances_are_isolated() {
+    reset_allocator();
+    static char buffer_a[64 * 1024] __attribute__((aligned(16)));
+    static char buffer_b[64 * 1024] __attribute__((aligned(16)));
+    Allocator *a = allocator_create(buffer_a, sizeof(buffer_a));
+    Allocator *b = allocator_create(buffer_b, sizeof(buffer_b));
+    if (a == NULL || b == NULL)
+        TEST_FAILED();
+    char *pa = heap_alloc_in(a, 100);
+    char *pb = heap_alloc_in(b, 200);
+    char *p = heap_alloc(300);
+    if (pa < buffer_a || pa >= buffer_a + sizeof(buffer_a) || pb < buffer_b || pb >= buffer_b + sizeof(buffer_b))
+        TEST_FAILED();
+    // Each heap sees only its own block
+    if (get_used_heap_size() != align(300 + sizeof(BlockHeader)) ||
+        get_used_heap_size_in(a) != align(100 + sizeof(BlockHeader)) ||
+        get_used_heap_size_in(b) != align(200 + sizeof(BlockHeader)))
+        TEST_FAILED();
+    // A pointer from another heap is rejected
+    heap_free_in(a, pb);
+    if (get_last_status() != ALLOC_HEAP_ERROR)
+        TEST_FAILED();
+    heap_free_in(a, pa);
+    heap_free_in(b, pb);
+    heap_free(p);
+    if (!check_heap_integrity_in(a) || !check_heap_integrity_in(b) || !check_heap_integrity())
+        TEST_FAILED();
+    if (get_free_heap_size_in(a) != get_used_heap_size_in(a))
+        TEST_FAILED();
+    allocator_destroy(a);
+    allocator_destroy(b);
+    TEST_PASSED();
+}
+
+void test_allocator_reset_releases_everything() {
+    static char buffer[32 * 1024] __attribute__((aligned(16)));
+    Allocator *a = allocator_create(buffer, sizeof(buffer));
+    set_allocation_strategy_in(a, NEXT_FIT);
+    void *first = heap_alloc_in(a, 64);
+    while (heap_alloc_in(a, 64) != NULL)
+        ;
+    if (get_last_status() != ALLOC_OUT_OF_MEMORY || get_used_heap_size_in(a) > get_heap_capacity_in(a))
+        TEST_FAILED();
+    allocator_reset(a);
+    if (get_used_heap_size_in(a) != 0 || heap_alloc_in(a, 64) != first || !check_heap_integrity_in(a))
+        TEST_FAILED();
+    // BITMAP and BUDDY metadata is process-wide, so instances refuse them
+    set_allocation_strategy_in(a, BUDDY);
+    if (get_last_status() != ALLOC_INVALID_OPERATION)
+        TEST_FAILED();
+    allocator_destroy(a);
+    TEST_PASSED();
+}
+
+void test_allocator_mapped_exceeds_process_heap() {
+    Allocator *a = allocator_create_mapped(4 * HEAP_CAPACITY);
+    if (a == NULL || get_heap_capacity_in(a) <= 3 * HEAP_CAPACITY)
+        TEST_FAILED();
+    set_allocation_strategy_in(a, BEST_FIT);
+    char *big = heap_alloc_in(a, 2 * HEAP_CAPACITY);
+    char *small = heap_alloc_in(a, 100);
+    if (big == NULL || small == NULL)
+        TEST_FAILED();
+    memset(big, 0x5A, 2 * HEAP_CAPACITY);
+    big = heap_realloc_in(a, big, HEAP_CAPACITY);
+    if (big == NULL || big[HEAP_CAPACITY - 1] != 0x5A || !check_heap_integrity_in(a))
+        TEST_FAILED();
+    heap_free_in(a, big);
+    heap_free_in(a, small);
+    if (get_free_heap_size_in(a) != get_used_heap_size_in(a))
+        TEST_FAILED();
+    allocator_destroy(a);
+    TEST_PASSED();
+}
+
+void test_heap_reset_is_lazy() {
+    reset_allocator();
+    void *first = heap_alloc(100);
+    for (int i = 0; i < 50; i++)
+        heap_alloc(100);
+    heap_reset();
+    // The old blocks are still in memory but no longer part of the heap
+    if (get_used_heap_size() != 0 || validate_pointer(first))
+        TEST_FAILED();
+    if (heap_alloc(500) != first || get_free_block_count() != 0 || !check_heap_integrity())
+        TEST_FAILED();
+    TEST_PASSED();
+}
+
+static void *instance_worker(void *arg) {
+    Allocator *allocator = arg;
+    for (int i = 0; i < 20000; i++)
+        heap_free_in(allocator, heap_alloc_in(allocator, 16 + i % 200));
+    return NULL;
+}
+
+void test_instances_run_beside_process_heap() {
+    reset_allocator();
+    static char buffer[64 * 1024] __attribute__((aligned(16)));
+    Allocator *allocator = allocator_create(buffer, sizeof(buffer));
+    char *base = get_heap_base();
+    void *mine = heap_alloc(100);
+    pthread_t thread;
+    if (allocator == NULL || pthread_create(&thread, NULL, instance_worker, allocator) != 0)
+        TEST_FAILED();
+    // Another thread working on the instance never changes what the process heap's names mean
+    bool valid = true;
+    for (int i = 0; i < 20000; i++) {
+        valid = valid && get_heap_base() == base && validate_pointer(mine);
+        heap_free(heap_alloc(16 + i % 200));
+    }
+    pthread_join(thread, NULL);
+    if (!valid || !check_heap_integrity() || !check_heap_integrity_in(allocator) ||
+        get_free_heap_size_in(allocator) != get_used_heap_size_in(allocator))
+        TEST_FAILED();
+    TEST_PASSED();
+}
+
+void test_region_bumps_within_chunk() {
+    reset_allocator();
+    Region *region = region_create(4096);
+    size_t blocks = get_alloc_count();
+    char *a = region_alloc(region, 10);
+    char *b = region_alloc(region, 100);
+    char *c = region_alloc(region, 1);
+    // Consecutive, aligned and without any heap traffic
+    if (a == NULL || (uintptr_t)a % ALIGNMENT != 0 || b != a + 16 || c != b + 112)
+        TEST_FAILED();
+    if (get_alloc_count() != blocks || region_chunk_count(region) != 1 || region_allocated_bytes(region) != 111)
+        TEST_FAILED();
+    region_destroy(region);
+    if (get_alloc_count() != 0 || !check_heap_integrity())
+        TEST_FAILED();
+    TEST_PASSED();
+}
+
+void test_region_grows_and_resets() {
+    reset_allocator();
+    Region *region = region_create(1024);
+    char *first = region_alloc(region, 64);
+    for (int i = 0; i < 100; i++) {
+        char *p = region_alloc(region, 64);
+        if (p == NULL)
+            TEST_FAILED();
+        memset(p, i, 64);
+    }
+    // A request larger than a chunk gets a chunk of its own
+    char *big = region_alloc(region, 5000);
+    char *after = region_alloc(region, 16);
+    if (big == NULL || after == NULL || (after >= big && after < big + 5000))
+        TEST_FAILED();
+    if (region_chunk_count(region) < 8 || get_alloc_count() != region_chunk_count(region))
+        TEST_FAILED();
+    // Reset hands every chunk but the first back to the heap and starts over
+    region_reset(region);
+    if (region_chunk_count(region) != 1 || get_alloc_count() != 1 || region_alloc(region, 64) != first)
+        TEST_FAILED();
+    region_destroy(region);
+    if (get_alloc_count() != 0 || !check_heap_integrity())
+        TEST_FAILED();
+    TEST_PASSED();
+}
+
+void test_region_in_allocator_instance() {
+    reset_allocator();
+    static char buffer[16 * 1024] __attribute__((aligned(16)));
+    Allocator *a = allocator_create(buffer, sizeof(buffer));
+    Region *region = region_create_in(a, 512);
+    char *p = NULL;
+    for (int i = 0; i < 40; i++)
+        p = region_alloc(region, 100);
+    if (p < buffer || p >= buffer + sizeof(buffer) || get_used_heap_size() != 0)
+        TEST_FAILED();
+    region_destroy(region);
+    if (get_free_heap_size_in(a) != get_used_heap_size_in(a) || !check_heap_integrity_in(a))
+        TEST_FAILED();
+    allocator_destroy(a);
+    TEST_PASSED();
+}
+
+void test_persistent_heap_survives_reopen() {
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/allocator_test_heap_%d", (int)getpid());
+    unlink(path);
+    Allocator *a = heap_open(path, 256 * 1024);
+    if (a == NULL)
+        TEST_FAILED();
+    set_allocation_strategy_in(a, BEST_FIT);
+    char *root = heap_alloc_in(a, 64);
+    strcpy(root, "warm start");
+    void *spare = heap_alloc_in(a, 1000);
+    heap_alloc_in(a, 500);
+    heap_free_in(a, spare);
+    heap_set_root(a, root);
+    size_t used = get_used_heap_size_in(a);
+    size_t free_bytes = get_free_heap_size_in(a);
+    if (!heap_sync(a))
+        TEST_FAILED();
+    allocator_destroy(a);
+
+    // Keep the old address busy so the file is mapped somewhere else
+    int fd = open(path, O_RDONLY);
+    void *placeholder = mmap(a, 256 * 1024, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    Allocator *b = heap_open(path, 0);
+    if (b == NULL)
+        TEST_FAILED();
+    root = heap_get_root(b);
+    if (root == NULL || strcmp(root, "warm start") != 0 || get_used_heap_size_in(b) != used ||
+        get_free_heap_size_in(b) != free_bytes || !check_heap_integrity_in(b))
+        TEST_FAILED();
+    // The reopened heap keeps allocating where it left off, reusing the freed block
+    if (heap_alloc_in(b, 900) == NULL || get_used_heap_size_in(b) != used || !check_heap_integrity_in(b))
+        TEST_FAILED();
+    allocator_destroy(b);
+    munmap(placeholder, 256 * 1024);
+    unlink(path);
+    TEST_PASSED();
+}
+
+void test_persistent_heap_rejects_foreign_file() {
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/allocator_test_junk_%d", (int)getpid());
+    FILE *file = fopen(path, "wb");
+    for (int i = 0; i < 4096; i++)
+        fputc(i, file);
+    fclose(file);
+    if (heap_open(path, 0) != NULL || get_last_status() != ALLOC_HEAP_ERROR)
+        TEST_FAILED();
+    unlink(path);
+    TEST_PASSED();
+}
+
+void test_persistent_heap_rejects_broken_block_list() {
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/allocator_test_broken_%d", (int)getpid());
+    unlink(path);
+    Allocator *a = heap_open(path, 64 * 1024);
+    if (a == NULL)
+        TEST_FAILED();
+    char *first = heap_alloc_in(a, 64);
+    heap_alloc_in(a, 64);
+    BlockHeader *header = (BlockHeader *)(first - sizeof(BlockHeader));
+    off_t at = (off_t)((char *)&header->next - (char *)a);
+    size_t next = header->next + ALIGNMENT;
+    heap_sync(a);
+    allocator_destroy(a);
+
+    // Point the first block's next link into the middle of its neighbour
+    int fd = open(path, O_RDWR);
+    if (fd < 0 || pwrite(fd, &next, sizeof(next), at) != sizeof(next))
+        TEST_FAILED();
+    close(fd);
+    if (heap_open(path, 0) != NULL || get_last_status() != ALLOC_HEAP_ERROR)
+        TEST_FAILED();
+    unlink(path);
+    TEST_PASSED();
+}
+
+void test_shared_heap_passes_offsets_between_processes() {
+    char name[64];
+    snprintf(name, sizeof(name), "/allocator_test_shared_%d", (int)getpid());
+    heap_unlink_shared(name);
+    Allocator *a = heap_open_shared(name, 256 * 1024);
+    if (a == NULL)
+        TEST_FAILED();
+    int fds[2];
+    if (pipe(fds) != 0)
+        TEST_FAILED();
+
+    pid_t child = fork();
+    if (child == 0) {
+        // A separate mapping of the same heap, at a different address
+        Allocator *b = heap_open_shared(name, 0);
+        int ok = b != NULL && b != a;
+        for (int i = 0; ok && i < 500; i++) {
+            void *p = heap_alloc_in(b, 16 + i % 200);
+            ok = p != NULL;
+            heap_free_in(b, p);
+        }
+        char *message = ok ? heap_alloc_in(b, 64) : NULL;
+        if (message != NULL)
+            strcpy(message, "from the child");
+        size_t offset = heap_offset_in(b, message);
+        ok = write(fds[1], &offset, sizeof(offset)) == sizeof(offset) && offset != 0;
+        _exit(ok ? 0 : 1);
+    }
+    // Allocate alongside the child to contend for the shared lock
+    for (int i = 0; i < 500; i++) {
+        void *p = heap_alloc_in(a, 16 + i % 300);
+        if (p == NULL)
+            TEST_FAILED();
+        heap_free_in(a, p);
+    }
+    size_t offset = 0;
+    int status = 0;
+    if (read(fds[0], &offset, sizeof(offset)) != sizeof(offset) || waitpid(child, &status, 0) != child ||
+        !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        TEST_FAILED();
+    close(fds[0]);
+    close(fds[1]);
+
+    char *message = heap_pointer_in(a, offset);
+    if (strcmp(message, "from the child") != 0 || !check_heap_integrity_in(a))
+        TEST_FAILED();
+    heap_free_in(a, message);
+    if (get_free_heap_size_in(a) != get_used_heap_size_in(a) || !check_heap_integrity_in(a))
+        TEST_FAILED();
+    allocator_destroy(a);
+    heap_unlink_shared(name);
+    TEST_PASSED();
+}
+
+void test_shared_heap_rejects_other_layout_version() {
+    char name[64];
+    snprintf(name, sizeof(name), "/allocator_test_version_%d", (int)getpid());
+    heap_unlink_shared(name);
+    Allocator *a = heap_open_shared(name, 64 * 1024);
+    if (a == NULL)
+        TEST_FAILED();
+    // The layout version follows the 32-bit magic at the start of the object
+    ((uint32_t *)a)[1]++;
+    if (heap_open_shared(name, 0) != NULL || get_last_status() != ALLOC_HEAP_ERROR)
+        TEST_FAILED();
+    ((uint32_t *)a)[1]--;
+    Allocator *b = heap_open_shared(name, 0);
+    if (b == NULL)
+        TEST_FAILED();
+    allocator_destroy(b);
+    allocator_destroy(a);
+    heap_unlink_shared(name);
+    TEST_PASSED();
+}
+
+void test_snapshot_restores_identical_heap() {
+    reset_allocator();
+    set_allocation_strategy(BEST_FIT);
+    void *ptrs[300];
+    srand(11);
+    for (int i = 0; i < 300; i++)
+        ptrs[i] = heap_alloc(1 + rand() % 400);
+    for (int i = 0; i < 300; i += 3)
+        heap_free(ptrs[i]);
+
+    size_t size = heap_snapshot(NULL, 0);
+    char *image = malloc(size);
+    char *expected = malloc(get_heap_size());
+    if (size == 0 || heap_snapshot(image, size) != size || size >= HEAP_CAPACITY / 2)
+        TEST_FAILED();
+    memcpy(expected, get_heap_base(), get_heap_size());
+    size_t saved_size = get_heap_size();
+    size_t used = get_used_heap_size();
+    void *next = heap_alloc(200);
+
+    // Scramble the heap, then roll it back
+    for (int i = 1; i < 300; i += 3)
+        heap_free(ptrs[i]);
+    set_allocation_strategy(WORST_FIT);
+    heap_alloc(5000);
+    if (!heap_restore(image, size))
+        TEST_FAILED();
+    if (get_heap_size() != saved_size || memcmp(get_heap_base(), expected, get_heap_size()) != 0 ||
+        get_allocation_strategy() != BEST_FIT || get_used_heap_size() != used || !check_heap_integrity())
+        TEST_FAILED();
+    // The restored heap makes the same choices it would have made
+    if (heap_alloc(200) != next || !check_heap_integrity())
+        TEST_FAILED();
+    free(image);
+    free(expected);
+    TEST_PASSED();
+}
+
+void test_snapshot_with_live_handles_is_refused() {
+    reset_allocator();
+    heap_alloc(100);
+    Handle h = handle_alloc(64);
+    FILE *file = tmpfile();
+    if (h == HANDLE_NONE || file == NULL)
+        TEST_FAILED();
+    // The handle table is not in the image, so its blocks could never be freed after a restore
+    if (heap_snapshot(NULL, 0) != 0 || get_last_status() != ALLOC_INVALID_OPERATION)
+        TEST_FAILED();
+    if (heap_snapshot_fd(fileno(file)) || get_last_status() != ALLOC_INVALID_OPERATION)
+        TEST_FAILED();
+    fclose(file);
+    handle_free(h);
+    if (heap_snapshot(NULL, 0) == 0 || get_last_status() != ALLOC_SUCCESS)
+        TEST_FAILED();
+    TEST_PASSED();
+}
+
+void test_snapshot_round_trips_through_fd() {
+    reset_allocator();
+    char *a = heap_alloc(100);
+    heap_alloc(300);
+    strcpy(a, "checkpoint");
+    heap_free(heap_alloc(50));
+    size_t saved_size = get_heap_size();
+    FILE *file = tmpfile();
+    if (file == NULL || !heap_snapshot_fd(fileno(file)))
+        TEST_FAILED();
+
+    heap_reset();
+    heap_alloc(1000);
+    rewind(file);
+    if (!heap_restore_fd(fileno(file)) || get_heap_size() != saved_size || strcmp(a, "checkpoint") != 0 ||
+        !check_heap_integrity())
+        TEST_FAILED();
+    fclose(file);
+
+    // A damaged image is refused and leaves the heap alone
+    size_t size = heap_snapshot(NULL, 0);
+    char *image = malloc(size);
+    heap_snapshot(image, size);
+    image[0] ^= 1;
+    if (heap_restore(image, size) || get_last_status() != ALLOC_HEAP_ERROR)
+        TEST_FAILED();
+    image[0] ^= 1;
+    if (heap_restore(image, size - 1) || get_last_status() != ALLOC_HEAP_ERROR || get_heap_size() != saved_size)
+        TEST_FAILED();
+    free(image);
+    TEST_PASSED();
+}
+
+void test_snapshot_with_broken_block_list_is_refused() {
+    reset_allocator();
+    char *a = heap_alloc(100);
+    heap_free(heap_alloc(200));
+    heap_alloc(300);
+    strcpy(a, "current");
+    size_t size = heap_snapshot(NULL, 0);
+    char *image = malloc(size);
+    heap_snapshot(image, size);
+
+    // The first block's next link points into the middle of its neighbour
+    size_t map_bytes = (get_heap_size() / ALIGNMENT + 63) / 64 * sizeof(uint64_t);
+    BlockHeader *first = (BlockHeader *)(image + size - map_bytes - get_heap_size());
+    first->next += ALIGNMENT;
+
+    heap_alloc(64);
+    size_t saved_size = get_heap_size();
+    char *expected = malloc(get_heap_size());
+    memcpy(expected, get_heap_base(), get_heap_size());
+    if (heap_restore(image, size) || get_last_status() != ALLOC_HEAP_ERROR)
+        TEST_FAILED();
+    FILE *file = tmpfile();
+    if (file == NULL || fwrite(image, 1, size, file) != size)
+        TEST_FAILED();
+    rewind(file);
+    if (heap_restore_fd(fileno(file)) || get_last_status() != ALLOC_HEAP_ERROR)
+        TEST_FAILED();
+    fclose(file);
+    if (get_heap_size() != saved_size || memcmp(get_heap_base(), expected, get_heap_size()) != 0 || strcmp(a, "current") != 0 ||
+        !check_heap_integrity())
+        TEST_FAILED();
+    free(image);
+    free(expected);
+    TEST_PASSED();
+}
+
+void test_snapshot_with_stray_free_bit_is_refused() {
+    reset_allocator();
+    heap_alloc(100);
+    void *gap = heap_alloc(100);
+    char *a = heap_alloc(200);
+    heap_alloc(100);
+    heap_free(gap);
+    size_t size = heap_snapshot(NULL, 0);
+    char *image = malloc(size);
+    heap_snapshot(image, size);
+
+    // Mark a granule inside a's payload free, as if a block started there; a sits
+    // above the lowest free block, so the free list head does not give it away
+    size_t map_bytes = (get_heap_size() / ALIGNMENT + 63) / 64 * sizeof(uint64_t);
+    uint64_t *map = (uint64_t *)(image + size - map_bytes);
+    size_t g = (size_t)(a - get_heap_base() + 64) / ALIGNMENT;
+    map[g / 64] |= 1ULL << (g % 64);
+
+    size_t saved_size = get_heap_size();
+    if (heap_restore(image, size) || get_last_status() != ALLOC_HEAP_ERROR || get_heap_size() != saved_size ||
+        !check_heap_integrity())
+        TEST_FAILED();
+    free(image);
+    TEST_PASSED();
+}
+
+void test_exports_describe_heap_in_one_pass() {
+    reset_allocator();
+    void *ptrs[40];
+    for (int i = 0; i < 40; i++)
+        ptrs[i] = heap_alloc(10 + i * 7);
+    for (int i = 0; i < 40; i += 4)
+        heap_free(ptrs[i]);
+    char json_path[64], ndjson_path[64], address_line[64], ratio_line[64], line[256];
+    snprintf(json_path, sizeof(json_path), "/tmp/allocator_test_%d.json", (int)getpid());
+    snprintf(ndjson_path, sizeof(ndjson_path), "/tmp/allocator_test_%d.ndjson", (int)getpid());
+
+    // Addresses and totals are formatted by hand but must read like printf's
+    export_heap_json(json_path);
+    FILE *file = fopen(json_path, "r");
+    snprintf(address_line, sizeof(address_line), "      \"header_address\": \"%p\",\n", (void *)get_first_block());
+    snprintf(ratio_line, sizeof(ratio_line), "    \"fragmentation_ratio\": %.4f\n", get_fragmentation_ratio());
+    bool found_address = false, found_ratio = false;
+    while (file != NULL && fgets(line, sizeof(line), file) != NULL) {
+        found_address |= strcmp(line, address_line) == 0;
+        found_ratio |= strcmp(line, ratio_line) == 0;
+    }
+    if (file == NULL || !found_address || !found_ratio)
+        TEST_FAILED();
+    fclose(file);
+
+    export_heap_ndjson(ndjson_path);
+    file = fopen(ndjson_path, "r");
+    size_t blocks = 0, free_blocks = 0, stats_free = 0, stats_alloc = 0;
+    while (file != NULL && fgets(line, sizeof(line), file) != NULL) {
+        if (strstr(line, "\"type\": \"block\"") != NULL) {
+            blocks++;
+            free_blocks += strstr(line, "\"free\": true") != NULL;
+        } else if (sscanf(line, "{\"type\": \"stats\", \"heap_size\": %*u, \"allocated_blocks\": %zu, \"free_blocks\": %zu",
+                          &stats_alloc, &stats_free) != 2) {
+            TEST_FAILED();
+        }
+    }
+    if (file == NULL || blocks != get_alloc_count() + get_free_block_count() || free_blocks != get_free_block_count() ||
+        stats_free != free_blocks || stats_alloc != get_alloc_count())
+        TEST_FAILED();
+    fclose(file);
+    unlink(json_path);
+    unlink(ndjson_path);
+    TEST_PASSED();
+}
+
+// Reads the runs of the last heap map in a file into runs[], returning how many there are
+static size_t read_heap_map_runs(const char *path, size_t *runs, size_t max_runs, size_t *used_granules) {
+    static char line[1 << 16];
+    size_t count = 0;
+    FILE *file = fopen(path, "r");
+    while (file != NULL && fgets(line, sizeof(line), file) != NULL) {
+        char *p = strstr(line, "\"used_granules\": ");
+        if (p == NULL || sscanf(p, "\"used_granules\": %zu", used_granules) != 1 || (p = strchr(p, '[')) == NULL)
+            continue;
+        count = 0;
+        p++;
+        while (*p != ']' && count < max_runs) {
+            runs[count++] = strtoul(p, &p, 10);
+            if (*p == ',')
+                p += 2;
+        }
+    }
+    if (file != NULL)
+        fclose(file);
+    return count;
+}
+
+void test_heap_map_encodes_occupancy_runs() {
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/allocator_test_%d.map", (int)getpid());
+    unlink(path);
+    size_t runs[64], used_granules = 0;
+
+    reset_allocator();
+    void *a = heap_alloc(100), *b = heap_alloc(200), *c = heap_alloc(50);
+    heap_alloc(30);
+    heap_free(b);
+    heap_free(a);
+    export_heap_map(path);
+    // a and b merged into one free run at the start, then c and the last block
+    size_t n = read_heap_map_runs(path, runs, 64, &used_granules);
+    if (n != 3 || runs[0] != 0 || runs[1] != get_first_block()->size / ALIGNMENT || get_first_block()->free == false ||
+        runs[2] != get_heap_size() / ALIGNMENT - runs[1] || used_granules != get_heap_size() / ALIGNMENT ||
+        (char *)c != (char *)block_next(get_first_block()) + sizeof(BlockHeader))
+        TEST_FAILED();
+
+    // Header-less strategies are mapped from their own tables
+    reset_allocator();
+    set_allocation_strategy(BITMAP);
+    void *x = heap_alloc(16);
+    heap_alloc(48);
+    void *z = heap_alloc(32);
+    heap_alloc(16);
+    heap_free(x);
+    heap_free(z);
+    export_heap_map(path);
+    n = read_heap_map_runs(path, runs, 64, &used_granules);
+    if (n != 5 || runs[0] != 0 || runs[1] != 1 || runs[2] != 3 || runs[3] != 2 || runs[4] != 1 ||
+        used_granules != 7)
+        TEST_FAILED();
+    unlink(path);
+    reset_allocator();
+    TEST_PASSED();
+}
+
+void test_handles_lock_and_free() {
+    reset_allocator();
+    Handle h = handle_alloc(100);
+    char *p = handle_lock(h);
+    if (h == HANDLE_NONE || p == NULL || (uintptr_t)p % ALIGNMENT != 0)
+        TEST_FAILED();
+    strcpy(p, "movable");
+    // Locks nest, and a locked handle cannot be freed
+    if (handle_lock(h) != p)
+        TEST_FAILED();
+    handle_unlock(h);
+    handle_free(h);
+    if (get_last_status() != ALLOC_INVALID_OPERATION || strcmp(p, "movable") != 0)
+        TEST_FAILED();
+    handle_unlock(h);
+    handle_unlock(h);
+    if (get_last_status() != ALLOC_INVALID_OPERATION)
+        TEST_FAILED();
+    handle_free(h);
+    if (get_last_status() != ALLOC_SUCCESS || !get_first_block()->free || handle_lock(h) != NULL)
+        TEST_FAILED();
+    handle_free(h);
+    if (get_last_status() != ALLOC_INVALID_FREE || handle_lock(HANDLE_NONE) != NULL)
+        TEST_FAILED();
+
+    // Handles do not survive a heap reset, and need the block list
+    h = handle_alloc(50);
+    heap_reset();
+    heap_alloc(200);
+    if (handle_lock(h) != NULL || !check_heap_integrity())
+        TEST_FAILED();
+    reset_allocator();
+    set_allocation_strategy(BITMAP);
+    if (handle_alloc(50) != HANDLE_NONE || get_last_status() != ALLOC_INVALID_OPERATION)
+        TEST_FAILED();
+    reset_allocator();
+    TEST_PASSED();
+}
+
+void test_compaction_slides_handles_down() {
+    AllocationStrategy strategies[] = {FIRST_FIT, BEST_FIT, FIRST_FIT};
+    MetadataMode modes[] = {METADATA_INLINE, METADATA_INLINE, METADATA_SIDE_TABLE};
+    for (int config = 0; config < 3; config++) {
+        reset_allocator();
+        set_allocation_strategy(strategies[config]);
+        set_metadata_mode(modes[config]);
+        // A plain block at the bottom must stay put
+        char *plain = heap_alloc(64);
+        strcpy(plain, "pinned");
+        Handle handles[40];
+        for (int i = 0; i < 40; i++) {
+            handles[i] = handle_alloc(40 + i * 8);
+            memset(handle_lock(handles[i]), 'a' + i % 26, 40 + i * 8);
+            handle_unlock(handles[i]);
+        }
+        // A checkerboard, with a locked handle in the middle
+        for (int i = 0; i < 40; i += 2)
+            handle_free(handles[i]);
+        char *locked = handle_lock(handles[21]);
+        size_t free_space = get_free_heap_size();
+
+        size_t tail = heap_compact();
+        if (!check_heap_integrity() || handle_lock(handles[21]) != locked || strcmp(plain, "pinned") != 0)
+            TEST_FAILED();
+        // Free space is left only below the locked handle and past the last handle
+        if (get_free_block_count() != 2 || tail == 0 || tail >= free_space)
+            TEST_FAILED();
+        for (int i = 1; i < 40; i += 2) {
+            char *p = handle_lock(handles[i]);
+            for (int j = 0; j < 40 + i * 8; j++)
+                if (p[j] != 'a' + i % 26)
+                    TEST_FAILED();
+            handle_unlock(handles[i]);
+        }
+
+        handle_unlock(handles[21]);
+        handle_unlock(handles[21]);
+        tail = heap_compact();
+        if (!check_heap_integrity() || get_free_block_count() != 1 || strcmp(plain, "pinned") != 0)
+            TEST_FAILED();
+        // The first surviving handle now follows the plain block directly
+        char *first = (char *)handle_lock(handles[1]) - HANDLE_TAG_SIZE - sizeof(BlockHeader);
+        if (tail != free_space || first != plain - sizeof(BlockHeader) + align(64 + sizeof(BlockHeader)))
+            TEST_FAILED();
+        handle_unlock(handles[1]);
+    }
+    reset_allocator();
+    TEST_PASSED();
+}
 
-    void *ptr3 = heap_realloc(ptr2, 50);
-    if (ptr3 == NULL)
+void test_compaction_steps_within_budget() {
+    reset_allocator();
+    Handle handles[40];
+    for (int i = 0; i < 40; i++) {
+        handles[i] = handle_alloc(100);
+        memset(handle_lock(handles[i]), 'a' + i % 26, 100);
+        handle_unlock(handles[i]);
+    }
+    for (int i = 0; i < 40; i += 2)
+        handle_free(handles[i]);
+    size_t free_space = get_free_heap_size();
+    char *second = handle_lock(handles[3]);
+    handle_unlock(handles[3]);
+
+    // The smallest budget moves a single block: handles[1] into the first hole
+    if (heap_compact_step(1) || (char *)handle_lock(handles[1]) != get_heap_base() + sizeof(BlockHeader) + HANDLE_TAG_SIZE)
         TEST_FAILED();
-    for (int i = 0; i < 50; i++) {
-        if (((char *)ptr3)[i] != 'X')
+    handle_unlock(handles[1]);
+    if (handle_lock(handles[3]) != second || !check_heap_integrity())
+        TEST_FAILED();
+    handle_unlock(handles[3]);
+
+    // The heap stays usable between steps
+    int steps = 1;
+    while (!heap_compact_step(256)) {
+        if (!check_heap_integrity())
             TEST_FAILED();
+        if (++steps == 5) {
+            handle_free(handles[1]);
+            handles[1] = handle_alloc(100);
+            memset(handle_lock(handles[1]), 'b', 100);
+            handle_unlock(handles[1]);
+        }
     }
-
-    heap_free(ptr3);
-    if (get_last_status() != ALLOC_SUCCESS)
+    if (steps < 10)
+        TEST_FAILED();
+    // Space freed behind the cursor is picked up by the next pass
+    while (!heap_compact_step(256))
+        ;
+    if (get_free_block_count() != 1 || get_free_heap_size() != free_space || !check_heap_integrity())
         TEST_FAILED();
+    for (int i = 1; i < 40; i += 2) {
+        char *p = handle_lock(handles[i]);
+        for (int j = 0; j < 100; j++)
+            if (p[j] != 'a' + i % 26)
+                TEST_FAILED();
+        handle_unlock(handles[i]);
+    }
+    reset_allocator();
     TEST_PASSED();
 }
 
-void test_zero_allocation() {
+// Address-ordered best fit by walking the block list
+static BlockHeader *list_best_fit(size_t total_size) {
+    BlockHeader *best = NULL;
+    for (BlockHeader *curr = get_first_block(); curr != NULL; curr = block_next(curr)) {
+        if (curr->free && curr->size >= total_size && (best == NULL || curr->size < best->size))
+            best = curr;
+    }
+    return best;
+}
+
+void test_best_fit_index_matches_list_walk() {
     reset_allocator();
-    void *ptr = heap_alloc(0);
-    if (ptr != NULL)
-        TEST_FAILED();
-    heap_free(ptr);
-    if (get_last_status() != ALLOC_INVALID_FREE)
+    set_allocation_strategy(BEST_FIT);
+    static void *ptrs[2000];
+    srand(7);
+    for (int i = 0; i < 2000; i++) {
+        size_t size = 1 + rand() % 700;
+        BlockHeader *expected = list_best_fit(align(size + sizeof(BlockHeader)));
+        ptrs[i] = heap_alloc(size);
+        if (expected != NULL && ptrs[i] != (char *)expected + sizeof(BlockHeader))
+            TEST_FAILED();
+        if (i % 3 == 0) {
+            int victim = rand() % (i + 1);
+            heap_free(ptrs[victim]);
+            ptrs[victim] = NULL;
+        }
+        if (i % 97 == 0 && !check_heap_integrity())
+            TEST_FAILED();
+    }
+    if (!check_heap_integrity())
         TEST_FAILED();
     TEST_PASSED();
 }
 
-void test_large_allocation() {
+void test_best_fit_index_prefers_lowest_address() {
     reset_allocator();
-    size_t half_heap = HEAP_CAPACITY / 2;
-    void *ptr = heap_alloc(half_heap - sizeof(BlockHeader) - 100);
-    if (ptr == NULL)
-        TEST_FAILED();
-    heap_free(ptr);
-    if (get_last_status() != ALLOC_SUCCESS)
+    void *ptrs[6];
+    for (int i = 0; i < 6; i++)
+        ptrs[i] = heap_alloc(i % 2 == 0 ? 200 : 40);
+    heap_free(ptrs[4]);
+    heap_free(ptrs[0]);
+    heap_free(ptrs[2]);
+    // Switching strategy rebuilds the index from the existing free blocks
+    set_allocation_strategy(BEST_FIT);
+    if (heap_alloc(150) != ptrs[0] || heap_alloc(150) != ptrs[2] || !check_heap_integrity())
         TEST_FAILED();
     TEST_PASSED();
 }
 
-void test_too_large_allocation() {
+void test_next_fit_resumes_after_last_allocation() {
     reset_allocator();
-    void *ptr = heap_alloc(HEAP_CAPACITY + 1);
-    if (ptr != NULL)
+    set_allocation_strategy(NEXT_FIT);
+    void *ptrs[5];
+    for (int i = 0; i < 5; i++)
+        ptrs[i] = heap_alloc(100);
+    heap_free(ptrs[1]);
+    heap_free(ptrs[3]);
+    // The search starts at the last block and wraps around to the first hole
+    if (heap_alloc(100) != ptrs[1])
         TEST_FAILED();
-    if (get_last_status() != ALLOC_OUT_OF_MEMORY)
+    heap_free(ptrs[0]);
+    // First fit would take ptrs[0]; next fit carries on past ptrs[1]
+    if (heap_alloc(100) != ptrs[3] || !check_heap_integrity())
         TEST_FAILED();
     TEST_PASSED();
 }
 
-void test_maximum_fragmentation() {
+void test_next_fit_cursor_survives_coalescing() {
     reset_allocator();
-    void *ptrs[100];
-    for (int i = 0; i < 100; i++) {
-        ptrs[i] = heap_alloc(64);
-        if (ptrs[i] == NULL)
-            TEST_FAILED();
-    }
-    for (int i = 0; i < 100; i += 2) {
-        heap_free(ptrs[i]);
-    }
-    double frag = get_fragmentation_ratio();
-    if (frag < 0.0 || frag > 0.1)
+    set_allocation_strategy(NEXT_FIT);
+    void *a = heap_alloc(100);
+    void *b = heap_alloc(100);
+    void *c = heap_alloc(100);
+    heap_free(a);
+    // The cursor is on c; freeing it and b merges c away into b
+    heap_free(c);
+    heap_free(b);
+    if (heap_alloc(250) != a || !check_heap_integrity())
         TEST_FAILED();
-    for (int i = 1; i < 100; i += 2) {
-        heap_free(ptrs[i]);
-    }
     TEST_PASSED();
 }
 
-void test_invalid_free() {
+// Fit-search steps per allocation for 100 blocks carved from a large hole past 200 small splinters
+static double splinter_search_length(AllocationStrategy strategy) {
     reset_allocator();
-    heap_free(NULL);
-    if (get_last_status() != ALLOC_INVALID_FREE)
-        TEST_FAILED();
-    int stack_var;
-    heap_free(&stack_var);
-    if (get_last_status() != ALLOC_HEAP_ERROR)
+    set_allocation_strategy(strategy);
+    void *small[200];
+    void *large[100];
+    for (int i = 0; i < 200; i++)
+        small[i] = heap_alloc(16);
+    for (int i = 0; i < 100; i++)
+        large[i] = heap_alloc(256);
+    for (int i = 0; i < 200; i += 2)
+        heap_free(small[i]);
+    for (int i = 0; i < 100; i++)
+        heap_free(large[i]);
+    size_t searches = get_fit_search_count();
+    size_t steps = get_fit_search_steps();
+    for (int i = 0; i < 100; i++)
+        heap_alloc(256);
+    return (double)(get_fit_search_steps() - steps) / (get_fit_search_count() - searches);
+}
+
+void test_next_fit_skips_splinters() {
+    double first = splinter_search_length(FIRST_FIT);
+    double next = splinter_search_length(NEXT_FIT);
+    // First fit steps over all 100 free splinters each time; next fit resumes inside the hole
+    if (first < 100 || next > 3)
         TEST_FAILED();
     TEST_PASSED();
 }
 
-void test_double_free() {
+void test_free_list_search_skips_allocated_blocks() {
     reset_allocator();
-    void *ptr = heap_alloc(100);
-    if (ptr == NULL)
-        TEST_FAILED();
-    heap_free(ptr);
-    if (get_last_status() != ALLOC_SUCCESS)
-        TEST_FAILED();
-    heap_free(ptr);
-    if (get_last_status() != ALLOC_INVALID_FREE)
+    void *ptrs[300];
+    for (int i = 0; i < 300; i++)
+        ptrs[i] = heap_alloc(64);
+    for (int i = 0; i < 300; i += 10)
+        heap_free(ptrs[i]);
+    // Nothing fits, so the search examines every free block and none of the others
+    size_t free_blocks = get_free_block_count();
+    size_t steps = get_fit_search_steps();
+    if (heap_alloc(1000) == NULL || get_fit_search_steps() - steps != free_blocks || free_blocks != 30)
         TEST_FAILED();
     TEST_PASSED();
 }
 
-void test_use_after_free() {
+void test_free_list_keeps_address_order() {
     reset_allocator();
-    void *ptr = heap_alloc(100);
-    if (ptr == NULL)
+    void *ptrs[9];
+    for (int i = 0; i < 9; i++)
+        ptrs[i] = heap_alloc(100);
+    // Freed out of order, the holes must still be handed out lowest address first
+    heap_free(ptrs[7]);
+    heap_free(ptrs[3]);
+    heap_free(ptrs[5]);
+    heap_free(ptrs[1]);
+    if (!check_heap_integrity())
+        TEST_FAILED();
+    for (int i = 1; i < 9; i += 2) {
+        if (heap_alloc(100) != ptrs[i])
+            TEST_FAILED();
+    }
+    if (get_free_block_count() != 0 || !check_heap_integrity())
         TEST_FAILED();
-    heap_free(ptr);
-    memset(ptr, 'Z', 100);
     TEST_PASSED();
 }
 
-void test_heap_integrity() {
+void test_free_list_detects_link_overwrite() {
     reset_allocator();
-    void *ptr1 = heap_alloc(100);
-    void *ptr2 = heap_alloc(200);
-    void *ptr3 = heap_alloc(300);
+    char *a = heap_alloc(64);
+    char *b = heap_alloc(64);
+    char *c = heap_alloc(64);
+    heap_free(b);
     if (!check_heap_integrity())
         TEST_FAILED();
-    heap_free(ptr2);
-    heap_free(ptr1);
-    heap_free(ptr3);
-    if (!check_heap_integrity())
+    memset(b, 0x5A, 8);  // Use after free clobbers the free list links
+    if (check_heap_integrity() || get_last_status() != ALLOC_HEAP_ERROR)
         TEST_FAILED();
+    (void)a;
+    (void)c;
     TEST_PASSED();
 }
 
@@ -427,6 +1819,43 @@ void test_realloc_with_adjacent_free() {
     TEST_PASSED();
 }
 
+void test_realloc_grow_into_free_neighbor() {
+    reset_allocator();
+    void *ptr1 = heap_alloc(100);
+    void *ptr2 = heap_alloc(400);
+    void *ptr3 = heap_alloc(100);
+    heap_free(ptr2);
+
+    void *new_ptr = heap_realloc(ptr1, 300);
+    if (new_ptr != ptr1)
+        TEST_FAILED();
+    if (!check_heap_integrity())
+        TEST_FAILED();
+    heap_free(new_ptr);
+    heap_free(ptr3);
+    if (!check_heap_integrity())
+        TEST_FAILED();
+    TEST_PASSED();
+}
+
+void test_realloc_shrink_merges_free_neighbor() {
+    reset_allocator();
+    void *ptr1 = heap_alloc(200);
+    void *ptr2 = heap_alloc(100);
+    void *ptr3 = heap_alloc(10);
+    heap_free(ptr2);
+
+    if (heap_realloc(ptr1, 50) != ptr1)
+        TEST_FAILED();
+    if (!check_heap_integrity())
+        TEST_FAILED();
+    if (get_free_block_count() != 1)
+        TEST_FAILED();
+    heap_free(ptr1);
+    heap_free(ptr3);
+    TEST_PASSED();
+}
+
 void test_realloc_must_relocate() {
     reset_allocator();
     void *ptr1 = heap_alloc(100);
@@ -719,6 +2148,264 @@ void test_alloc_free_alloc_same_size() {
     TEST_PASSED();
 }
 
+void test_profiler_tracks_live_bytes() {
+    reset_allocator();
+    profiler_reset();
+    profiler_enable(1); // Sample every allocation
+
+    void *ptrs[10];
+    for (int i = 0; i < 10; i++) {
+        ptrs[i] = heap_alloc(128);
+        if (ptrs[i] == NULL)
+            TEST_FAILED();
+    }
+    if (profiler_live_samples() != 10)
+        TEST_FAILED();
+    if (profiler_live_bytes() < 10 * 128)
+        TEST_FAILED();
+
+    for (int i = 0; i < 10; i++) {
+        heap_free(ptrs[i]);
+    }
+    profiler_disable();
+    if (profiler_live_samples() != 0 || profiler_live_bytes() != 0)
+        TEST_FAILED();
+    TEST_PASSED();
+}
+
+void test_profiler_ignores_instances() {
+    reset_allocator();
+    profiler_reset();
+    profiler_enable(1);
+
+    // Instance heaps run under their own mutex, not the one guarding the profiler
+    static char buffer[16384] __attribute__((aligned(16)));
+    Allocator *allocator = allocator_create(buffer, sizeof(buffer));
+    void *ptr = heap_alloc_in(allocator, 128);
+    ptr = heap_realloc_in(allocator, ptr, 4096);
+    size_t sampled = profiler_live_samples();
+    heap_free_in(allocator, ptr);
+    allocator_destroy(allocator);
+    profiler_disable();
+    if (ptr == NULL || sampled != 0)
+        TEST_FAILED();
+    TEST_PASSED();
+}
+
+void test_profiler_sampling_rate() {
+    reset_allocator();
+    profiler_reset();
+    profiler_enable(4096);
+
+    // 2000 x 64 bytes = 128 KB allocated, so roughly 31 samples are expected
+    void *ptrs[2000];
+    for (int i = 0; i < 2000; i++) {
+        ptrs[i] = heap_alloc(64);
+    }
+    size_t sampled = profiler_live_samples();
+    profiler_disable();
+    for (int i = 0; i < 2000; i++) {
+        heap_free(ptrs[i]);
+    }
+    if (sampled < 5 || sampled > 100)
+        TEST_FAILED();
+    if (profiler_live_samples() != 0)
+        TEST_FAILED();
+    TEST_PASSED();
+}
+
+void test_profiler_folded_dump() {
+    reset_allocator();
+    profiler_reset();
+    profiler_enable(1);
+
+    void *ptr = heap_alloc(256);
+    profiler_disable();
+    if (!profiler_dump_folded("test_profile.folded"))
+        TEST_FAILED();
+
+    FILE *fptr = fopen("test_profile.folded", "r");
+    if (fptr == NULL)
+        TEST_FAILED();
+    char line[4096];
+    bool has_line = fgets(line, sizeof(line), fptr) != NULL;
+    fclose(fptr);
+    remove("test_profile.folded");
+    if (!has_line || strrchr(line, ' ') == NULL)
+        TEST_FAILED();
+
+    heap_free(ptr);
+    TEST_PASSED();
+}
+
+void *concurrent_worker(void *arg) {
+    unsigned int seed = (unsigned int)(uintptr_t)arg;
+    void *ptrs[50] = {0};
+    for (int op = 0; op < 2000; op++) {
+        int idx = rand_r(&seed) % 50;
+        if (ptrs[idx] != NULL) {
+            heap_free(ptrs[idx]);
+            ptrs[idx] = NULL;
+        } else {
+            ptrs[idx] = heap_alloc(16 + rand_r(&seed) % 200);
+        }
+    }
+    for (int i = 0; i < 50; i++) {
+        if (ptrs[i] != NULL)
+            heap_free(ptrs[i]);
+    }
+    return NULL;
+}
+
+void test_pool_reuses_last_object_first() {
+    reset_allocator();
+    Pool *pool = pool_create(24, 16);
+    char *a = pool_get(pool);
+    char *b = pool_get(pool);
+    char *c = pool_get(pool);
+    // Objects are packed without headers at the rounded-up size
+    if (pool_object_size(pool) != 32 || (uintptr_t)a % ALIGNMENT != 0 || b != a + 32 || c != b + 32)
+        TEST_FAILED();
+    pool_put(pool, b);
+    pool_put(pool, a);
+    if (pool_get(pool) != a || pool_get(pool) != b || pool_chunk_count(pool) != 1)
+        TEST_FAILED();
+    pool_destroy(pool);
+    if (get_alloc_count() != 0 || !check_heap_integrity())
+        TEST_FAILED();
+    TEST_PASSED();
+}
+
+void test_pool_grows_by_chunks() {
+    reset_allocator();
+    Pool *pool = pool_create(100, 8);
+    void *objs[20];
+    for (int i = 0; i < 20; i++) {
+        objs[i] = pool_get(pool);
+        memset(objs[i], i, 100);
+    }
+    if (pool_chunk_count(pool) != 3 || get_alloc_count() != 4)
+        TEST_FAILED();
+    for (int i = 0; i < 20; i++)
+        pool_put(pool, objs[i]);
+    // Reuse comes from the free list, not new chunks
+    for (int i = 0; i < 20; i++)
+        pool_get(pool);
+    if (pool_chunk_count(pool) != 3)
+        TEST_FAILED();
+    pool_destroy(pool);
+    if (get_alloc_count() != 0 || !check_heap_integrity())
+        TEST_FAILED();
+    TEST_PASSED();
+}
+
+static void *pool_worker(void *arg) {
+    Pool *pool = arg;
+    uintptr_t id = (uintptr_t)pthread_self();
+    uintptr_t *held[50];
+    for (int round = 0; round < 200; round++) {
+        for (int i = 0; i < 50; i++) {
+            held[i] = pool_get(pool);
+            held[i][1] = id;
+        }
+        // Nobody else may have been handed one of our objects
+        for (int i = 0; i < 50; i++) {
+            if (held[i][1] != id)
+                return (void *)1;
+            pool_put(pool, held[i]);
+        }
+    }
+    return NULL;
+}
+
+void test_pool_magazines_across_threads() {
+    reset_allocator();
+    Pool *pool = pool_create(32, 64);
+    pool_enable_magazines(pool);
+    pthread_t threads[4];
+    for (int i = 0; i < 4; i++)
+        pthread_create(&threads[i], NULL, pool_worker, pool);
+    bool clashed = false;
+    for (int i = 0; i < 4; i++) {
+        void *result;
+        pthread_join(threads[i], &result);
+        clashed |= result != NULL;
+    }
+    // At most 50 live objects per thread plus what magazines hold
+    if (clashed || pool_chunk_count(pool) > 4 * (50 + POOL_MAGAZINE_SIZE) / 64 + 1)
+        TEST_FAILED();
+    pool_destroy(pool);
+    if (get_alloc_count() != 0 || !check_heap_integrity())
+        TEST_FAILED();
+    TEST_PASSED();
+}
+
+static void *pool_brief_worker(void *arg) {
+    Pool *pool = arg;
+    pool_put(pool, pool_get(pool));
+    return NULL;
+}
+
+void test_pool_magazines_return_when_threads_exit() {
+    reset_allocator();
+    Pool *pool = pool_create(32, 64);
+    pool_enable_magazines(pool);
+    // Each thread's magazine is refilled with half a magazine of objects, so if exited
+    // threads kept theirs, 100 threads in a row would need dozens of chunks
+    for (int i = 0; i < 100; i++) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, pool_brief_worker, pool) != 0)
+            TEST_FAILED();
+        pthread_join(thread, NULL);
+    }
+    if (pool_chunk_count(pool) != 1)
+        TEST_FAILED();
+    pool_destroy(pool);
+    if (get_alloc_count() != 0 || !check_heap_integrity())
+        TEST_FAILED();
+    TEST_PASSED();
+}
+
+void test_concurrent_alloc_free() {
+    reset_allocator();
+    pthread_t threads[4];
+    for (int i = 0; i < 4; i++) {
+        pthread_create(&threads[i], NULL, concurrent_worker, (void *)(uintptr_t)(i + 1));
+    }
+    for (int i = 0; i < 4; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    if (!check_heap_integrity())
+        TEST_FAILED();
+    if (get_alloc_count() != 0)
+        TEST_FAILED();
+    TEST_PASSED();
+}
+
+void test_profiler_reset_beside_allocations() {
+    reset_allocator();
+    profiler_reset();
+    pthread_t threads[4];
+    for (int i = 0; i < 4; i++) {
+        pthread_create(&threads[i], NULL, concurrent_worker, (void *)(uintptr_t)(i + 1));
+    }
+    // Each reset and dump runs under the heap mutex, between whole hook calls
+    bool dumped = true;
+    for (int i = 0; i < 20; i++) {
+        profiler_reset();
+        profiler_enable(256);
+        dumped = dumped && profiler_dump_folded("test_profile.folded");
+    }
+    for (int i = 0; i < 4; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    profiler_disable();
+    remove("test_profile.folded");
+    if (!dumped || profiler_live_samples() != 0 || profiler_live_bytes() != 0 || !check_heap_integrity())
+        TEST_FAILED();
+    TEST_PASSED();
+}
+
 void test_allocation_performance() {
     TEST_START();
     reset_allocator();
@@ -756,7 +2443,7 @@ void compare_allocation_strategies() {
     const int num_trials = 3;
     const int num_allocs = 500;
     const int num_sizes = 5;
-    int sizes[num_sizes] = {32, 64, 128, 256, 512};
+    int sizes[] = {32, 64, 128, 256, 512};
 
     double times[3][num_trials]; // [strategy][trial]
 
@@ -840,6 +2527,16 @@ int main(int argc, char *argv[]) {
     test_double_free();
     test_use_after_free();
     test_heap_integrity();
+    test_integrity_detects_cycle();
+    test_integrity_detects_bad_size();
+    test_integrity_full_heap_small_stack();
+    test_verify_step_covers_heap();
+    test_verify_step_reports_location();
+    test_verify_budget_during_operations();
+    test_free_rejects_interior_pointer();
+    test_free_rejects_merged_block();
+    test_realloc_rejects_freed_block();
+    test_integrity_detects_forged_header();
 
     // Alocation Strategies Tests
     test_first_fit_strategy();
@@ -862,6 +2559,8 @@ int main(int argc, char *argv[]) {
     test_realloc_zero_size();
     test_realloc_exact_same_size();
     test_realloc_with_adjacent_free();
+    test_realloc_grow_into_free_neighbor();
+    test_realloc_shrink_merges_free_neighbor();
     test_realloc_must_relocate();
 
     printf("\n" ANSI_COLOR_CYAN "=== Advanced Coalescing Tests ===" ANSI_COLOR_RESET "\n");
@@ -889,6 +2588,93 @@ int main(int argc, char *argv[]) {
     printf("\n" ANSI_COLOR_CYAN "=== Edge Case Combinations ===" ANSI_COLOR_RESET "\n");
     test_alloc_free_alloc_same_size();
 
+    printf("\n" ANSI_COLOR_CYAN "=== Side Table Tests ===" ANSI_COLOR_RESET "\n");
+    test_side_table_matches_inline();
+    test_side_table_detects_header_overwrite();
+    test_fit_kernels_match_scalar();
+    test_side_table_kernels_match_inline();
+
+    printf("\n" ANSI_COLOR_CYAN "=== Next-Fit Tests ===" ANSI_COLOR_RESET "\n");
+    test_next_fit_resumes_after_last_allocation();
+    test_next_fit_cursor_survives_coalescing();
+    test_next_fit_skips_splinters();
+
+    printf("\n" ANSI_COLOR_CYAN "=== Explicit Free List Tests ===" ANSI_COLOR_RESET "\n");
+    test_free_list_search_skips_allocated_blocks();
+    test_free_list_keeps_address_order();
+    test_free_list_detects_link_overwrite();
+
+    printf("\n" ANSI_COLOR_CYAN "=== Best-Fit Index Tests ===" ANSI_COLOR_RESET "\n");
+    test_best_fit_index_matches_list_walk();
+    test_best_fit_index_prefers_lowest_address();
+
+    printf("\n" ANSI_COLOR_CYAN "=== Bitmap Strategy Tests ===" ANSI_COLOR_RESET "\n");
+    test_bitmap_allocations_have_no_header();
+    test_bitmap_rejects_invalid_frees();
+    test_bitmap_realloc();
+    test_bitmap_fills_heap();
+    test_bitmap_strategy_switch_refused();
+
+    printf("\n" ANSI_COLOR_CYAN "=== Buddy Strategy Tests ===" ANSI_COLOR_RESET "\n");
+    test_buddy_splits_and_merges();
+    test_buddy_rejects_invalid_frees();
+    test_buddy_realloc();
+    test_buddy_detects_free_list_overwrite();
+    test_buddy_fills_and_drains_heap();
+
+    printf("\n" ANSI_COLOR_CYAN "=== Allocator Instance Tests ===" ANSI_COLOR_RESET "\n");
+    test_allocator_instances_are_isolated();
+    test_allocator_reset_releases_everything();
+    test_allocator_mapped_exceeds_process_heap();
+    test_heap_reset_is_lazy();
+    test_instances_run_beside_process_heap();
+
+    printf("\n" ANSI_COLOR_CYAN "=== Persistent Heap Tests ===" ANSI_COLOR_RESET "\n");
+    test_persistent_heap_survives_reopen();
+    test_persistent_heap_rejects_foreign_file();
+    test_persistent_heap_rejects_broken_block_list();
+
+    printf("\n" ANSI_COLOR_CYAN "=== Shared Heap Tests ===" ANSI_COLOR_RESET "\n");
+    test_shared_heap_passes_offsets_between_processes();
+    test_shared_heap_rejects_other_layout_version();
+
+    printf("\n" ANSI_COLOR_CYAN "=== Snapshot Tests ===" ANSI_COLOR_RESET "\n");
+    test_snapshot_restores_identical_heap();
+    test_snapshot_round_trips_through_fd();
+    test_snapshot_with_live_handles_is_refused();
+    test_snapshot_with_broken_block_list_is_refused();
+    test_snapshot_with_stray_free_bit_is_refused();
+
+    printf("\n" ANSI_COLOR_CYAN "=== Export Tests ===" ANSI_COLOR_RESET "\n");
+    test_exports_describe_heap_in_one_pass();
+    test_heap_map_encodes_occupancy_runs();
+
+    printf("\n" ANSI_COLOR_CYAN "=== Handle Tests ===" ANSI_COLOR_RESET "\n");
+    test_handles_lock_and_free();
+    test_compaction_slides_handles_down();
+    test_compaction_steps_within_budget();
+
+    printf("\n" ANSI_COLOR_CYAN "=== Region Tests ===" ANSI_COLOR_RESET "\n");
+    test_region_bumps_within_chunk();
+    test_region_grows_and_resets();
+    test_region_in_allocator_instance();
+
+    printf("\n" ANSI_COLOR_CYAN "=== Pool Tests ===" ANSI_COLOR_RESET "\n");
+    test_pool_reuses_last_object_first();
+    test_pool_grows_by_chunks();
+    test_pool_magazines_across_threads();
+    test_pool_magazines_return_when_threads_exit();
+
+    printf("\n" ANSI_COLOR_CYAN "=== Concurrency Tests ===" ANSI_COLOR_RESET "\n");
+    test_concurrent_alloc_free();
+
+    printf("\n" ANSI_COLOR_CYAN "=== Profiler Tests ===" ANSI_COLOR_RESET "\n");
+    test_profiler_tracks_live_bytes();
+    test_profiler_ignores_instances();
+    test_profiler_sampling_rate();
+    test_profiler_reset_beside_allocations();
+    test_profiler_folded_dump();
+
     printf(ANSI_COLOR_MAGENTA "\nAll enhanced tests completed!\n" ANSI_COLOR_RESET);
     return 0;
 }
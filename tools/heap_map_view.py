@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+"""Render heap maps from export_heap_map as an image of fragmentation over time.
+
+Each line of the input is one dump; it becomes one row of a grayscale PGM image,
+oldest at the top. Columns cover equal slices of the heap's capacity and are shaded
+by what fills them: black for allocated granules, gray for free ones and white for
+granules that have never been handed out. A summary of each dump's fragmentation is
+printed alongside.
+
+Usage: heap_map_view.py MAP_FILE [-o OUT.pgm] [--width N] [--row-height N]
+"""
+
+import argparse
+import json
+import sys
+
+ALLOCATED, FREE, UNTOUCHED = 0, 170, 255
+
+
+def load_dumps(path):
+    with open(path) as f:
+        return [json.loads(line) for line in f if line.strip()]
+
+
+def render_row(dump, width):
+    """Shades width columns by the average of the granules each one covers."""
+    capacity = dump["capacity_granules"]
+    totals = [0] * width
+    # Positions are scaled by width so that column boundaries fall on integers
+    position = 0
+    runs = dump["runs"] + [capacity - dump["used_granules"]]
+    for i, length in enumerate(runs):
+        shade = UNTOUCHED if i == len(runs) - 1 else (ALLOCATED if i % 2 == 0 else FREE)
+        end = position + length * width
+        # Spread the run over the columns it overlaps
+        while position < end:
+            column = position // capacity
+            covered = min(end, (column + 1) * capacity) - position
+            totals[column] += shade * covered
+            position += covered
+    return bytes(min(255, round(t / capacity)) for t in totals)
+
+
+def summarize(dump):
+    free_runs = dump["runs"][1::2]
+    free = sum(free_runs)
+    largest = max(free_runs, default=0)
+    # External fragmentation: share of free memory outside the largest free run
+    fragmentation = 1 - largest / free if free else 0.0
+    granule = dump["granule"]
+    return (f"{dump['timestamp_ns']:>20}  used {dump['used_granules'] * granule:>10} B  "
+            f"free {free * granule:>10} B in {len(free_runs):>6} runs  "
+            f"largest {largest * granule:>10} B  fragmentation {fragmentation:.3f}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("map_file", help="file written by export_heap_map")
+    parser.add_argument("-o", "--output", default="heap_map.pgm", help="image to write (PGM)")
+    parser.add_argument("--width", type=int, default=1024, help="image width in pixels")
+    parser.add_argument("--row-height", type=int, default=4, help="pixel rows per dump")
+    args = parser.parse_args()
+
+    dumps = load_dumps(args.map_file)
+    if not dumps:
+        sys.exit(f"{args.map_file}: no heap maps")
+
+    with open(args.output, "wb") as out:
+        out.write(f"P5\n{args.width} {len(dumps) * args.row_height}\n255\n".encode())
+        for dump in dumps:
+            row = render_row(dump, args.width)
+            out.write(row * args.row_height)
+            print(summarize(dump))
+    print(f"wrote {args.output}: {len(dumps)} dumps", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()